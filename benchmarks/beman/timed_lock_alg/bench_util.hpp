@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef BEMAN_TIMED_LOCK_ALG_BENCHMARKS_BENCH_UTIL_HPP
+#define BEMAN_TIMED_LOCK_ALG_BENCHMARKS_BENCH_UTIL_HPP
+
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace beman::timed_lock_alg::bench {
+
+// ============================================================================
+// Algorithms under test, shared by the benchmarks and the stress harness
+//
+// run() acquires all mutexes, calls hold() while owning them and releases them.
+// It returns false if the mutexes could not be acquired within the timeout.
+// ============================================================================
+
+// run_with() is run() with a backoff policy, which may observe the call.
+
+struct try_lock_for_alg {
+    static constexpr const char* name = "try_lock_for";
+
+    template <class Hold, class... Ms>
+    static bool run(std::chrono::milliseconds timeout, Hold&& hold, Ms&... ms) {
+        return run_with(timeout, yield_backoff{}, hold, ms...);
+    }
+
+    template <class Backoff, class Hold, class... Ms>
+    static bool run_with(std::chrono::milliseconds timeout, Backoff backoff, Hold&& hold, Ms&... ms) {
+        if (beman::timed_lock_alg::try_lock_for(timeout, std::move(backoff), ms...) != -1)
+            return false;
+        [[maybe_unused]] std::scoped_lock lock(std::adopt_lock, ms...);
+        hold();
+        return true;
+    }
+};
+
+struct multi_lock_alg {
+    static constexpr const char* name = "multi_lock";
+
+    template <class Hold, class... Ms>
+    static bool run(std::chrono::milliseconds timeout, Hold&& hold, Ms&... ms) {
+        return run_with(timeout, yield_backoff{}, hold, ms...);
+    }
+
+    template <class Backoff, class Hold, class... Ms>
+    static bool run_with(std::chrono::milliseconds timeout, Backoff backoff, Hold&& hold, Ms&... ms) {
+        beman::timed_lock_alg::multi_lock lock(timeout, std::move(backoff), ms...);
+        if (not lock)
+            return false;
+        hold();
+        return true;
+    }
+};
+
+// Every round of the lock algorithms (ours and std::lock) starts with exactly one blocking call, so counting the
+// blocking calls made by the current thread gives the number of rounds it needed.
+inline thread_local std::int64_t blocking_calls = 0;
+
+template <class M>
+struct counting_mutex {
+    M m;
+
+    void lock() {
+        ++blocking_calls;
+        m.lock();
+    }
+    bool try_lock() { return m.try_lock(); }
+    void unlock() { m.unlock(); }
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        ++blocking_calls;
+        return m.try_lock_for(dur);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        ++blocking_calls;
+        return m.try_lock_until(tp);
+    }
+};
+
+// simulates work done while holding the locks without giving up the core
+inline void busy_wait(std::chrono::nanoseconds dur) {
+    if (dur == dur.zero())
+        return;
+    const auto end = std::chrono::steady_clock::now() + dur;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+// Collects acquisition latencies for one benchmark thread and reports its percentiles. The benchmark reports the mean
+// over its threads of each percentile, which is not the percentile of all threads' samples taken together.
+class latency_recorder {
+  public:
+    latency_recorder() { m_samples.reserve(1 << 16); }
+
+    void add(std::chrono::steady_clock::duration dur) {
+        m_samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(dur).count());
+    }
+
+    void report(benchmark::State& state) {
+        if (m_samples.empty())
+            return;
+        state.counters["mean_thread_p50_ns"] = benchmark::Counter(percentile(50), benchmark::Counter::kAvgThreads);
+        state.counters["mean_thread_p99_ns"] = benchmark::Counter(percentile(99), benchmark::Counter::kAvgThreads);
+    }
+
+  private:
+    double percentile(std::size_t pct) {
+        auto nth = m_samples.begin() + static_cast<std::ptrdiff_t>((m_samples.size() - 1) * pct / 100);
+        std::nth_element(m_samples.begin(), nth, m_samples.end());
+        return static_cast<double>(*nth);
+    }
+
+    std::vector<std::int64_t> m_samples;
+};
+
+// Precomputed random lock sets of N distinct indices in [0, pool_size). The indices are left in random order, so
+// threads picking sets that overlap don't all lock the shared mutexes in the same order.
+template <std::size_t N>
+std::vector<std::array<std::size_t, N>> make_lock_sets(std::size_t pool_size, int seed) {
+    std::mt19937             gen(static_cast<std::mt19937::result_type>(seed));
+    std::vector<std::size_t> idx(pool_size);
+    std::iota(idx.begin(), idx.end(), std::size_t{});
+
+    std::vector<std::array<std::size_t, N>> sets(256);
+    for (auto& set : sets) {
+        std::shuffle(idx.begin(), idx.end(), gen);
+        std::copy_n(idx.begin(), N, set.begin());
+    }
+    return sets;
+}
+
+// calls func with the mutexes in pool selected by set as a pack of references
+template <class Pool, std::size_t N, class Func>
+decltype(auto) with_pack(Pool& pool, const std::array<std::size_t, N>& set, Func&& func) {
+    return [&]<std::size_t... Is>(std::index_sequence<Is...>) -> decltype(auto) {
+        return std::forward<Func>(func)(pool[set[Is]]...);
+    }(std::make_index_sequence<N>{});
+}
+
+} // namespace beman::timed_lock_alg::bench
+
+#endif // BEMAN_TIMED_LOCK_ALG_BENCHMARKS_BENCH_UTIL_HPP
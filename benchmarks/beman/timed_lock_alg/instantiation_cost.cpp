@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: MIT
+
+// Instantiates the variadic algorithms and multi_lock for BEMAN_TIMED_LOCK_ALG_LOCK_COUNT lockables.
+// Compiled once per lock count by measure_instantiation_cost.cmake to track compile time and object size.
+
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#ifndef BEMAN_TIMED_LOCK_ALG_LOCK_COUNT
+#define BEMAN_TIMED_LOCK_ALG_LOCK_COUNT 30
+#endif
+
+namespace tla = beman::timed_lock_alg;
+
+namespace {
+constexpr std::size_t lock_count = BEMAN_TIMED_LOCK_ALG_LOCK_COUNT;
+
+// every other mutex is recursive to instantiate the heterogeneous path too
+template <std::size_t I>
+using mixed_mutex_t = std::conditional_t<I % 2 == 0, std::timed_mutex, std::recursive_timed_mutex>;
+
+template <std::size_t... Is>
+auto make_mixed(std::index_sequence<Is...>) -> std::tuple<mixed_mutex_t<Is>...>;
+
+using mixed_mutexes = decltype(make_mixed(std::make_index_sequence<lock_count>{}));
+} // namespace
+
+int try_lock_homogeneous(std::array<std::timed_mutex, lock_count>& mtxs, std::chrono::milliseconds dur) {
+    return std::apply([&](auto&... ms) { return tla::try_lock_for(dur, ms...); }, mtxs);
+}
+
+int try_lock_heterogeneous(mixed_mutexes& mtxs, std::chrono::milliseconds dur) {
+    return std::apply([&](auto&... ms) { return tla::try_lock_for(dur, ms...); }, mtxs);
+}
+
+bool multi_lock_homogeneous(std::array<std::timed_mutex, lock_count>& mtxs, std::chrono::milliseconds dur) {
+    return std::apply([&](auto&... ms) { return tla::multi_lock(dur, ms...).owns_lock(); }, mtxs);
+}
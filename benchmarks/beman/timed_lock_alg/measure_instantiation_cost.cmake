@@ -0,0 +1,50 @@
+# SPDX-License-Identifier: MIT
+
+# Compiles instantiation_cost.cpp once per lock count and reports the compile time and object size.
+#
+# Usage:
+#   cmake -DCOMPILER=<c++ compiler> -DSTANDARD=<c++ standard> -DSOURCE=<instantiation_cost.cpp>
+#         -DINCLUDE_DIR=<include dir> -DOUTPUT_DIR=<dir> [-DLOCK_COUNTS=2;4;...] -P measure_instantiation_cost.cmake
+#
+# The results are also written to OUTPUT_DIR/instantiation_cost.csv.
+
+cmake_minimum_required(VERSION 3.25)
+
+foreach(var COMPILER STANDARD SOURCE INCLUDE_DIR OUTPUT_DIR)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "${var} must be defined")
+    endif()
+endforeach()
+
+if(NOT DEFINED LOCK_COUNTS)
+    set(LOCK_COUNTS 2 4 8 16 32 64 128)
+endif()
+
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+set(csv "lock_count,compile_ms,object_bytes\n")
+
+foreach(n IN LISTS LOCK_COUNTS)
+    set(object "${OUTPUT_DIR}/instantiation_cost_${n}.o")
+    string(TIMESTAMP start "%s%f" UTC)
+    execute_process(
+        COMMAND
+            "${COMPILER}" -std=c++${STANDARD} -O2 -I "${INCLUDE_DIR}"
+            -DBEMAN_TIMED_LOCK_ALG_LOCK_COUNT=${n} -c "${SOURCE}" -o
+            "${object}"
+        RESULT_VARIABLE result
+    )
+    string(TIMESTAMP stop "%s%f" UTC)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "compiling with ${n} lockables failed")
+    endif()
+    math(EXPR compile_ms "(${stop} - ${start}) / 1000")
+    file(SIZE "${object}" object_bytes)
+
+    message(
+        STATUS
+        "lock_count=${n} compile_ms=${compile_ms} object_bytes=${object_bytes}"
+    )
+    string(APPEND csv "${n},${compile_ms},${object_bytes}\n")
+endforeach()
+
+file(WRITE "${OUTPUT_DIR}/instantiation_cost.csv" "${csv}")
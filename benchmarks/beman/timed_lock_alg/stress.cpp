@@ -0,0 +1,521 @@
+// SPDX-License-Identifier: MIT
+
+// Multi-threaded macro workloads for the timed lock algorithms. Unlike the micro benchmarks, every configuration
+// runs all of its threads for a fixed time and reports how the work was distributed between them:
+//
+//   ops/s        successful acquisitions per second
+//   starve       fewest acquisitions of a thread relative to the mean (1 is perfectly fair, 0 means starved)
+//   p50/p99/max  acquisition latency
+//   timeouts     fraction of calls that timed out
+//   rounds       mean and max rounds per call as reported to an observer. A max far above the mean means calls
+//                kept failing (livelock).
+//
+// Workloads:
+//   philosophers  one thread per philosopher, each locking the forks to its left and right
+//   bank          random transfers between two of --accounts accounts, checking that money is conserved. With
+//                 --alg=executor, the transfers are submitted in batches to a lock_set_executor with --threads
+//                 workers and the latency includes the time queued; starve and rounds don't apply.
+//   hotkeys       locking 4 of --keys keys where half of the picks go to the 4 hottest keys
+//
+// Usage: beman.timed_lock_alg.stress [--workload=all|philosophers|bank|hotkeys]
+//                                    [--alg=all|try_lock_for|escalate_after|multi_lock|executor]
+//                                    [--threads=16,32,64,128] [--seconds=1] [--hold-ns=1000] [--timeout-ms=100]
+//                                    [--accounts=64] [--keys=256] [--histogram]
+
+#include <beman/timed_lock_alg/lock_set_executor.hpp>
+#include <beman/timed_lock_alg/mutex.hpp>
+#include <beman/timed_lock_alg/observer.hpp>
+#include "bench_util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla   = beman::timed_lock_alg;
+namespace bench = beman::timed_lock_alg::bench;
+
+namespace {
+using mutex_type = std::timed_mutex;
+
+// the rounds after which escalate_after switches to the ordered acquisition
+constexpr std::size_t escalation_rounds = 8;
+
+struct options {
+    std::string               workload = "all";
+    std::string               alg      = "all";
+    std::vector<std::size_t>  threads{16, 32, 64, 128};
+    std::chrono::milliseconds duration{1000};
+    std::chrono::nanoseconds  hold{1000};
+    std::chrono::milliseconds timeout{100};
+    std::size_t               accounts  = 64;
+    std::size_t               keys      = 256;
+    bool                      histogram = false;
+};
+
+// ============================================================================
+// Latency histogram with 8 linear sub-buckets per power of two, so that the
+// percentiles are accurate to 12.5%.
+// ============================================================================
+
+class latency_histogram {
+  public:
+    void add(std::chrono::nanoseconds dur) {
+        const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(dur.count(), 0));
+        ++m_buckets[bucket(ns)];
+        ++m_count;
+        m_max = std::max(m_max, ns);
+    }
+
+    void merge(const latency_histogram& other) {
+        for (std::size_t i = 0; i < m_buckets.size(); ++i) {
+            m_buckets[i] += other.m_buckets[i];
+        }
+        m_count += other.m_count;
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    // the upper bound of the bucket holding the percentile
+    std::uint64_t percentile(double pct) const {
+        const auto    rank = static_cast<std::uint64_t>(static_cast<double>(m_count) * pct / 100.0);
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < m_buckets.size(); ++i) {
+            seen += m_buckets[i];
+            if (seen > rank) {
+                return std::min(upper_bound(i), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    std::uint64_t max() const noexcept { return m_max; }
+
+    // prints the counts per power of two
+    void print() const {
+        for (std::size_t power = 0; power < powers; ++power) {
+            std::uint64_t count = 0;
+            for (std::size_t sub = 0; sub < sub_buckets; ++sub) {
+                count += m_buckets[power * sub_buckets + sub];
+            }
+            if (count != 0) {
+                std::printf("    <= %12llu ns: %llu\n",
+                            static_cast<unsigned long long>(upper_bound(power * sub_buckets + sub_buckets - 1)),
+                            static_cast<unsigned long long>(count));
+            }
+        }
+    }
+
+  private:
+    static constexpr std::size_t sub_buckets = 8;
+    static constexpr std::size_t powers      = 64 - 3;
+
+    static std::size_t bucket(std::uint64_t ns) {
+        if (ns < sub_buckets) {
+            return static_cast<std::size_t>(ns);
+        }
+        std::size_t power = 63;
+        while ((ns >> power) == 0) {
+            --power;
+        }
+        // power >= 3, the 3 bits below the leading one select the sub-bucket
+        const auto sub = static_cast<std::size_t>((ns >> (power - 3)) & (sub_buckets - 1));
+        return std::min((power - 2) * sub_buckets + sub, powers * sub_buckets - 1);
+    }
+
+    static std::uint64_t upper_bound(std::size_t idx) {
+        const std::size_t power = idx / sub_buckets;
+        const std::size_t sub   = idx % sub_buckets;
+        if (power == 0) {
+            return sub;
+        }
+        return ((sub_buckets + sub + 1) << (power - 1)) - 1;
+    }
+
+    std::array<std::uint64_t, powers * sub_buckets> m_buckets{};
+    std::uint64_t                                   m_count = 0;
+    std::uint64_t                                   m_max   = 0;
+};
+
+// ============================================================================
+// Algorithms under test, observed by a thread's rounds_observer
+// ============================================================================
+
+// keeps the rounds of the last call of a thread
+struct rounds_observer {
+    std::uint64_t rounds = 0;
+
+    void on_blocked(std::size_t, std::chrono::steady_clock::duration) noexcept {}
+    void on_failed(std::size_t) noexcept {}
+    void on_backoff() noexcept {}
+    void on_finished(int, std::size_t r) noexcept { rounds = r; }
+};
+
+// bench::try_lock_for_alg or bench::multi_lock_alg
+template <class Alg>
+struct observed_alg {
+    static constexpr const char* name = Alg::name;
+
+    template <class Hold, class... Ms>
+    static bool run(std::chrono::milliseconds timeout, rounds_observer& observer, Hold&& hold, Ms&... ms) {
+        return Alg::run_with(timeout, tla::observe(observer), hold, ms...);
+    }
+};
+
+struct escalating_alg {
+    static constexpr const char* name = "escalate_after";
+
+    template <class Hold, class... Ms>
+    static bool run(std::chrono::milliseconds timeout, rounds_observer& observer, Hold&& hold, Ms&... ms) {
+        return bench::try_lock_for_alg::run_with(
+            timeout, tla::observe(observer, tla::escalate_after(escalation_rounds)), hold, ms...);
+    }
+};
+
+// ============================================================================
+// Runner
+// ============================================================================
+
+struct alignas(64) thread_stats {
+    std::uint64_t     ops        = 0;
+    std::uint64_t     timeouts   = 0;
+    std::uint64_t     rounds     = 0;
+    std::uint64_t     max_rounds = 0;
+    latency_histogram latency;
+};
+
+// Runs op(thread_index, observer) on threads threads until the duration elapsed and prints one line of results. op
+// makes one call of the algorithm under test observed by observer and returns whether it acquired the locks.
+template <class Op>
+void run(const options& opts, const char* workload, const char* alg, std::size_t threads, Op op) {
+    std::vector<thread_stats> stats(threads);
+    std::atomic<std::size_t>  ready{0};
+    std::atomic<bool>         stop{false};
+    {
+        std::vector<std::thread> ths;
+        ths.reserve(threads);
+        for (std::size_t t = 0; t < threads; ++t) {
+            ths.emplace_back([&, t] {
+                auto&           st = stats[t];
+                rounds_observer observer;
+                ++ready;
+                while (ready != threads) {
+                    std::this_thread::yield();
+                }
+                while (not stop.load(std::memory_order_relaxed)) {
+                    observer.rounds  = 0;
+                    const auto start = std::chrono::steady_clock::now();
+                    if (op(t, observer)) {
+                        ++st.ops;
+                        st.latency.add(std::chrono::steady_clock::now() - start);
+                    } else {
+                        ++st.timeouts;
+                    }
+                    st.rounds += observer.rounds;
+                    st.max_rounds = std::max(st.max_rounds, observer.rounds);
+                }
+            });
+        }
+        while (ready != threads) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(opts.duration);
+        stop = true;
+        for (auto& th : ths) {
+            th.join();
+        }
+    }
+
+    thread_stats  total;
+    std::uint64_t min_ops = stats.front().ops;
+    for (const auto& st : stats) {
+        total.ops += st.ops;
+        total.timeouts += st.timeouts;
+        total.rounds += st.rounds;
+        total.max_rounds = std::max(total.max_rounds, st.max_rounds);
+        total.latency.merge(st.latency);
+        min_ops = std::min(min_ops, st.ops);
+    }
+    const double seconds = std::chrono::duration<double>(opts.duration).count();
+    const double calls   = static_cast<double>(total.ops + total.timeouts);
+    const double mean    = static_cast<double>(total.ops) / static_cast<double>(threads);
+    std::printf("%-13s %-14s %7zu %12.0f %7.3f %10llu %10llu %12llu %9.4f %7.2f %7llu\n",
+                workload,
+                alg,
+                threads,
+                static_cast<double>(total.ops) / seconds,
+                mean != 0 ? static_cast<double>(min_ops) / mean : 0.0,
+                static_cast<unsigned long long>(total.latency.percentile(50)),
+                static_cast<unsigned long long>(total.latency.percentile(99)),
+                static_cast<unsigned long long>(total.latency.max()),
+                calls != 0 ? static_cast<double>(total.timeouts) / calls : 0.0,
+                calls != 0 ? static_cast<double>(total.rounds) / calls : 0.0,
+                static_cast<unsigned long long>(total.max_rounds));
+    if (opts.histogram) {
+        total.latency.print();
+    }
+}
+
+// ============================================================================
+// Workloads
+// ============================================================================
+
+template <class Alg>
+void philosophers(const options& opts, std::size_t threads) {
+    std::vector<mutex_type> forks(threads);
+    run(opts, "philosophers", Alg::name, threads, [&](std::size_t t, rounds_observer& observer) {
+        return Alg::run(
+            opts.timeout, observer, [&] { bench::busy_wait(opts.hold); }, forks[t], forks[(t + 1) % threads]);
+    });
+}
+
+struct account {
+    mutex_type   mtx;
+    std::int64_t balance = 1000;
+};
+
+template <class Alg>
+void bank(const options& opts, std::size_t threads) {
+    std::vector<account>      accounts(std::max<std::size_t>(opts.accounts, 2));
+    std::vector<std::mt19937> gens;
+    for (std::size_t t = 0; t < threads; ++t) {
+        gens.emplace_back(static_cast<std::mt19937::result_type>(t));
+    }
+    run(opts, "bank", Alg::name, threads, [&](std::size_t t, rounds_observer& observer) {
+        auto&                                      gen = gens[t];
+        std::uniform_int_distribution<std::size_t> pick(0, accounts.size() - 1);
+        const std::size_t                          from = pick(gen);
+        std::size_t                                to   = pick(gen);
+        while (to == from) {
+            to = pick(gen);
+        }
+        const auto amount = static_cast<std::int64_t>(gen() % 100);
+        return Alg::run(
+            opts.timeout,
+            observer,
+            [&] {
+                accounts[from].balance -= amount;
+                bench::busy_wait(opts.hold);
+                accounts[to].balance += amount;
+            },
+            accounts[from].mtx,
+            accounts[to].mtx);
+    });
+
+    std::int64_t total = 0;
+    for (const auto& acc : accounts) {
+        total += acc.balance;
+    }
+    if (total != static_cast<std::int64_t>(accounts.size()) * 1000) {
+        std::fprintf(stderr, "bank: money was not conserved, %lld instead of %lld\n",
+                     static_cast<long long>(total),
+                     static_cast<long long>(accounts.size()) * 1000);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// the bank workload with the transfers run by a lock_set_executor instead of threads locking the accounts
+void bank_executor(const options& opts, std::size_t threads) {
+    std::vector<account>   accounts(std::max<std::size_t>(opts.accounts, 2));
+    std::mt19937           gen(0);
+    latency_histogram      latency;
+    std::uint64_t          ops   = 0;
+    const std::size_t      batch = 64 * threads;
+    tla::lock_set_executor ex(threads);
+
+    std::vector<std::chrono::nanoseconds>      latencies(batch);
+    std::uniform_int_distribution<std::size_t> pick(0, accounts.size() - 1);
+    const auto                                 start = std::chrono::steady_clock::now();
+    auto                                       end   = start;
+    while (end - start < opts.duration) {
+        for (std::size_t i = 0; i < batch; ++i) {
+            const std::size_t from = pick(gen);
+            std::size_t       to   = pick(gen);
+            while (to == from) {
+                to = pick(gen);
+            }
+            const auto                       amount    = static_cast<std::int64_t>(gen() % 100);
+            const auto                       submitted = std::chrono::steady_clock::now();
+            const std::array<mutex_type*, 2> set{&accounts[from].mtx, &accounts[to].mtx};
+            static_cast<void>(ex.submit(set, [&, from, to, amount, submitted, i] {
+                accounts[from].balance -= amount;
+                bench::busy_wait(opts.hold);
+                accounts[to].balance += amount;
+                latencies[i] = std::chrono::steady_clock::now() - submitted;
+            }));
+        }
+        ex.wait_idle();
+        for (const auto lat : latencies) {
+            latency.add(lat);
+        }
+        ops += batch;
+        end = std::chrono::steady_clock::now();
+    }
+
+    std::printf("%-13s %-14s %7zu %12.0f %7s %10llu %10llu %12llu %9.4f %7s %7s\n",
+                "bank",
+                "executor",
+                threads,
+                static_cast<double>(ops) / std::chrono::duration<double>(end - start).count(),
+                "-",
+                static_cast<unsigned long long>(latency.percentile(50)),
+                static_cast<unsigned long long>(latency.percentile(99)),
+                static_cast<unsigned long long>(latency.max()),
+                0.0,
+                "-",
+                "-");
+    if (opts.histogram) {
+        latency.print();
+    }
+
+    std::int64_t total = 0;
+    for (const auto& acc : accounts) {
+        total += acc.balance;
+    }
+    if (total != static_cast<std::int64_t>(accounts.size()) * 1000) {
+        std::fprintf(stderr, "bank: money was not conserved, %lld instead of %lld\n",
+                     static_cast<long long>(total),
+                     static_cast<long long>(accounts.size()) * 1000);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+template <class Alg>
+void hotkeys(const options& opts, std::size_t threads) {
+    constexpr std::size_t     keys_per_op = 4;
+    const std::size_t         nkeys       = std::max(opts.keys, 2 * keys_per_op);
+    std::vector<mutex_type>   keys(nkeys);
+    std::vector<std::mt19937> gens;
+    for (std::size_t t = 0; t < threads; ++t) {
+        gens.emplace_back(static_cast<std::mt19937::result_type>(t));
+    }
+    run(opts, "hotkeys", Alg::name, threads, [&](std::size_t t, rounds_observer& observer) {
+        auto&                                      gen = gens[t];
+        std::uniform_int_distribution<std::size_t> hot(0, keys_per_op - 1);
+        std::uniform_int_distribution<std::size_t> any(0, nkeys - 1);
+        std::array<std::size_t, keys_per_op>       set;
+        for (std::size_t i = 0; i < keys_per_op; ++i) {
+            do {
+                set[i] = gen() % 2 == 0 ? hot(gen) : any(gen);
+            } while (std::find(set.begin(), set.begin() + static_cast<std::ptrdiff_t>(i), set[i]) !=
+                     set.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+        return bench::with_pack(keys, set, [&](auto&... ms) {
+            return Alg::run(opts.timeout, observer, [&] { bench::busy_wait(opts.hold); }, ms...);
+        });
+    });
+}
+
+template <class Alg>
+void run_workloads(const options& opts) {
+    for (const auto threads : opts.threads) {
+        if (opts.workload == "all" || opts.workload == "philosophers") {
+            philosophers<Alg>(opts, std::max<std::size_t>(threads, 2));
+        }
+        if (opts.workload == "all" || opts.workload == "bank") {
+            bank<Alg>(opts, threads);
+        }
+        if (opts.workload == "all" || opts.workload == "hotkeys") {
+            hotkeys<Alg>(opts, threads);
+        }
+    }
+}
+
+// ============================================================================
+// Command line
+// ============================================================================
+
+[[noreturn]] void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--workload=all|philosophers|bank|hotkeys]\n"
+                 "          [--alg=all|try_lock_for|escalate_after|multi_lock|executor]\n"
+                 "          [--threads=16,32,64,128] [--seconds=1] [--hold-ns=1000] [--timeout-ms=100]\n"
+                 "          [--accounts=64] [--keys=256] [--histogram]\n",
+                 argv0);
+    std::exit(EXIT_FAILURE);
+}
+
+options parse(int argc, char** argv) {
+    options opts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        const auto             eq    = arg.find('=');
+        const auto             name  = arg.substr(0, eq);
+        const std::string      value = eq == arg.npos ? std::string() : std::string(arg.substr(eq + 1));
+        const auto num = [&] { return static_cast<std::size_t>(std::strtoull(value.c_str(), nullptr, 10)); };
+        if (name == "--workload") {
+            opts.workload = value;
+        } else if (name == "--alg") {
+            opts.alg = value;
+        } else if (name == "--threads") {
+            opts.threads.clear();
+            for (std::size_t pos = 0; pos < value.size();) {
+                const auto comma = std::min(value.find(',', pos), value.size());
+                opts.threads.push_back(static_cast<std::size_t>(std::strtoull(value.c_str() + pos, nullptr, 10)));
+                pos = comma + 1;
+            }
+        } else if (name == "--seconds") {
+            opts.duration =
+                std::chrono::milliseconds(static_cast<std::int64_t>(std::strtod(value.c_str(), nullptr) * 1000));
+        } else if (name == "--hold-ns") {
+            opts.hold = std::chrono::nanoseconds(num());
+        } else if (name == "--timeout-ms") {
+            opts.timeout = std::chrono::milliseconds(num());
+        } else if (name == "--accounts") {
+            opts.accounts = num();
+        } else if (name == "--keys") {
+            opts.keys = num();
+        } else if (name == "--histogram") {
+            opts.histogram = true;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (opts.threads.empty() || std::find(opts.threads.begin(), opts.threads.end(), 0u) != opts.threads.end()) {
+        usage(argv[0]);
+    }
+    return opts;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    const options opts = parse(argc, argv);
+
+    std::printf("%-13s %-14s %7s %12s %7s %10s %10s %12s %9s %7s %7s\n",
+                "workload",
+                "alg",
+                "threads",
+                "ops/s",
+                "starve",
+                "p50_ns",
+                "p99_ns",
+                "max_ns",
+                "timeouts",
+                "rounds",
+                "max_rnd");
+    if (opts.alg == "all" || opts.alg == "try_lock_for") {
+        run_workloads<observed_alg<bench::try_lock_for_alg>>(opts);
+    }
+    if (opts.alg == "all" || opts.alg == "escalate_after") {
+        run_workloads<escalating_alg>(opts);
+    }
+    if (opts.alg == "all" || opts.alg == "multi_lock") {
+        run_workloads<observed_alg<bench::multi_lock_alg>>(opts);
+    }
+    if ((opts.alg == "all" || opts.alg == "executor") && (opts.workload == "all" || opts.workload == "bank")) {
+        for (const auto threads : opts.threads) {
+            bank_executor(opts, threads);
+        }
+    }
+}
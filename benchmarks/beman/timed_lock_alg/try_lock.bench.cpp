@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/mutex.hpp>
+#include <beman/timed_lock_alg/sharded_shared_timed_mutex.hpp>
+#include "bench_util.hpp"
+#include "mock_timed_mutex.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+
+using namespace std::chrono_literals;
+namespace tla   = beman::timed_lock_alg;
+namespace bench = beman::timed_lock_alg::bench;
+using MockMutex = beman::timed_lock_alg::test::MockTimedMutex;
+
+namespace {
+constexpr auto timeout = 100ms;
+
+// ============================================================================
+// Algorithms under test besides bench::try_lock_for_alg and bench::multi_lock_alg
+// ============================================================================
+
+template <class Backoff>
+struct try_lock_for_backoff_alg {
+    static constexpr const char* name = Backoff::name;
+
+    template <class Hold, class... Ms>
+    static bool run(std::chrono::milliseconds dur, Hold&& hold, Ms&... ms) {
+        if (tla::try_lock_for(dur, typename Backoff::type{}, ms...) != -1)
+            return false;
+        [[maybe_unused]] std::scoped_lock lock(std::adopt_lock, ms...);
+        hold();
+        return true;
+    }
+};
+
+struct with_spin {
+    using type                        = tla::spin_backoff;
+    static constexpr const char* name = "try_lock_for+spin_backoff";
+};
+struct with_exponential {
+    using type                        = tla::exponential_backoff;
+    static constexpr const char* name = "try_lock_for+exponential_backoff";
+};
+struct with_sleep {
+    using type                        = tla::sleep_backoff;
+    static constexpr const char* name = "try_lock_for+sleep_backoff";
+};
+
+struct try_lock_until_alg {
+    static constexpr const char* name = "try_lock_until";
+
+    template <class Hold, class... Ms>
+    static bool run(std::chrono::milliseconds dur, Hold&& hold, Ms&... ms) {
+        if (tla::try_lock_until(std::chrono::steady_clock::now() + dur, ms...) != -1)
+            return false;
+        [[maybe_unused]] std::scoped_lock lock(std::adopt_lock, ms...);
+        hold();
+        return true;
+    }
+};
+
+struct std_lock_alg {
+    static constexpr const char* name = "std::lock";
+
+    template <class Hold, class... Ms>
+    static bool run(std::chrono::milliseconds, Hold&& hold, Ms&... ms) {
+        if constexpr (sizeof...(Ms) == 1) {
+            (ms.lock(), ...);
+        } else {
+            std::lock(ms...);
+        }
+        [[maybe_unused]] std::scoped_lock lock(std::adopt_lock, ms...);
+        hold();
+        return true;
+    }
+};
+
+struct std_scoped_lock_alg {
+    static constexpr const char* name = "std::scoped_lock";
+
+    template <class Hold, class... Ms>
+    static bool run(std::chrono::milliseconds, Hold&& hold, Ms&... ms) {
+        [[maybe_unused]] std::scoped_lock lock(ms...);
+        hold();
+        return true;
+    }
+};
+
+template <class M>
+constexpr const char* mutex_name = "";
+template <>
+constexpr const char* mutex_name<std::timed_mutex> = "std::timed_mutex";
+template <>
+constexpr const char* mutex_name<MockMutex> = "MockTimedMutex";
+template <>
+constexpr const char* mutex_name<bench::counting_mutex<std::timed_mutex>> = "std::timed_mutex";
+template <>
+constexpr const char* mutex_name<std::shared_timed_mutex> = "std::shared_timed_mutex";
+template <>
+constexpr const char* mutex_name<tla::sharded_shared_timed_mutex> = "sharded_shared_timed_mutex";
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_FUTEX_TIMED_MUTEX)
+template <>
+constexpr const char* mutex_name<tla::futex_timed_mutex> = "futex_timed_mutex";
+#endif
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_ADAPTIVE_TIMED_MUTEX)
+template <>
+constexpr const char* mutex_name<tla::adaptive_timed_mutex> = "adaptive_timed_mutex";
+#endif
+
+constexpr std::size_t max_locks  = 100;
+constexpr std::size_t max_spread = 8;
+
+template <class M>
+std::array<M, max_locks * max_spread>& pool() {
+    static std::array<M, max_locks * max_spread> mtxs;
+    return mtxs;
+}
+
+// ============================================================================
+// Uncontended: the cost of the algorithms themselves
+// ============================================================================
+
+template <class Alg, class M, std::size_t N>
+void BM_Uncontended(benchmark::State& state) {
+    std::array<M, N> mtxs;
+    for (auto _ : state) {
+        bool ok = std::apply([](auto&... ms) { return Alg::run(timeout, [] {}, ms...); }, mtxs);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// ============================================================================
+// Contended: N mutexes picked at random from a pool of N * spread mutexes
+// shared by all threads. spread 1 means all threads compete for the same set.
+//
+// range(0): hold time in nanoseconds
+// range(1): spread
+//
+// rounds_per_success is only reported for counting_mutex.
+// ============================================================================
+
+template <class Alg, class M, std::size_t N>
+void BM_Contended(benchmark::State& state) {
+    using mutex_type = M;
+
+    const auto hold   = std::chrono::nanoseconds(state.range(0));
+    const auto spread = static_cast<std::size_t>(state.range(1));
+    const auto sets   = bench::make_lock_sets<N>(N * spread, state.thread_index());
+    auto&      mtxs   = pool<mutex_type>();
+
+    bench::latency_recorder lat;
+    std::int64_t            acquired = 0;
+    std::int64_t            timeouts = 0;
+    std::size_t             next     = 0;
+    bench::blocking_calls            = 0;
+
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+        const bool ok    = bench::with_pack(mtxs, sets[next++ % sets.size()], [&](auto&... ms) {
+            return Alg::run(
+                timeout,
+                [&] {
+                    lat.add(std::chrono::steady_clock::now() - start);
+                    bench::busy_wait(hold);
+                },
+                ms...);
+        });
+        if (ok) {
+            ++acquired;
+        } else {
+            ++timeouts;
+        }
+    }
+
+    state.SetItemsProcessed(acquired);
+    lat.report(state);
+    state.counters["timeouts"] = benchmark::Counter(static_cast<double>(timeouts), benchmark::Counter::kIsRate);
+    if (acquired != 0 && bench::blocking_calls != 0) {
+        state.counters["rounds_per_success"] =
+            benchmark::Counter(static_cast<double>(bench::blocking_calls) / static_cast<double>(acquired),
+                               benchmark::Counter::kAvgThreads);
+    }
+}
+
+// ============================================================================
+// Readers: all threads take shared locks of the same mutex, and every
+// write_every-th iteration of a thread takes an exclusive lock instead.
+//
+// range(0): write_every, 0 for no writes
+// ============================================================================
+
+template <class M>
+void BM_Readers(benchmark::State& state) {
+    static M   mtx;
+    static int value = 0;
+
+    const auto   write_every = state.range(0);
+    std::int64_t iteration   = 0;
+    for (auto _ : state) {
+        if (write_every != 0 && ++iteration % write_every == 0) {
+            std::lock_guard lock(mtx);
+            ++value;
+        } else {
+            std::shared_lock lock(mtx);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+template <class Alg, class M, std::size_t... Ns>
+void register_uncontended(std::index_sequence<Ns...>) {
+    (benchmark::RegisterBenchmark(
+         (std::string("Uncontended/") + Alg::name + '/' + mutex_name<M> + '/' + std::to_string(Ns)).c_str(),
+         BM_Uncontended<Alg, M, Ns>),
+     ...);
+}
+
+template <class Alg, class M, std::size_t... Ns>
+void register_contended(std::index_sequence<Ns...>) {
+    (benchmark::RegisterBenchmark(
+         (std::string("Contended/") + Alg::name + '/' + mutex_name<M> + '/' + std::to_string(Ns)).c_str(),
+         BM_Contended<Alg, M, Ns>)
+         ->ArgNames({"hold_ns", "spread"})
+         ->ArgsProduct({{0, 1'000, 10'000}, {1, max_spread}})
+         ->Threads(1)
+         ->Threads(2)
+         ->Threads(4)
+         ->Threads(8)
+         ->UseRealTime(),
+     ...);
+}
+
+template <class... Algs>
+bool register_all() {
+    using lock_counts = std::index_sequence<1, 2, 4, 8, 30, max_locks>;
+    (register_uncontended<Algs, std::timed_mutex>(lock_counts{}), ...);
+    (register_uncontended<Algs, MockMutex>(lock_counts{}), ...);
+    (register_contended<Algs, bench::counting_mutex<std::timed_mutex>>(lock_counts{}), ...);
+    return true;
+}
+
+template <class... Backoffs>
+bool register_backoffs() {
+    // the backoff policy only matters when there are failed rounds
+    using lock_counts = std::index_sequence<2, 8, 30>;
+    (register_contended<try_lock_for_backoff_alg<Backoffs>, bench::counting_mutex<std::timed_mutex>>(lock_counts{}),
+     ...);
+    return true;
+}
+
+// futex_timed_mutex packs sleep on all contended mutexes at once instead of on the one that failed
+bool register_futex() {
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_FUTEX_TIMED_MUTEX)
+    using lock_counts = std::index_sequence<1, 2, 8, 30>;
+    register_uncontended<bench::try_lock_for_alg, tla::futex_timed_mutex>(lock_counts{});
+    register_contended<bench::try_lock_for_alg, tla::futex_timed_mutex>(lock_counts{});
+#endif
+    return true;
+}
+
+// adaptive_timed_mutex spins for about the observed hold time before parking, compared to the std::timed_mutex runs
+// registered by register_all
+bool register_adaptive() {
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_ADAPTIVE_TIMED_MUTEX)
+    using lock_counts = std::index_sequence<1, 2, 8, 30>;
+    register_uncontended<bench::try_lock_for_alg, tla::adaptive_timed_mutex>(lock_counts{});
+    register_contended<bench::try_lock_for_alg, tla::adaptive_timed_mutex>(lock_counts{});
+    register_contended<bench::multi_lock_alg, tla::adaptive_timed_mutex>(lock_counts{});
+#endif
+    return true;
+}
+
+// sharded_shared_timed_mutex counts the readers of each thread in its own cache line instead of in one shared word
+template <class... Ms>
+bool register_readers() {
+    (benchmark::RegisterBenchmark((std::string("Readers/") + mutex_name<Ms>).c_str(), BM_Readers<Ms>)
+         ->ArgName("write_every")
+         ->Arg(0)
+         ->Arg(1000)
+         ->ThreadRange(8, 128)
+         ->UseRealTime(),
+     ...);
+    return true;
+}
+
+[[maybe_unused]] const bool registered =
+    register_all<bench::try_lock_for_alg,
+                 try_lock_until_alg,
+                 bench::multi_lock_alg,
+                 std_lock_alg,
+                 std_scoped_lock_alg>() &&
+    register_backoffs<with_spin, with_exponential, with_sleep>() && register_futex() && register_adaptive() &&
+    register_readers<std::shared_timed_mutex, tla::sharded_shared_timed_mutex>();
+} // namespace
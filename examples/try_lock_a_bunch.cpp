@@ -54,7 +54,7 @@ int main() {
         std::cout << "trying for " << ms.count() << "ms\n";
 
         auto start = std::chrono::steady_clock::now();
-        auto r1    = std::apply([&](auto&... mxs) { return tla::try_lock_for(ms, mxs...); }, mtxs);
+        auto r1    = tla::try_lock_for(ms, mtxs);
         auto end   = std::chrono::steady_clock::now();
 
         // should be done in approx. 10, 30, 40 and 40 ms, where the two last tries succeeds:
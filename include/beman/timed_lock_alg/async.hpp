@@ -0,0 +1,407 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_ASYNC_HPP
+#define BEMAN_TIMED_LOCK_ALG_ASYNC_HPP
+
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define BEMAN_TIMED_LOCK_ALG_HAS_COROUTINES 1
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace beman::timed_lock_alg {
+class async_timed_mutex;
+
+// Schedulers an async_timed_mutex can resume the coroutines waiting for it on. s.schedule(h) arranges for h to be
+// resumed later on a thread of the scheduler, e.g. the I/O thread that suspended it, and must not throw.
+template <class S>
+concept async_scheduler = requires(S& s, std::coroutine_handle<> h) { s.schedule(h); };
+
+namespace detail {
+// Resumes coroutines through a type-erased async_scheduler, or inline if there is none.
+struct async_resumer {
+    void* scheduler = nullptr;
+    void (*schedule)(void*, std::coroutine_handle<>) = nullptr;
+
+    template <async_scheduler S>
+    static async_resumer of(S& s) noexcept {
+        return {std::addressof(s), [](void* p, std::coroutine_handle<> h) { static_cast<S*>(p)->schedule(h); }};
+    }
+
+    void operator()(std::coroutine_handle<> h) const noexcept {
+        if (schedule != nullptr) {
+            schedule(scheduler, h);
+        } else {
+            h.resume();
+        }
+    }
+};
+
+// A coroutine or thread waiting for an async_timed_mutex. The fields are guarded by the internal lock of the mutex
+// except timer_firing which is guarded by the timer thread.
+struct async_waiter {
+    enum class status { waiting, acquired, timed_out };
+
+    async_timed_mutex* owner = nullptr;
+    // called without holding any lock when the outcome is decided
+    void (*complete)(async_waiter&) noexcept = nullptr;
+    void*                                 context  = nullptr;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    status                                result   = status::waiting;
+    async_waiter*                         prev     = nullptr;
+    async_waiter*                         next     = nullptr;
+    bool                                  timer_firing = false;
+};
+
+struct async_access;
+} // namespace detail
+
+// A lazily started coroutine producing a T. It is started by co_awaiting it and resumes the awaiting coroutine when
+// it's done.
+template <class T>
+class [[nodiscard]] lock_task {
+  public:
+    struct promise_type {
+        T                       value{};
+        std::exception_ptr      exception;
+        std::coroutine_handle<> continuation;
+
+        lock_task get_return_object() noexcept {
+            return lock_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct final_awaiter {
+            bool                    await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                return h.promise().continuation;
+            }
+            void await_resume() noexcept {}
+        };
+        final_awaiter final_suspend() noexcept { return {}; }
+
+        void return_value(T v) noexcept(std::is_nothrow_move_assignable_v<T>) { value = std::move(v); }
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+
+    lock_task(lock_task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    lock_task& operator=(lock_task&& other) noexcept {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+    ~lock_task() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool                    await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+                handle.promise().continuation = continuation;
+                return handle;
+            }
+            T await_resume() {
+                if (handle.promise().exception) {
+                    std::rethrow_exception(handle.promise().exception);
+                }
+                return std::move(handle.promise().value);
+            }
+        };
+        return awaiter{m_handle};
+    }
+
+  private:
+    explicit lock_task(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace detail {
+template <class Ptrs>
+lock_task<int> async_try_lock_until_impl(std::chrono::steady_clock::time_point tp, Ptrs ms, async_resumer resumer);
+} // namespace detail
+
+// A timed mutex that suspends coroutines waiting for it instead of blocking the thread:
+//
+//     if (co_await m.async_try_lock_for(100ms)) { ... }
+//
+// Waiters get the mutex in FIFO order. The awaitables taking an async_scheduler resume the coroutine through it when
+// it gets the mutex or times out. The others resume it on the thread unlocking the mutex, or on a timer thread owned
+// by the library when it times out, so they are only suitable for coroutines that don't block. A thread resuming
+// coroutines this way resumes the ones handed over by their unlocks after they suspend or finish rather than inside
+// them, so a coroutine must not block on a mutex it unlocked while it holds the thread. It's also a TimedLockable
+// with blocking lock/try_lock_until.
+class async_timed_mutex {
+  public:
+    class lock_awaiter;
+
+    async_timed_mutex() noexcept                           = default;
+    async_timed_mutex(const async_timed_mutex&)            = delete;
+    async_timed_mutex& operator=(const async_timed_mutex&) = delete;
+
+    bool try_lock() noexcept {
+        std::uint32_t expected = unlocked;
+        return m_state.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void lock();
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        return try_lock_until(std::chrono::steady_clock::now() + dur);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        return try_lock() || try_lock_until_steady(detail::to_steady(tp));
+    }
+
+#if defined(__cpp_lib_jthread)
+    // Like try_lock_until, but gives up without locking as soon as a stop is requested on st.
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::stop_token& st, const std::chrono::time_point<Clock, Duration>& tp) {
+        return not st.stop_requested() && (try_lock() || try_lock_until_steady(detail::to_steady(tp), st));
+    }
+#endif
+
+    void unlock() {
+        std::uint32_t expected = locked;
+        if (not m_state.compare_exchange_strong(
+                expected, unlocked, std::memory_order_release, std::memory_order_relaxed)) {
+            unlock_slow();
+        }
+    }
+
+    // awaitables resulting in true if the mutex was acquired
+    [[nodiscard]] lock_awaiter async_lock() noexcept;
+
+    template <async_scheduler S>
+    [[nodiscard]] lock_awaiter async_lock(S& sched) noexcept;
+
+    template <class Clock, class Duration>
+    [[nodiscard]] lock_awaiter async_try_lock_until(const std::chrono::time_point<Clock, Duration>& tp);
+
+    template <class Clock, class Duration, async_scheduler S>
+    [[nodiscard]] lock_awaiter async_try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, S& sched);
+
+    template <class Rep, class Period>
+    [[nodiscard]] lock_awaiter async_try_lock_for(const std::chrono::duration<Rep, Period>& dur);
+
+    template <class Rep, class Period, async_scheduler S>
+    [[nodiscard]] lock_awaiter async_try_lock_for(const std::chrono::duration<Rep, Period>& dur, S& sched);
+
+  private:
+    friend struct detail::async_access;
+
+    bool try_lock_until_steady(std::chrono::steady_clock::time_point tp);
+#if defined(__cpp_lib_jthread)
+    bool try_lock_until_steady(std::chrono::steady_clock::time_point tp, const std::stop_token& st);
+#endif
+    void unlock_slow();
+    // returns false if the waiter didn't have to wait
+    bool enqueue(detail::async_waiter& w);
+    void remove(detail::async_waiter& w) noexcept;
+
+    // the states of m_state
+    static constexpr std::uint32_t unlocked = 0;
+    static constexpr std::uint32_t locked   = 1;
+    static constexpr std::uint32_t waiters  = 2; // locked and the waiter list is not empty
+
+    std::atomic<std::uint32_t> m_state{unlocked};
+    std::mutex                 m_mtx; // guards the waiter list
+    detail::async_waiter*      m_head = nullptr;
+    detail::async_waiter*      m_tail = nullptr;
+};
+
+class async_timed_mutex::lock_awaiter {
+  public:
+    lock_awaiter(const lock_awaiter&)            = delete;
+    lock_awaiter& operator=(const lock_awaiter&) = delete;
+
+    bool await_ready() noexcept {
+        if (m_waiter.owner->try_lock()) {
+            m_waiter.result = detail::async_waiter::status::acquired;
+            return true;
+        }
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        m_handle          = handle;
+        m_waiter.context  = this;
+        m_waiter.complete = &resume;
+        return m_waiter.owner->enqueue(m_waiter);
+    }
+
+    bool await_resume() const noexcept { return m_waiter.result == detail::async_waiter::status::acquired; }
+
+  private:
+    friend class async_timed_mutex;
+    template <class Ptrs>
+    friend lock_task<int>
+    detail::async_try_lock_until_impl(std::chrono::steady_clock::time_point tp, Ptrs ms, detail::async_resumer resumer);
+
+    lock_awaiter(async_timed_mutex&                    m,
+                 std::chrono::steady_clock::time_point tp,
+                 detail::async_resumer                 resumer = {}) noexcept
+        : m_resumer(resumer) {
+        m_waiter.owner    = std::addressof(m);
+        m_waiter.deadline = tp;
+    }
+
+    static void resume(detail::async_waiter& w) noexcept {
+        auto& self = *static_cast<lock_awaiter*>(w.context);
+        self.m_resumer(self.m_handle);
+    }
+
+    detail::async_waiter    m_waiter;
+    std::coroutine_handle<> m_handle;
+    detail::async_resumer   m_resumer;
+};
+
+inline async_timed_mutex::lock_awaiter async_timed_mutex::async_lock() noexcept {
+    return lock_awaiter(*this, std::chrono::steady_clock::time_point::max());
+}
+
+template <async_scheduler S>
+async_timed_mutex::lock_awaiter async_timed_mutex::async_lock(S& sched) noexcept {
+    return lock_awaiter(*this, std::chrono::steady_clock::time_point::max(), detail::async_resumer::of(sched));
+}
+
+template <class Clock, class Duration>
+async_timed_mutex::lock_awaiter
+async_timed_mutex::async_try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+    return lock_awaiter(*this, detail::to_steady(tp));
+}
+
+template <class Clock, class Duration, async_scheduler S>
+async_timed_mutex::lock_awaiter
+async_timed_mutex::async_try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, S& sched) {
+    return lock_awaiter(*this, detail::to_steady(tp), detail::async_resumer::of(sched));
+}
+
+template <class Rep, class Period>
+async_timed_mutex::lock_awaiter async_timed_mutex::async_try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+    return lock_awaiter(*this, std::chrono::steady_clock::now() + dur);
+}
+
+template <class Rep, class Period, async_scheduler S>
+async_timed_mutex::lock_awaiter
+async_timed_mutex::async_try_lock_for(const std::chrono::duration<Rep, Period>& dur, S& sched) {
+    return lock_awaiter(*this, std::chrono::steady_clock::now() + dur, detail::async_resumer::of(sched));
+}
+
+namespace detail {
+// The rotation algorithm of try_lock_until_impl where the timed wait suspends the coroutine. No backoff is needed
+// between rounds since the coroutine is suspended until the lead mutex is handed over.
+template <class Ptrs>
+lock_task<int> async_try_lock_until_impl(std::chrono::steady_clock::time_point tp, Ptrs ms, async_resumer resumer) {
+    const auto n    = static_cast<std::size_t>(std::ranges::size(ms));
+    const auto next = [n](std::size_t i) { return i + 1 == n ? 0 : i + 1; };
+    if (n == 0) {
+        co_return -1;
+    }
+
+    std::size_t idx = 0;
+    while (true) {
+        // not awaited in the condition, which is miscompiled by some versions of GCC
+        const bool acquired = co_await async_timed_mutex::lock_awaiter(*ms[idx], tp, resumer);
+        if (not acquired) {
+            co_return static_cast<int>(idx); // timeout
+        }
+        std::size_t fail = next(idx);
+        for (; fail != idx && ms[fail]->try_lock(); fail = next(fail)) {
+        }
+        if (fail == idx) {
+            co_return -1; // success
+        }
+        for (std::size_t i = idx; i != fail; i = next(i)) {
+            ms[i]->unlock();
+        }
+        // start with the one that failed next round
+        idx = fail;
+    }
+}
+} // namespace detail
+
+// Awaitable versions of try_lock_until/try_lock_for for async_timed_mutexes with the same result. The ones taking an
+// async_scheduler resume the awaiting coroutine through it.
+template <class Clock, class Duration, std::same_as<async_timed_mutex>... Ms>
+lock_task<int> async_try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, Ms&... ms) {
+    return detail::async_try_lock_until_impl(
+        detail::to_steady(tp), std::array<async_timed_mutex*, sizeof...(Ms)>{std::addressof(ms)...}, {});
+}
+
+template <async_scheduler S, class Clock, class Duration, std::same_as<async_timed_mutex>... Ms>
+lock_task<int> async_try_lock_until(S& sched, const std::chrono::time_point<Clock, Duration>& tp, Ms&... ms) {
+    return detail::async_try_lock_until_impl(detail::to_steady(tp),
+                                             std::array<async_timed_mutex*, sizeof...(Ms)>{std::addressof(ms)...},
+                                             detail::async_resumer::of(sched));
+}
+
+template <class Rep, class Period, std::same_as<async_timed_mutex>... Ms>
+lock_task<int> async_try_lock_for(const std::chrono::duration<Rep, Period>& dur, Ms&... ms) {
+    return async_try_lock_until(std::chrono::steady_clock::now() + dur, ms...);
+}
+
+template <async_scheduler S, class Rep, class Period, std::same_as<async_timed_mutex>... Ms>
+lock_task<int> async_try_lock_for(S& sched, const std::chrono::duration<Rep, Period>& dur, Ms&... ms) {
+    return async_try_lock_until(sched, std::chrono::steady_clock::now() + dur, ms...);
+}
+
+namespace detail {
+template <class R>
+std::vector<async_timed_mutex*> async_mutex_ptrs(R& r) {
+    std::vector<async_timed_mutex*> ms;
+    ms.reserve(static_cast<std::size_t>(std::ranges::size(r)));
+    for (auto&& m : r) {
+        ms.push_back(std::addressof(lockable_ref(m)));
+    }
+    return ms;
+}
+} // namespace detail
+
+template <class Clock, class Duration, std::ranges::random_access_range R>
+    requires std::ranges::sized_range<R> && std::same_as<detail::range_lockable_t<R>, async_timed_mutex>
+lock_task<int> async_try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, R&& r) {
+    return detail::async_try_lock_until_impl(detail::to_steady(tp), detail::async_mutex_ptrs(r), {});
+}
+
+template <async_scheduler S, class Clock, class Duration, std::ranges::random_access_range R>
+    requires std::ranges::sized_range<R> && std::same_as<detail::range_lockable_t<R>, async_timed_mutex>
+lock_task<int> async_try_lock_until(S& sched, const std::chrono::time_point<Clock, Duration>& tp, R&& r) {
+    return detail::async_try_lock_until_impl(
+        detail::to_steady(tp), detail::async_mutex_ptrs(r), detail::async_resumer::of(sched));
+}
+
+template <class Rep, class Period, std::ranges::random_access_range R>
+    requires std::ranges::sized_range<R> && std::same_as<detail::range_lockable_t<R>, async_timed_mutex>
+lock_task<int> async_try_lock_for(const std::chrono::duration<Rep, Period>& dur, R&& r) {
+    return async_try_lock_until(std::chrono::steady_clock::now() + dur, r);
+}
+
+template <async_scheduler S, class Rep, class Period, std::ranges::random_access_range R>
+    requires std::ranges::sized_range<R> && std::same_as<detail::range_lockable_t<R>, async_timed_mutex>
+lock_task<int> async_try_lock_for(S& sched, const std::chrono::duration<Rep, Period>& dur, R&& r) {
+    return async_try_lock_until(sched, std::chrono::steady_clock::now() + dur, r);
+}
+} // namespace beman::timed_lock_alg
+
+#endif
+#endif
@@ -0,0 +1,158 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_BACKOFF_HPP
+#define BEMAN_TIMED_LOCK_ALG_BACKOFF_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace beman::timed_lock_alg::detail {
+// A backoff policy is called with the deadline after every failed round of the timed lock algorithms, right
+// before the next round starts. The algorithms take the policy by value so each call starts with a fresh state.
+template <class B, class Timepoint>
+concept BackoffPolicy = std::copy_constructible<B> && requires(B& b, const Timepoint& tp) { b(tp); };
+
+// the number of failed rounds after which a call escalates to the ordered acquisition, 0 for never
+template <class Backoff>
+constexpr std::size_t escalation_rounds_of(const Backoff& backoff) noexcept {
+    if constexpr (requires { backoff.escalation_rounds(); }) {
+        return backoff.escalation_rounds();
+    } else {
+        return 0;
+    }
+}
+
+inline void cpu_relax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(_MSC_VER) && (defined(_M_ARM64) || defined(_M_ARM))
+    __yield();
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+    asm volatile("yield");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+} // namespace beman::timed_lock_alg::detail
+
+namespace beman::timed_lock_alg {
+// Gives up the rest of the time slice. This is the default.
+struct yield_backoff {
+    template <class Timepoint>
+    void operator()(const Timepoint&) const noexcept {
+        std::this_thread::yield();
+    }
+};
+
+// Spins a fixed number of iterations with a cpu pause/yield instruction without giving up the core.
+// Suitable when the lockables are held for very short periods and every thread has its own core.
+struct spin_backoff {
+    unsigned spins = 64;
+
+    template <class Timepoint>
+    void operator()(const Timepoint&) const noexcept {
+        for (unsigned i = 0; i < spins; ++i) {
+            detail::cpu_relax();
+        }
+    }
+};
+
+// Spins for min_spins (4 by default) iterations after the first failed round and doubles the spin count after every
+// failed round. When the spin count exceeds max_spins (1024 by default, at most UINT_MAX - 1), it yields instead.
+class exponential_backoff {
+  public:
+    constexpr exponential_backoff() noexcept = default;
+    constexpr exponential_backoff(unsigned min_spins, unsigned max_spins) noexcept
+        : m_spins(std::max(min_spins, 1u)),
+          m_max_spins(std::min(max_spins, std::numeric_limits<unsigned>::max() - 1)) {}
+
+    template <class Timepoint>
+    void operator()(const Timepoint&) noexcept {
+        if (m_spins > m_max_spins) {
+            std::this_thread::yield();
+            return;
+        }
+        for (unsigned i = 0; i < m_spins; ++i) {
+            detail::cpu_relax();
+        }
+        // saturates instead of wrapping around to 0
+        m_spins = m_spins > m_max_spins / 2 ? m_max_spins + 1 : m_spins * 2;
+    }
+
+  private:
+    unsigned m_spins     = 4;
+    unsigned m_max_spins = 1024;
+};
+
+// Sleeps initial (1us by default, at least 1ns) after the first failed round and doubles the sleep time after every
+// failed round up to max (1ms by default). It never sleeps past the deadline.
+class sleep_backoff {
+  public:
+    constexpr sleep_backoff() noexcept = default;
+    constexpr sleep_backoff(std::chrono::nanoseconds initial, std::chrono::nanoseconds max) noexcept
+        : m_current(std::max(initial, std::chrono::nanoseconds(1))), m_max(max) {}
+
+    template <class Clock, class Duration>
+    void operator()(const std::chrono::time_point<Clock, Duration>& tp) {
+        const auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(tp - Clock::now());
+        if (left > left.zero()) {
+            std::this_thread::sleep_for(std::min(left, m_current));
+        }
+        m_current = m_current > m_max / 2 ? m_max : m_current * 2;
+    }
+
+  private:
+    std::chrono::nanoseconds m_current = std::chrono::microseconds(1);
+    std::chrono::nanoseconds m_max     = std::chrono::milliseconds(1);
+};
+
+// Behaves like Backoff for the first rounds. After rounds failed rounds (at least 1), the timed lock algorithms stop
+// releasing everything after a failed round and instead acquire the lockables one by one in address order, waiting
+// for each until the deadline like ordered_lock. A waiter that kept losing rounds then holds on to what it got and
+// can't be overtaken again. This is deadlock-free also when other threads use the rotating algorithm since those never
+// block while holding a lockable, and with ordered_lock. It must not be mixed with ordered_by(key) on overlapping
+// lock sets unless key orders like the addresses, or an escalated waiter and an ordered one may each hold what the
+// other waits for until the deadline. An observer attached to Backoff with observe() stays attached.
+template <class Backoff = yield_backoff>
+class escalating_backoff {
+  public:
+    constexpr explicit escalating_backoff(std::size_t rounds, Backoff backoff = {}) noexcept(
+        std::is_nothrow_move_constructible_v<Backoff>)
+        : m_rounds(std::max<std::size_t>(rounds, 1)), m_backoff(std::move(backoff)) {}
+
+    template <class Timepoint>
+    void operator()(const Timepoint& tp) {
+        m_backoff(tp);
+    }
+
+    constexpr std::size_t escalation_rounds() const noexcept { return m_rounds; }
+
+    decltype(auto) observer() const noexcept
+        requires requires(const Backoff& b) { b.observer(); }
+    {
+        return m_backoff.observer();
+    }
+
+  private:
+    std::size_t m_rounds;
+    Backoff     m_backoff;
+};
+
+template <class Backoff = yield_backoff>
+constexpr escalating_backoff<Backoff> escalate_after(std::size_t rounds, Backoff backoff = {}) {
+    return escalating_backoff<Backoff>(rounds, std::move(backoff));
+}
+} // namespace beman::timed_lock_alg
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_CONDITION_VARIABLE_HPP
+#define BEMAN_TIMED_LOCK_ALG_CONDITION_VARIABLE_HPP
+
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <system_error>
+#include <utility>
+
+namespace beman::timed_lock_alg {
+namespace detail {
+// multi_lock, multi_shared_lock and dynamic_multi_lock
+template <class L>
+concept RelockableLockSet = requires(L& l) {
+    { l.owns_lock() } -> std::same_as<bool>;
+    l.unlock();
+    l.lock();
+    { l.try_lock_until(std::chrono::steady_clock::time_point{}) } -> std::same_as<int>;
+};
+
+// A thread waiting on a multi_lock_condition_variable. It lives on the stack of the waiting thread.
+struct cv_waiter {
+    enum class status { waiting, notified, woken };
+
+    std::condition_variable cv;
+    status                  state = status::waiting;
+    cv_waiter*              prev  = nullptr;
+    cv_waiter*              next  = nullptr;
+};
+
+class cv_waiter_queue {
+  public:
+    bool       empty() const noexcept { return m_head == nullptr; }
+    void       push_back(cv_waiter& w) noexcept;
+    cv_waiter& pop_front() noexcept;
+    void       erase(cv_waiter& w) noexcept;
+
+  private:
+    cv_waiter* m_head = nullptr;
+    cv_waiter* m_tail = nullptr;
+};
+} // namespace detail
+
+// A condition variable waited on with a multi_lock, multi_shared_lock or dynamic_multi_lock. Waiting releases all
+// lockables of the lock atomically with respect to notify_one/notify_all, and reacquires them with the deadlock-free
+// algorithms of this library: lock() without a deadline, try_lock_until with the deadline of the wait otherwise.
+//
+// When the deadline passes before the lockables could be reacquired, the timed waits return with the lock not
+// owning them, which callers have to check with owns_lock() before touching the protected data.
+//
+// notify_all wakes the waiters in batches: at most batch_size() of them are reacquiring their locks at a time, and
+// each one wakes the next waiter once it got its locks or gave up. This keeps a crowd of waiters from piling onto the
+// same lockables, at the cost of the later ones waking up a little later.
+class multi_lock_condition_variable {
+  public:
+    // Constructors
+    explicit multi_lock_condition_variable(std::size_t batch_size = 1) noexcept
+        : m_batch_size(batch_size == 0 ? 1 : batch_size) {}
+
+    multi_lock_condition_variable(const multi_lock_condition_variable&)            = delete;
+    multi_lock_condition_variable& operator=(const multi_lock_condition_variable&) = delete;
+
+    // Notification
+    void notify_one() noexcept;
+    void notify_all() noexcept;
+
+    // Waiting
+    template <detail::RelockableLockSet Lock>
+    void wait(Lock& lock) {
+        detail::cv_waiter w;
+        release_and_block(lock, w, nullptr);
+        reacquire_guard guard{*this, w};
+        lock.lock();
+    }
+
+    template <detail::RelockableLockSet Lock, class Predicate>
+    void wait(Lock& lock, Predicate pred) {
+        while (not pred()) {
+            wait(lock);
+        }
+    }
+
+    // Returns timeout if the deadline passed before a notification or before the lockables were reacquired. In the
+    // latter case, the lock doesn't own them.
+    template <detail::RelockableLockSet Lock, class Clock, class Duration>
+    std::cv_status wait_until(Lock& lock, const std::chrono::time_point<Clock, Duration>& tp) {
+        const auto        steady_tp = detail::to_steady(tp);
+        detail::cv_waiter w;
+        release_and_block(lock, w, &steady_tp);
+        int rv = -1;
+        {
+            reacquire_guard guard{*this, w};
+            rv = lock.try_lock_until(tp);
+        }
+        return rv == -1 && w.state != detail::cv_waiter::status::waiting ? std::cv_status::no_timeout
+                                                                         : std::cv_status::timeout;
+    }
+
+    // Returns pred() once it holds, or false if the deadline passed. pred is only called with the lockables owned,
+    // so false with owns_lock() false means they could not be reacquired in time.
+    template <detail::RelockableLockSet Lock, class Clock, class Duration, class Predicate>
+    bool wait_until(Lock& lock, const std::chrono::time_point<Clock, Duration>& tp, Predicate pred) {
+        while (not pred()) {
+            if (wait_until(lock, tp) == std::cv_status::timeout) {
+                return lock.owns_lock() && pred();
+            }
+        }
+        return true;
+    }
+
+    template <detail::RelockableLockSet Lock, class Rep, class Period>
+    std::cv_status wait_for(Lock& lock, const std::chrono::duration<Rep, Period>& dur) {
+        return wait_until(lock, std::chrono::steady_clock::now() + dur);
+    }
+
+    template <detail::RelockableLockSet Lock, class Rep, class Period, class Predicate>
+    bool wait_for(Lock& lock, const std::chrono::duration<Rep, Period>& dur, Predicate pred) {
+        return wait_until(lock, std::chrono::steady_clock::now() + dur, std::move(pred));
+    }
+
+    // Observers
+    std::size_t batch_size() const noexcept { return m_batch_size; }
+
+  private:
+    // lets the next notified waiter go once the waiter got its lockables back or gave up, even by an exception
+    struct reacquire_guard {
+        multi_lock_condition_variable& self;
+        detail::cv_waiter&             w;
+        ~reacquire_guard() { self.reacquired(w); }
+    };
+
+    template <class Lock>
+    void release_and_block(Lock& lock, detail::cv_waiter& w, const std::chrono::steady_clock::time_point* tp) {
+        if (not lock.owns_lock()) {
+            detail::throw_system_error(std::errc::operation_not_permitted);
+        }
+        std::unique_lock internal(m_mutex);
+        m_waiting.push_back(w);
+        // a notification can't get in between since notifying takes m_mutex
+        lock.unlock();
+        block(internal, w, tp);
+    }
+
+    // waits until w is woken, or until *tp unless tp is null
+    void block(std::unique_lock<std::mutex>&                internal,
+               detail::cv_waiter&                           w,
+               const std::chrono::steady_clock::time_point* tp);
+    void reacquired(detail::cv_waiter& w) noexcept;
+    // wakes notified waiters while fewer than batch_size are reacquiring
+    void dispatch() noexcept;
+
+    std::mutex              m_mutex;
+    detail::cv_waiter_queue m_waiting;
+    detail::cv_waiter_queue m_notified;
+    std::size_t             m_reacquiring = 0;
+    std::size_t             m_batch_size;
+};
+} // namespace beman::timed_lock_alg
+
+#endif
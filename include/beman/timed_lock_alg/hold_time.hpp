@@ -0,0 +1,111 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_HOLD_TIME_HPP
+#define BEMAN_TIMED_LOCK_ALG_HOLD_TIME_HPP
+
+#include <beman/timed_lock_alg/lock_order.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Hold-time measurement records how long multi_lock and dynamic_multi_lock keep their lockables, from a successful
+// acquisition to unlock() or destruction, in per-thread histograms per acquisition site. It is enabled by compiling
+// the whole program with BEMAN_TIMED_LOCK_ALG_HOLD_TIME_HISTOGRAMS defined (the CMake option of the same name).
+// Without it, the locks carry no timer. Ownership given up with release() is not measured.
+
+namespace beman::timed_lock_alg {
+namespace detail {
+struct hold_time_access;
+} // namespace detail
+
+// A histogram of durations with power-of-two buckets. Bucket 0 counts durations of 0ns and bucket i durations in
+// [2^(i-1), 2^i) ns.
+class hold_time_histogram {
+  public:
+    static constexpr std::size_t bucket_count = 64;
+
+    void record(std::chrono::nanoseconds dur) noexcept;
+    void merge(const hold_time_histogram& other) noexcept;
+
+    std::uint64_t            count() const noexcept { return m_count; }
+    std::chrono::nanoseconds total() const noexcept { return std::chrono::nanoseconds(m_total); }
+    std::chrono::nanoseconds max() const noexcept { return std::chrono::nanoseconds(m_max); }
+    std::chrono::nanoseconds mean() const noexcept;
+
+    // the upper bound of the bucket holding the p-th percentile (p in [0, 100]), 0 if empty
+    std::chrono::nanoseconds percentile(double p) const noexcept;
+
+    std::uint64_t bucket(std::size_t idx) const noexcept { return m_buckets[idx]; }
+    static std::chrono::nanoseconds bucket_upper_bound(std::size_t idx) noexcept;
+    static std::size_t              bucket_of(std::chrono::nanoseconds dur) noexcept;
+
+  private:
+    friend struct detail::hold_time_access;
+
+    std::array<std::uint64_t, bucket_count> m_buckets{};
+    std::uint64_t                           m_count = 0;
+    std::uint64_t                           m_total = 0;
+    std::uint64_t                           m_max   = 0;
+};
+
+// The hold times recorded for one acquisition site.
+struct hold_time_site {
+    std::string         file;
+    std::string         function;
+    std::uint_least32_t line = 0;
+    hold_time_histogram histogram;
+};
+
+// Merges the histograms of all threads, including those that exited, per site. The sites with the largest total hold
+// time come first. Hold times recorded concurrently may or may not be included.
+std::vector<hold_time_site> collect_hold_times();
+
+// Writes the merged histograms to os, one site per line with count, mean, p50, p99 and max.
+void dump_hold_times(std::ostream& os);
+
+// Forgets all recorded hold times, also of threads recording meanwhile. Hold times recorded concurrently may or may not
+// be kept.
+void reset_hold_times();
+
+// Records that the calling thread held lockables acquired at site for dur. May also be called for other locks.
+void record_hold_time(const lock_order_site& site, std::chrono::nanoseconds dur) noexcept;
+
+namespace detail {
+#if defined(BEMAN_TIMED_LOCK_ALG_HOLD_TIME_HISTOGRAMS)
+// measures the time from start to stop
+class hold_timer {
+  public:
+    void start(const lock_order_site& site) noexcept {
+        m_site    = site;
+        m_start   = std::chrono::steady_clock::now();
+        m_running = true;
+    }
+
+    void stop() noexcept {
+        if (m_running) {
+            m_running = false;
+            record_hold_time(m_site, std::chrono::steady_clock::now() - m_start);
+        }
+    }
+
+    void cancel() noexcept { m_running = false; }
+
+  private:
+    lock_order_site                       m_site{};
+    std::chrono::steady_clock::time_point m_start{};
+    bool                                  m_running = false;
+};
+#else
+struct hold_timer {
+    void start(const lock_order_site&) noexcept {}
+    void stop() noexcept {}
+    void cancel() noexcept {}
+};
+#endif
+} // namespace detail
+} // namespace beman::timed_lock_alg
+
+#endif
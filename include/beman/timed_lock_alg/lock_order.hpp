@@ -0,0 +1,99 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_LOCK_ORDER_HPP
+#define BEMAN_TIMED_LOCK_ALG_LOCK_ORDER_HPP
+
+#include <version>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#if defined(__cpp_lib_source_location)
+#include <source_location>
+#endif
+
+// The lock-order validator records in which order lockables are acquired across calls and reports acquisitions that
+// close a cycle, which can deadlock. multi_lock and dynamic_multi_lock feed it when the program is compiled with
+// BEMAN_TIMED_LOCK_ALG_LOCK_ORDER_VALIDATION defined (the CMake option of the same name), which must then be done for
+// the whole program. Without it, they don't call into the validator at all.
+
+namespace beman::timed_lock_alg {
+// Where a lockable was acquired. The locking constructors and member functions of multi_lock and dynamic_multi_lock
+// report their caller.
+#if defined(__cpp_lib_source_location)
+using lock_order_site = std::source_location;
+#else
+struct lock_order_site {
+    static constexpr lock_order_site current() noexcept { return {}; }
+    constexpr const char*            file_name() const noexcept { return ""; }
+    constexpr const char*            function_name() const noexcept { return ""; }
+    constexpr std::uint_least32_t    line() const noexcept { return 0; }
+    constexpr std::uint_least32_t    column() const noexcept { return 0; }
+};
+#endif
+
+// held was held by thread when acquired was acquired.
+struct lock_order_edge {
+    const void*     held;
+    const void*     acquired;
+    lock_order_site held_at;
+    lock_order_site acquired_at;
+    std::thread::id thread;
+};
+
+// A cycle in the acquisition order. Each edge leads from the lockable the previous one acquired and the last one is
+// the acquisition that closed the cycle.
+struct lock_order_cycle {
+    std::vector<lock_order_edge> edges;
+};
+
+using lock_order_handler = std::function<void(const lock_order_cycle&)>;
+
+// Called for each cycle found, outside of the validator's locks. The default handler prints the cycle to stderr.
+// Passing an empty handler restores it. An exception thrown by the handler is dropped, together with the cycles not
+// reported yet.
+void set_lock_order_handler(lock_order_handler handler);
+
+// Only one in every one_in acquisitions (1 by default, 0 stops recording) per thread adds edges to the graph, which
+// bounds the time spent under the validator's global lock. Held lockables are tracked for every acquisition.
+void set_lock_order_sampling(std::uint32_t one_in) noexcept;
+
+// Forgets all recorded edges.
+void reset_lock_order_graph();
+
+// Tells the validator that the calling thread acquired or released the lockables at the given addresses. The
+// lockables acquired in one call are taken to be acquired together, like multi_lock does, without order among them.
+// These may also be called for other locks. Acquisitions that can't be recorded for lack of memory are dropped.
+void lock_order_acquired(std::span<const void* const> lockables,
+                         lock_order_site              site = lock_order_site::current()) noexcept;
+void lock_order_released(std::span<const void* const> lockables) noexcept;
+
+namespace detail {
+// The number of lockables the calling thread holds if the acquisition starting now is sampled, 0 otherwise.
+std::size_t lock_order_holding() noexcept;
+
+// Records that lockable was acquired together with others while holding the first holding lockables of the thread.
+void lock_order_acquired_one(const void* lockable, std::size_t holding, const lock_order_site& site) noexcept;
+} // namespace detail
+
+// The same for lockables passed as pointers of their own type, such as the lock set of a dynamic_multi_lock, without
+// copying their addresses.
+template <class T>
+void lock_order_acquired(std::span<T* const> lockables, lock_order_site site = lock_order_site::current()) noexcept {
+    const std::size_t holding = detail::lock_order_holding();
+    for (const void* lockable : lockables) {
+        detail::lock_order_acquired_one(lockable, holding, site);
+    }
+}
+
+template <class T>
+void lock_order_released(std::span<T* const> lockables) noexcept {
+    for (const void* lockable : lockables) {
+        lock_order_released(std::span(&lockable, 1));
+    }
+}
+} // namespace beman::timed_lock_alg
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_LOCK_SET_EXECUTOR_HPP
+#define BEMAN_TIMED_LOCK_ALG_LOCK_SET_EXECUTOR_HPP
+
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace beman::timed_lock_alg {
+namespace detail {
+// A closure to run with a set of lockables locked, queued in a lock_set_executor.
+class lock_set_task {
+  public:
+    virtual ~lock_set_task() = default;
+
+    // locks the set, runs the closure, unlocks the set and completes the future of the task
+    virtual void run() noexcept = 0;
+
+    // the addresses of the lockables of the set, sorted and without duplicates
+    std::vector<const void*> keys;
+
+    // the number of keys for which a task submitted before this one is still queued or running
+    std::size_t blockers = 0;
+};
+
+// the deadline of tasks that wait for their locks as long as it takes
+struct no_lock_deadline {};
+
+template <class M, class Deadline, class F>
+class lock_set_task_for final : public lock_set_task {
+  public:
+    template <class R>
+    lock_set_task_for(R& r, const Deadline& deadline, F f)
+        : m_lock(std::defer_lock, unique_lockables(r)), m_deadline(deadline), m_f(std::move(f)) {
+        const auto ms = m_lock.mutex();
+        keys.assign(ms.begin(), ms.end());
+    }
+
+    std::future<bool> get_future() { return m_promise.get_future(); }
+
+    void run() noexcept override {
+        try {
+            bool locked = true;
+            if constexpr (std::same_as<Deadline, no_lock_deadline>) {
+                m_lock.lock();
+            } else {
+                locked = m_lock.try_lock_until(m_deadline) == -1;
+            }
+            if (locked) {
+                std::invoke(m_f);
+                m_lock.unlock();
+            }
+            m_promise.set_value(locked);
+        } catch (...) {
+            if (m_lock.owns_lock()) {
+                m_lock.unlock();
+            }
+            m_promise.set_exception(std::current_exception());
+        }
+    }
+
+  private:
+    // the lockables of r sorted by address, each once so that a lockable repeated in r isn't locked twice
+    template <class R>
+    static std::vector<M*> unique_lockables(R& r) {
+        std::vector<M*> ms;
+        for (auto&& elem : r) {
+            ms.push_back(std::addressof(lockable_ref(elem)));
+        }
+        std::sort(ms.begin(), ms.end(), std::less<>{});
+        ms.erase(std::unique(ms.begin(), ms.end()), ms.end());
+        return ms;
+    }
+
+    dynamic_multi_lock<M> m_lock;
+    Deadline              m_deadline;
+    F                     m_f;
+    std::promise<bool>    m_promise;
+};
+} // namespace detail
+
+// Runs closures on a pool of worker threads, each with a set of lockables locked. Tasks whose lock sets are disjoint
+// run in parallel. A task sharing a lockable with a running task, or with a task submitted before it that is still
+// queued, stays queued until that one is done instead of occupying a worker blocked on the lock, so tasks are
+// started in submission order per lockable and none is starved. Scheduling a task costs O(size of its lock set). The
+// locks are acquired with the deadlock-free algorithms of this library, so the lockables may also be locked by
+// threads outside the executor meanwhile.
+class lock_set_executor {
+  public:
+    // Constructors
+    // Starts threads worker threads, at least one.
+    explicit lock_set_executor(std::size_t threads = std::thread::hardware_concurrency());
+
+    // Destructor
+    // Runs the queued tasks and joins the workers. Submitting tasks meanwhile is not allowed.
+    ~lock_set_executor();
+
+    // Deleted copy and move operations
+    lock_set_executor(const lock_set_executor&)            = delete;
+    lock_set_executor& operator=(const lock_set_executor&) = delete;
+
+    // Submitting tasks
+    // Queues f to be called with all lockables of r, or of the pointers in r, locked. The returned future becomes
+    // true after f returned and the lockables were unlocked. If f throws, the future holds the exception.
+    template <std::ranges::input_range R, std::invocable<> F>
+        requires detail::LockableRangeOf<R, detail::range_lockable_t<R>>
+    std::future<bool> submit(R&& r, F&& f) {
+        return enqueue<detail::range_lockable_t<R>>(r, detail::no_lock_deadline{}, std::forward<F>(f));
+    }
+
+    // Like submit(r, f), but gives up if the lockables can't all be locked by tp, which the future reports as false.
+    // The time spent queued counts against the deadline.
+    template <class Clock, class Duration, std::ranges::input_range R, std::invocable<> F>
+        requires(detail::LockableRangeOf<R, detail::range_lockable_t<R>> &&
+                 detail::TimedLockable<detail::range_lockable_t<R>>)
+    std::future<bool> submit(const std::chrono::time_point<Clock, Duration>& tp, R&& r, F&& f) {
+        return enqueue<detail::range_lockable_t<R>>(r, tp, std::forward<F>(f));
+    }
+
+    template <class Rep, class Period, std::ranges::input_range R, std::invocable<> F>
+        requires(detail::LockableRangeOf<R, detail::range_lockable_t<R>> &&
+                 detail::TimedLockable<detail::range_lockable_t<R>>)
+    std::future<bool> submit(const std::chrono::duration<Rep, Period>& dur, R&& r, F&& f) {
+        return submit(std::chrono::steady_clock::now() + dur, r, std::forward<F>(f));
+    }
+
+    // Blocks until all submitted tasks are done.
+    void wait_idle();
+
+    // Observers
+    std::size_t thread_count() const noexcept { return m_threads.size(); }
+
+  private:
+    template <class M, class Deadline, class R, class F>
+    std::future<bool> enqueue(R& r, const Deadline& deadline, F&& f) {
+        auto task   = std::make_unique<detail::lock_set_task_for<M, Deadline, std::decay_t<F>>>(r, deadline,
+                                                                                                std::forward<F>(f));
+        auto future = task->get_future();
+        push(std::move(task));
+        return future;
+    }
+
+    void push(std::unique_ptr<detail::lock_set_task> task);
+
+    void work();
+
+    std::mutex              m_mutex;
+    std::condition_variable m_ready;
+    std::condition_variable m_idle;
+    // the tasks with no blockers, waiting for a worker
+    std::deque<std::unique_ptr<detail::lock_set_task>> m_runnable;
+    // the tasks using each key in submission order, starting with the running one. Tasks with blockers are owned by
+    // these queues.
+    std::unordered_map<const void*, std::deque<detail::lock_set_task*>> m_waiters;
+    // the submitted tasks that are not done yet
+    std::size_t              m_pending  = 0;
+    bool                     m_stopping = false;
+    std::vector<std::thread> m_threads;
+};
+} // namespace beman::timed_lock_alg
+
+#endif
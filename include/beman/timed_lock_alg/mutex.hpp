@@ -1,14 +1,44 @@
 #ifndef BEMAN_TIMED_LOCK_ALG_MUTEX_HPP
 #define BEMAN_TIMED_LOCK_ALG_MUTEX_HPP
 
+#include <beman/timed_lock_alg/backoff.hpp>
+#include <beman/timed_lock_alg/hold_time.hpp>
+#include <beman/timed_lock_alg/lock_order.hpp>
+#include <beman/timed_lock_alg/observer.hpp>
+#include <beman/timed_lock_alg/trace.hpp>
+
+#include <version>
+
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
 #include <mutex>
+#include <ranges>
+#include <span>
+#include <system_error>
 #include <thread>
 #include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#if defined(__cpp_lib_expected)
+#include <expected>
+#endif
+#if defined(__cpp_lib_jthread)
+#include <stop_token>
+#endif
 
 namespace beman::timed_lock_alg::detail {
 template <class T>
@@ -17,230 +47,2060 @@ concept BasicLockable = requires(T t) {
     t.unlock();
 };
 
-template <class T>
-concept Lockable = BasicLockable<T> && requires(T t) {
-    { t.try_lock() } -> std::same_as<bool>;
-};
+template <class T>
+concept Lockable = BasicLockable<T> && requires(T t) {
+    { t.try_lock() } -> std::same_as<bool>;
+};
+
+template <class T>
+concept TimedLockable = Lockable<T> && requires(T t) {
+    { t.try_lock_for(std::chrono::nanoseconds{}) } -> std::same_as<bool>;
+    { t.try_lock_for(std::chrono::microseconds{}) } -> std::same_as<bool>;
+    { t.try_lock_for(std::chrono::milliseconds{}) } -> std::same_as<bool>;
+    { t.try_lock_until(std::chrono::time_point<std::chrono::steady_clock>{}) } -> std::same_as<bool>;
+    { t.try_lock_until(std::chrono::time_point<std::chrono::system_clock>{}) } -> std::same_as<bool>;
+};
+
+// ranges may hold the lockables themselves or pointers to them
+template <class T>
+constexpr decltype(auto) lockable_ref(T&& t) noexcept {
+    if constexpr (std::is_pointer_v<std::remove_cvref_t<T>>) {
+        return *t;
+    } else {
+        return static_cast<T&>(t);
+    }
+}
+
+template <class R>
+using range_lockable_t =
+    std::remove_reference_t<decltype(lockable_ref(*std::ranges::begin(std::declval<R&>())))>;
+
+template <class R>
+concept TimedLockableRange = std::ranges::random_access_range<R> && std::ranges::sized_range<R> &&
+                             TimedLockable<range_lockable_t<R>>;
+
+// a range of lockables of type M, or of pointers to them
+template <class R, class M>
+concept LockableRangeOf =
+    std::ranges::input_range<R> && std::ranges::sized_range<R> && std::same_as<range_lockable_t<R>, M>;
+
+template <class T>
+concept SharedLockable = requires(T t) {
+    t.lock_shared();
+    { t.try_lock_shared() } -> std::same_as<bool>;
+    t.unlock_shared();
+};
+
+template <class T>
+concept SharedTimedLockable = SharedLockable<T> && requires(T t) {
+    { t.try_lock_shared_for(std::chrono::nanoseconds{}) } -> std::same_as<bool>;
+    { t.try_lock_shared_for(std::chrono::microseconds{}) } -> std::same_as<bool>;
+    { t.try_lock_shared_for(std::chrono::milliseconds{}) } -> std::same_as<bool>;
+    { t.try_lock_shared_until(std::chrono::time_point<std::chrono::steady_clock>{}) } -> std::same_as<bool>;
+    { t.try_lock_shared_until(std::chrono::time_point<std::chrono::system_clock>{}) } -> std::same_as<bool>;
+};
+
+template <class R>
+concept SharedTimedLockableRange = std::ranges::random_access_range<R> && std::ranges::sized_range<R> &&
+                                   SharedTimedLockable<range_lockable_t<R>>;
+
+// reports a misused lock; aborts when built without exceptions
+[[noreturn]] inline void throw_system_error(std::errc ec) {
+#if defined(__cpp_exceptions)
+    throw std::system_error(std::make_error_code(ec));
+#else
+    static_cast<void>(ec);
+    std::abort();
+#endif
+}
+
+} // namespace beman::timed_lock_alg::detail
+
+namespace beman::timed_lock_alg {
+// Refers to a lockable and presents its shared ownership operations as the exclusive ones. Passing shared(l) to
+// try_lock_until/try_lock_for or multi_lock acquires shared ownership of l together with exclusive ownership of the
+// other lockables.
+template <class L>
+class shared_lockable {
+  public:
+    using lockable_type = L;
+
+    shared_lockable() noexcept = default;
+    explicit shared_lockable(L& l) noexcept : m_l(std::addressof(l)) {}
+
+    void lock() const { m_l->lock_shared(); }
+    bool try_lock() const { return m_l->try_lock_shared(); }
+    void unlock() const { m_l->unlock_shared(); }
+
+    template <class Rep, class Period>
+        requires detail::SharedTimedLockable<L>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) const {
+        return m_l->try_lock_shared_for(dur);
+    }
+
+    template <class Clock, class Duration>
+        requires detail::SharedTimedLockable<L>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) const {
+        return m_l->try_lock_shared_until(tp);
+    }
+
+    L* get() const noexcept { return m_l; }
+
+  private:
+    L* m_l = nullptr;
+};
+
+// The result is const so that it binds to the Ls&... parameters of the algorithms and multi_lock.
+template <detail::SharedLockable L>
+[[nodiscard]] const shared_lockable<L> shared(L& l) noexcept {
+    return shared_lockable<L>(l);
+}
+} // namespace beman::timed_lock_alg
+
+namespace beman::timed_lock_alg::detail {
+template <class T>
+inline constexpr bool is_shared_lockable_v = false;
+template <class L>
+inline constexpr bool is_shared_lockable_v<shared_lockable<L>> = true;
+template <class L>
+inline constexpr bool is_shared_lockable_v<const shared_lockable<L>> = true;
+
+template <class L>
+class stoppable_lockable;
+
+template <class T>
+inline constexpr bool is_stoppable_lockable_v = false;
+template <class L>
+inline constexpr bool is_stoppable_lockable_v<stoppable_lockable<L>> = true;
+
+// the lockable passed by the user, used for computing ordering keys
+template <class T>
+constexpr auto& underlying_lockable(T& l) noexcept {
+    if constexpr (is_stoppable_lockable_v<T>) {
+        return underlying_lockable(*l.get());
+    } else if constexpr (is_shared_lockable_v<T>) {
+        return *l.get();
+    } else {
+        return l;
+    }
+}
+
+template <class T>
+using underlying_lockable_t = std::remove_reference_t<decltype(underlying_lockable(std::declval<T&>()))>;
+
+// multi_lock refers to lockables by pointer and stores shared_lockables, which are temporaries, by value
+template <class M>
+using lockable_handle_t = std::conditional_t<is_shared_lockable_v<M>, std::remove_const_t<M>, M*>;
+
+template <class M>
+constexpr lockable_handle_t<M> make_lockable_handle(M& m) noexcept {
+    if constexpr (is_shared_lockable_v<M>) {
+        return m;
+    } else {
+        return std::addressof(m);
+    }
+}
+
+template <class H>
+constexpr auto& handle_ref(const H& h) noexcept {
+    if constexpr (std::is_pointer_v<H>) {
+        return *h;
+    } else {
+        return h;
+    }
+}
+
+template <class H>
+constexpr auto handle_ptr(const H& h) noexcept {
+    if constexpr (std::is_pointer_v<H>) {
+        return h;
+    } else {
+        return h.get();
+    }
+}
+
+// whether multi_lock and dynamic_multi_lock feed the lock-order validator
+inline constexpr bool validate_lock_order =
+#if defined(BEMAN_TIMED_LOCK_ALG_LOCK_ORDER_VALIDATION)
+    true;
+#else
+    false;
+#endif
+
+// converts tp to a steady_clock time point for mutexes that implement their timed waits with steady_clock only
+template <class Clock, class Duration>
+std::chrono::steady_clock::time_point to_steady(const std::chrono::time_point<Clock, Duration>& tp) {
+    if constexpr (std::same_as<Clock, std::chrono::steady_clock>) {
+        return std::chrono::ceil<std::chrono::steady_clock::duration>(tp);
+    } else {
+        return std::chrono::steady_clock::now() +
+               std::chrono::ceil<std::chrono::steady_clock::duration>(tp - Clock::now());
+    }
+}
+} // namespace beman::timed_lock_alg::detail
+
+#if defined(__linux__)
+#define BEMAN_TIMED_LOCK_ALG_HAS_FUTEX_TIMED_MUTEX 1
+#define BEMAN_TIMED_LOCK_ALG_HAS_ADAPTIVE_TIMED_MUTEX 1
+
+namespace beman::timed_lock_alg {
+class futex_timed_mutex;
+
+namespace detail {
+struct futex_access;
+
+int futex_try_lock_until(std::chrono::steady_clock::time_point tp, std::span<futex_timed_mutex* const> ms);
+int futex_try_lock_until(std::chrono::steady_clock::time_point tp, std::span<futex_timed_mutex> ms);
+
+bool futex_try_lock_k_until(std::chrono::steady_clock::time_point tp,
+                            std::span<futex_timed_mutex* const>   ms,
+                            std::span<std::size_t>                out);
+bool futex_try_lock_k_until(std::chrono::steady_clock::time_point tp,
+                            std::span<futex_timed_mutex>          ms,
+                            std::span<std::size_t>                out);
+} // namespace detail
+
+// A TimedLockable mutex built on a Linux futex word. When try_lock_until/try_lock_for is used with only
+// futex_timed_mutexes, a failed round sleeps on all the contended mutexes at once with futex_waitv (Linux 5.16+)
+// instead of on only the one that failed.
+class futex_timed_mutex {
+  public:
+    futex_timed_mutex() noexcept                           = default;
+    futex_timed_mutex(const futex_timed_mutex&)            = delete;
+    futex_timed_mutex& operator=(const futex_timed_mutex&) = delete;
+
+    void lock();
+
+    bool try_lock() noexcept {
+        std::uint32_t expected = unlocked;
+        return m_state.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        return try_lock_until(std::chrono::steady_clock::now() + dur);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        return try_lock() || try_lock_until_steady(detail::to_steady(tp));
+    }
+
+#if defined(__cpp_lib_jthread)
+    // Like try_lock_until, but gives up without locking as soon as a stop is requested on st.
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::stop_token& st, const std::chrono::time_point<Clock, Duration>& tp) {
+        return not st.stop_requested() && (try_lock() || try_lock_until_steady(detail::to_steady(tp), st));
+    }
+#endif
+
+    void unlock() noexcept {
+        if (m_state.exchange(unlocked, std::memory_order_release) == contended) {
+            wake_one();
+        }
+    }
+
+  private:
+    friend struct detail::futex_access;
+
+    bool try_lock_until_steady(std::chrono::steady_clock::time_point tp);
+#if defined(__cpp_lib_jthread)
+    bool try_lock_until_steady(std::chrono::steady_clock::time_point tp, const std::stop_token& st);
+#endif
+    void wake_one() noexcept;
+
+    // the states of the futex word
+    static constexpr std::uint32_t unlocked  = 0;
+    static constexpr std::uint32_t locked    = 1;
+    static constexpr std::uint32_t contended = 2; // locked and there may be waiters
+
+    std::atomic<std::uint32_t> m_state{unlocked};
+};
+
+// A TimedLockable mutex for short critical sections. A thread finding it locked spins for twice the hold time
+// recently observed, at most max_spin (50us by default), and then parks on a futex until the deadline like
+// futex_timed_mutex. When the observed hold time exceeds max_spin, it parks right away. The hold time is sampled on
+// every sample_interval-th acquisition and averaged, which keeps the clock reads off most lock/unlock pairs.
+class adaptive_timed_mutex {
+  public:
+    static constexpr std::uint32_t sample_interval = 8;
+
+    adaptive_timed_mutex() noexcept = default;
+    explicit adaptive_timed_mutex(std::chrono::nanoseconds max_spin) noexcept
+        : m_max_spin_ns(
+              static_cast<std::uint32_t>(std::clamp<std::chrono::nanoseconds::rep>(max_spin.count(), 0, max_ns))) {}
+    adaptive_timed_mutex(const adaptive_timed_mutex&)            = delete;
+    adaptive_timed_mutex& operator=(const adaptive_timed_mutex&) = delete;
+
+    void lock() {
+        if (not try_lock()) {
+            lock_slow();
+        }
+    }
+
+    bool try_lock() noexcept {
+        std::uint32_t expected = unlocked;
+        if (m_state.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed)) {
+            on_acquired();
+            return true;
+        }
+        return false;
+    }
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        return try_lock_until(std::chrono::steady_clock::now() + dur);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        return try_lock() || try_lock_until_steady(detail::to_steady(tp));
+    }
+
+#if defined(__cpp_lib_jthread)
+    // Like try_lock_until, but gives up without locking as soon as a stop is requested on st.
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::stop_token& st, const std::chrono::time_point<Clock, Duration>& tp) {
+        return not st.stop_requested() && (try_lock() || try_lock_until_steady(detail::to_steady(tp), st));
+    }
+#endif
+
+    void unlock() noexcept {
+        on_releasing();
+        if (m_state.exchange(unlocked, std::memory_order_release) == contended) {
+            wake_one();
+        }
+    }
+
+    // the average of the sampled hold times
+    std::chrono::nanoseconds hold_time_estimate() const noexcept {
+        return std::chrono::nanoseconds(m_hold_ns.load(std::memory_order_relaxed));
+    }
+
+    // how long a thread finding the mutex locked currently spins before it parks
+    std::chrono::nanoseconds spin_duration() const noexcept {
+        const std::uint64_t hold = m_hold_ns.load(std::memory_order_relaxed);
+        return std::chrono::nanoseconds(hold > m_max_spin_ns ? 0 : std::min<std::uint64_t>(2 * hold, m_max_spin_ns));
+    }
+
+  private:
+    // the owner starts a sample on every sample_interval-th acquisition
+    void on_acquired() noexcept {
+        if (++m_acquisitions % sample_interval == 0) {
+            m_hold_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    // the owner adds a started sample to the moving average with weight 1/8
+    void on_releasing() noexcept {
+        if (m_hold_start != std::chrono::steady_clock::time_point{}) {
+            const auto held = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                                   m_hold_start);
+            const auto sample =
+                static_cast<std::uint32_t>(std::clamp<std::chrono::nanoseconds::rep>(held.count(), 0, max_ns));
+            const std::uint32_t avg = m_hold_ns.load(std::memory_order_relaxed);
+            m_hold_ns.store(avg - avg / 8 + sample / 8, std::memory_order_relaxed);
+            m_hold_start = {};
+        }
+    }
+
+    bool spin_until(std::chrono::steady_clock::time_point tp) noexcept;
+    void lock_slow();
+    bool try_lock_until_steady(std::chrono::steady_clock::time_point tp);
+#if defined(__cpp_lib_jthread)
+    bool try_lock_until_steady(std::chrono::steady_clock::time_point tp, const std::stop_token& st);
+#endif
+    void wake_one() noexcept;
+
+    // the states of the futex word
+    static constexpr std::uint32_t unlocked  = 0;
+    static constexpr std::uint32_t locked    = 1;
+    static constexpr std::uint32_t contended = 2; // locked and there may be waiters
+
+    // the durations kept in nanoseconds are capped to fit 32 bits
+    static constexpr std::chrono::nanoseconds::rep max_ns = std::numeric_limits<std::uint32_t>::max();
+
+    std::atomic<std::uint32_t> m_state{unlocked};
+    std::atomic<std::uint32_t> m_hold_ns{1000}; // the estimate before the first sample
+    std::uint32_t              m_max_spin_ns = 50'000;
+
+    // only accessed by the owner
+    std::uint32_t                         m_acquisitions = 0;
+    std::chrono::steady_clock::time_point m_hold_start{};
+};
+} // namespace beman::timed_lock_alg
+#endif
+
+namespace beman::timed_lock_alg {
+namespace detail {
+//-------------------------------------------------------------------------
+// unlocks the lockables in [from, to) in rotation order when going out of scope
+template <class Iter>
+struct rotation_unlocker {
+    Iter        first;
+    std::size_t size;
+    std::size_t from;
+    std::size_t to;
+
+    ~rotation_unlocker() {
+        for (; from != to; from = from + 1 == size ? 0 : from + 1) {
+            lockable_ref(first[static_cast<std::iter_difference_t<Iter>>(from)]).unlock();
+        }
+    }
+};
+
+//-------------------------------------------------------------------------
+// unlocks the first count lockables in order in reverse when going out of scope
+template <class Iter>
+struct ordered_unlocker {
+    Iter                         first;
+    std::span<const std::size_t> order;
+    std::size_t                  count;
+
+    ~ordered_unlocker() {
+        while (count != 0) {
+            lockable_ref(first[static_cast<std::iter_difference_t<Iter>>(order[--count])]).unlock();
+        }
+    }
+};
+
+// the address of the lockable passed by the user that an element of a lockable range refers to
+template <class T>
+const void* lockable_key(const T& elem) noexcept {
+    if constexpr (requires { elem.ordering_key(); }) {
+        return elem.ordering_key();
+    } else {
+        return std::addressof(underlying_lockable(lockable_ref(elem)));
+    }
+}
+
+// Acquires the lockables in order as round round of the call, which the caller finishes tracing.
+template <class Timepoint, class Range>
+int try_lock_ordered_until_impl(const Timepoint&             end_time,
+                                Range&                       r,
+                                std::span<const std::size_t> order,
+                                std::size_t                  round) {
+    if (order.empty()) {
+        return -1;
+    }
+    const auto  first = std::ranges::begin(r);
+    const void* set   = lockable_key(first[0]);
+    trace_round_start(set, order[0], round);
+
+    // Acquire the lockables one by one in the global order, waiting for each until the deadline. Everyone using the
+    // same order acquires in a consistent sequence and the rotating algorithm never waits while holding a lockable,
+    // so there is no need to release what's already acquired while waiting for the next.
+    ordered_unlocker<decltype(first)> unlocker{first, order, 0};
+    for (; unlocker.count != order.size(); ++unlocker.count) {
+        const auto idx = order[unlocker.count];
+        trace_block(set, idx);
+        if (not lockable_ref(first[static_cast<std::iter_difference_t<decltype(first)>>(idx)]).try_lock_until(
+                end_time)) {
+            return static_cast<int>(idx); // timeout
+        }
+    }
+    unlocker.count = 0; // keep all
+    return -1;
+}
+
+// a call in ordered mode, which takes a single round
+template <class Timepoint, class Range>
+int try_lock_ordered_until(const Timepoint& end_time, Range& r, std::span<const std::size_t> order) {
+    const int rv = try_lock_ordered_until_impl(end_time, r, order, 1);
+    if (not order.empty()) {
+        trace_finished(lockable_key(std::ranges::begin(r)[0]), rv, 1);
+    }
+    return rv;
+}
+
+template <class Keys>
+void sort_order(std::span<std::size_t> order, const Keys& keys) {
+    std::iota(order.begin(), order.end(), std::size_t{});
+    std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return std::less<>{}(keys[lhs], keys[rhs]);
+    });
+}
+
+// Continues a call that failed rounds rounds of the rotation algorithm with the ordered acquisition in address order.
+// This only happens with an escalating_backoff after losing many rounds, so allocating the order is fine.
+template <class Timepoint, class Range, class Observer>
+int try_lock_escalated_until(const Timepoint& end_time, Range& r, Observer& observer, std::size_t rounds) {
+    const auto n     = static_cast<std::size_t>(std::ranges::size(r));
+    const auto first = std::ranges::begin(r);
+
+    std::vector<const void*> keys;
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        keys.push_back(lockable_key(first[static_cast<std::iter_difference_t<decltype(first)>>(i)]));
+    }
+    std::vector<std::size_t> order(n);
+    sort_order(order, keys);
+    const int rv = try_lock_ordered_until_impl(end_time, r, order, rounds + 1);
+    if (rv != -1) {
+        observer.on_failed(static_cast<std::size_t>(rv));
+    }
+    observer.on_finished(rv, rounds + 1);
+    return rv;
+}
+//-------------------------------------------------------------------------
+// the number of lockables probed first when the observer keeps a contention history
+inline constexpr std::size_t max_hot_lockables = 4;
+
+// the indices of the hottest lockables according to a contention history, hottest first
+struct hot_lockables {
+    std::array<std::size_t, max_hot_lockables> idx{};
+    std::size_t                                size = 0;
+
+    template <class History>
+    hot_lockables(const History& history, std::size_t n) {
+        std::array<std::uint32_t, max_hot_lockables> scores{};
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::uint32_t score = history.hotness(i);
+            if (score == 0 || (size == max_hot_lockables && score <= scores[size - 1])) {
+                continue;
+            }
+            // insertion sort, dropping the coldest if full
+            std::size_t pos = size == max_hot_lockables ? size - 1 : size++;
+            for (; pos != 0 && scores[pos - 1] < score; --pos) {
+                scores[pos] = scores[pos - 1];
+                idx[pos]    = idx[pos - 1];
+            }
+            scores[pos] = score;
+            idx[pos]    = i;
+        }
+    }
+
+    bool contains(std::size_t i) const noexcept {
+        const auto last = idx.begin() + static_cast<std::ptrdiff_t>(size);
+        return std::find(idx.begin(), last, i) != last;
+    }
+};
+
+// unlocks what a round of try_lock_hot_first_until_impl locked when going out of scope: the first count hot lockables
+// except the lead and the cold ones in [from, to) in rotation order
+template <class Iter>
+struct hot_first_unlocker {
+    Iter                 first;
+    std::size_t          size;
+    const hot_lockables& hot;
+    std::size_t          lead;
+    std::size_t          count;
+    std::size_t          from;
+    std::size_t          to;
+
+    ~hot_first_unlocker() {
+        for (std::size_t k = 0; k != count; ++k) {
+            if (hot.idx[k] != lead) {
+                lockable_ref(first[static_cast<std::iter_difference_t<Iter>>(hot.idx[k])]).unlock();
+            }
+        }
+        for (; from != to; from = from + 1 == size ? 0 : from + 1) {
+            if (not hot.contains(from)) {
+                lockable_ref(first[static_cast<std::iter_difference_t<Iter>>(from)]).unlock();
+            }
+        }
+    }
+};
+
+// The rounds of the rotation algorithm. Each round blocks on the lead lockable at idx and calls try_rest(idx), which
+// tries to lock the others and returns idx if it did, keeping them locked, or the index of the one that failed after
+// unlocking the ones it locked. The lead of the next round is the one that failed.
+template <class Timepoint, class Backoff, class Range, class Observer, class TryRest>
+int try_lock_rounds_until(
+    const Timepoint& end_time, Backoff& backoff, Range& r, Observer& observer, std::size_t idx, TryRest try_rest) {
+    const auto first = std::ranges::begin(r);
+
+    const std::size_t escalation = escalation_rounds_of(backoff);
+    const void*       set        = lockable_key(first[0]);
+    for (std::size_t rounds = 1;; ++rounds) {
+        trace_round_start(set, idx, rounds);
+        trace_block(set, idx);
+        auto lead = observed_lock_until(
+            observer, idx, lockable_ref(first[static_cast<std::iter_difference_t<decltype(first)>>(idx)]), end_time);
+        if (not lead) {
+            observer.on_failed(idx);
+            observer.on_finished(static_cast<int>(idx), rounds);
+            trace_finished(set, static_cast<int>(idx), rounds);
+            return static_cast<int>(idx); // timeout
+        }
+        const std::size_t fail = try_rest(idx);
+        if (fail == idx) {
+            lead.release();
+            observer.on_finished(-1, rounds);
+            trace_finished(set, -1, rounds);
+            return -1; // success
+        }
+        // start with the one that failed next round
+        observer.on_failed(fail);
+        trace_failed(set, fail);
+        idx = fail;
+        lead.unlock();
+        if (rounds == escalation) {
+            const int rv = try_lock_escalated_until(end_time, r, observer, rounds);
+            trace_finished(set, rv, rounds + 1);
+            return rv;
+        }
+        observer.on_backoff();
+        backoff(end_time);
+    }
+}
+
+// The rotation algorithm of try_lock_until_impl guided by a contention history. The first round blocks on the
+// hottest lockable instead of the first and each round tries the other hot lockables before the rest, so that a
+// round bound to fail fails before locking and releasing the cold ones. The history is sampled once per call. Later
+// rounds still lead with the lockable that failed rather than a hotter one: every other lockable, the hot ones
+// included, was just locked, so blocking on one of them would likely cost a round failing on the same lockable again.
+template <class Timepoint, class Backoff, class Range, class History>
+int try_lock_hot_first_until_impl(const Timepoint& end_time, Backoff& backoff, Range& r, History& history) {
+    const auto n     = static_cast<std::size_t>(std::ranges::size(r));
+    const auto first = std::ranges::begin(r);
+    const auto at    = [&](std::size_t i) -> auto& {
+        return lockable_ref(first[static_cast<std::iter_difference_t<decltype(first)>>(i)]);
+    };
+    const auto next = [n](std::size_t i) { return i + 1 == n ? 0 : i + 1; };
+
+    const hot_lockables hot(history, n);
+    const std::size_t   lead = hot.size != 0 ? hot.idx[0] : 0;
+    return try_lock_rounds_until(end_time, backoff, r, history, lead, [&](std::size_t idx) {
+        std::size_t                         fail = idx; // idx while nothing failed
+        hot_first_unlocker<decltype(first)> unlocker{first, n, hot, idx, 0, next(idx), next(idx)};
+        for (; unlocker.count != hot.size; ++unlocker.count) {
+            const auto i = hot.idx[unlocker.count];
+            if (i != idx && not at(i).try_lock()) {
+                fail = i;
+                break;
+            }
+        }
+        for (std::size_t i = next(idx); fail == idx && i != idx; i = next(i)) {
+            if (hot.contains(i)) {
+                continue;
+            }
+            if (not at(i).try_lock()) {
+                fail = i;
+            } else {
+                unlocker.to = next(i);
+            }
+        }
+        if (fail == idx) {
+            unlocker.count = 0; // keep all
+            unlocker.from  = unlocker.to;
+        }
+        return fail;
+    });
+}
+
+template <class Timepoint, class Backoff, class Range>
+int try_lock_until_impl(const Timepoint& end_time, Backoff& backoff, Range& r) {
+    auto&& observer = observer_of(backoff);
+    if constexpr (ContentionHistory<std::remove_cvref_t<decltype(observer)>>) {
+        return try_lock_hot_first_until_impl(end_time, backoff, r, observer);
+    } else {
+        const auto n     = static_cast<std::size_t>(std::ranges::size(r));
+        const auto first = std::ranges::begin(r);
+        const auto at    = [&](std::size_t i) -> auto& {
+            return lockable_ref(first[static_cast<std::iter_difference_t<decltype(first)>>(i)]);
+        };
+        const auto next = [n](std::size_t i) { return i + 1 == n ? 0 : i + 1; };
+
+        // Block on one lockable and try to lock the rest in rotation order. If that fails, release them all and
+        // start with the lockable that failed in the next round.
+        return try_lock_rounds_until(end_time, backoff, r, observer, 0, [&](std::size_t idx) {
+            std::size_t                        fail = next(idx);
+            rotation_unlocker<decltype(first)> unlocker{first, n, fail, fail};
+            for (; fail != idx && at(fail).try_lock(); fail = next(fail)) {
+                unlocker.to = next(fail);
+            }
+            if (fail == idx) {
+                unlocker.from = unlocker.to; // keep all
+            }
+            return fail;
+        });
+    }
+}
+//-------------------------------------------------------------------------
+// A type erased reference to a lockable used when a pack of lockables isn't homogeneous. This makes the number of
+// instantiations needed for a pack of N lockables grow linearly with N.
+template <class Timepoint>
+struct erased_lockable_vtable {
+    bool (*try_lock)(void*);
+    bool (*try_lock_until)(void*, const Timepoint&);
+    void (*unlock)(void*);
+};
+
+template <class L, class Timepoint>
+inline constexpr erased_lockable_vtable<Timepoint> erased_lockable_vtable_for{
+    [](void* l) { return static_cast<L*>(l)->try_lock(); },
+    [](void* l, const Timepoint& tp) { return static_cast<L*>(l)->try_lock_until(tp); },
+    [](void* l) { static_cast<L*>(l)->unlock(); }};
+
+template <class Timepoint>
+class erased_lockable {
+  public:
+    erased_lockable() = default;
+    template <class L>
+    explicit erased_lockable(L& l) noexcept
+        : m_obj(const_cast<void*>(static_cast<const void*>(std::addressof(l)))),
+          m_key(std::addressof(underlying_lockable(l))), m_vtable(&erased_lockable_vtable_for<L, Timepoint>) {}
+
+    bool try_lock() { return m_vtable->try_lock(m_obj); }
+    bool try_lock_until(const Timepoint& tp) { return m_vtable->try_lock_until(m_obj, tp); }
+    void unlock() { m_vtable->unlock(m_obj); }
+
+    // the address of the lockable passed by the user
+    const void* ordering_key() const noexcept { return m_key; }
+
+  private:
+    void*                                    m_obj    = nullptr;
+    const void*                              m_key    = nullptr;
+    const erased_lockable_vtable<Timepoint>* m_vtable = nullptr;
+};
+
+// calls func with a span over a table referring to the lockables
+template <class Timepoint, class Func, class L0, class... Ls>
+decltype(auto) with_lockable_table(Func&& func, L0& l0, Ls&... ls) {
+    if constexpr ((... && std::same_as<L0, Ls>)) {
+        std::array<L0*, 1 + sizeof...(Ls)> lks{std::addressof(l0), std::addressof(ls)...};
+        return std::forward<Func>(func)(std::span<L0* const>(lks));
+    } else {
+        std::array<erased_lockable<Timepoint>, 1 + sizeof...(Ls)> lks{erased_lockable<Timepoint>(l0),
+                                                                      erased_lockable<Timepoint>(ls)...};
+        return std::forward<Func>(func)(std::span<erased_lockable<Timepoint>>(lks));
+    }
+}
+
+// true if the algorithms should use futex_waitv for lockables of type L when using the backoff policy B
+template <class L, class B>
+inline constexpr bool use_futex_waitv =
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_FUTEX_TIMED_MUTEX)
+    std::same_as<L, futex_timed_mutex> && std::same_as<B, yield_backoff>;
+#else
+    false;
+#endif
+
+template <class Timepoint, class Backoff, class L0, class... Ls>
+int try_lock_pack_until(const Timepoint& end_time, Backoff& backoff, L0& l0, Ls&... ls) {
+    if constexpr (use_futex_waitv<L0, Backoff> && (... && std::same_as<L0, Ls>)) {
+        const std::array<L0*, 1 + sizeof...(Ls)> lks{std::addressof(l0), std::addressof(ls)...};
+        return futex_try_lock_until(to_steady(end_time), lks);
+    } else {
+        return with_lockable_table<Timepoint>(
+            [&](auto lks) { return try_lock_until_impl(end_time, backoff, lks); }, l0, ls...);
+    }
+}
+
+template <class Timepoint, class Backoff, class Range>
+int try_lock_range_until(const Timepoint& end_time, Backoff& backoff, Range& r) {
+    using element_type = std::remove_cvref_t<std::ranges::range_reference_t<Range>>;
+    if constexpr (use_futex_waitv<range_lockable_t<Range>, Backoff> && std::ranges::contiguous_range<Range>) {
+        if constexpr (std::is_pointer_v<element_type>) {
+            return futex_try_lock_until(to_steady(end_time),
+                                        std::span<element_type const>(std::ranges::data(r), std::ranges::size(r)));
+        } else {
+            return futex_try_lock_until(to_steady(end_time),
+                                        std::span<element_type>(std::ranges::data(r), std::ranges::size(r)));
+        }
+    } else {
+        return try_lock_until_impl(end_time, backoff, r);
+    }
+}
+
+// Where a thread starts looking for free lockables in a pool. Successive calls on the same thread move one step
+// forward and different threads start at different places so that they don't all go for the first lockable.
+inline std::size_t pool_start_hint() noexcept {
+    thread_local std::size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return hint++;
+}
+
+// how long a failed round of try_lock_k_until_impl waits for one busy lockable before trying the others again
+inline constexpr std::chrono::milliseconds pool_wait_slice{1};
+
+//-------------------------------------------------------------------------
+// Locks out.size() of the lockables in r and writes their indices to out. Each round tries the lockables in rotation
+// order until enough of them are locked. If fewer could be locked, the ones that were are released so that nothing is
+// held while waiting and the backoff policy is called. The thread then blocks on one of the lockables found locked,
+// for at most pool_wait_slice, and the next round starts one step further along with that one, if it got it. The
+// lockable waited for thus rotates over the busy ones. Returns false on timeout.
+template <class Timepoint, class Backoff, class Range>
+bool try_lock_k_until_impl(const Timepoint& end_time, Backoff& backoff, Range& r, std::span<std::size_t> out) {
+    const auto n     = static_cast<std::size_t>(std::ranges::size(r));
+    const auto first = std::ranges::begin(r);
+    const auto k     = out.size();
+    auto       at    = [&](std::size_t i) -> auto& {
+        return lockable_ref(first[static_cast<std::iter_difference_t<decltype(first)>>(i)]);
+    };
+
+    std::size_t start  = pool_start_hint() % n;
+    std::size_t waited = n; // the lockable locked by waiting for it, if any
+    while (true) {
+        std::size_t count = 0;
+        std::size_t busy  = n;
+        if (waited != n) {
+            out[count++] = waited;
+        }
+        for (std::size_t i = 0; i != n && count != k; ++i) {
+            const auto idx = (start + i) % n;
+            if (idx == waited) {
+                continue;
+            }
+            if (at(idx).try_lock()) {
+                out[count++] = idx;
+            } else if (busy == n) {
+                busy = idx;
+            }
+        }
+        if (count == k) {
+            return true;
+        }
+        for (std::size_t i = 0; i != count; ++i) {
+            at(out[i]).unlock();
+        }
+        waited = n;
+        if (Timepoint::clock::now() >= end_time) {
+            return false;
+        }
+        start = start + 1 == n ? 0 : start + 1;
+        backoff(end_time);
+        if (busy != n) {
+            const auto slice_end =
+                std::chrono::ceil<typename Timepoint::duration>(Timepoint::clock::now() + pool_wait_slice);
+            if (at(busy).try_lock_until(std::min(slice_end, end_time))) {
+                waited = busy;
+            }
+        }
+    }
+}
+
+template <class Timepoint, class Backoff, class L0, class... Ls>
+bool try_lock_k_pack_until(
+    const Timepoint& end_time, Backoff& backoff, std::span<std::size_t> out, L0& l0, Ls&... ls) {
+    if constexpr (use_futex_waitv<L0, Backoff> && (... && std::same_as<L0, Ls>)) {
+        const std::array<L0*, 1 + sizeof...(Ls)> lks{std::addressof(l0), std::addressof(ls)...};
+        return futex_try_lock_k_until(to_steady(end_time), lks, out);
+    } else {
+        return with_lockable_table<Timepoint>(
+            [&](auto lks) { return try_lock_k_until_impl(end_time, backoff, lks, out); }, l0, ls...);
+    }
+}
+
+template <class Timepoint, class Backoff, class Range>
+bool try_lock_k_range_until(const Timepoint& end_time, Backoff& backoff, Range& r, std::span<std::size_t> out) {
+    using element_type = std::remove_cvref_t<std::ranges::range_reference_t<Range>>;
+    if constexpr (use_futex_waitv<range_lockable_t<Range>, Backoff> && std::ranges::contiguous_range<Range>) {
+        if constexpr (std::is_pointer_v<element_type>) {
+            return futex_try_lock_k_until(
+                to_steady(end_time), std::span<element_type const>(std::ranges::data(r), std::ranges::size(r)), out);
+        } else {
+            return futex_try_lock_k_until(
+                to_steady(end_time), std::span<element_type>(std::ranges::data(r), std::ranges::size(r)), out);
+        }
+    } else {
+        return try_lock_k_until_impl(end_time, backoff, r, out);
+    }
+}
+
+#if defined(__cpp_lib_jthread)
+// how often a timed wait on a lockable without a stoppable wait of its own checks for a stop request
+inline constexpr std::chrono::microseconds stop_poll_interval{100};
+
+// Waits for l until tp or until a stop is requested on st. Lockables with a stoppable try_lock_until are woken by the
+// stop request, others wait in slices of stop_poll_interval.
+template <class L, class Clock, class Duration>
+bool stoppable_lock_until(L& l, const std::stop_token& st, const std::chrono::time_point<Clock, Duration>& tp) {
+    if constexpr (requires { l.try_lock_until(st, tp); }) {
+        return l.try_lock_until(st, tp);
+    } else {
+        using time_point = std::chrono::time_point<Clock, std::common_type_t<Duration, std::chrono::nanoseconds>>;
+        const time_point end = tp;
+        while (not st.stop_requested()) {
+            const time_point slice = std::min<time_point>(Clock::now() + stop_poll_interval, end);
+            if (l.try_lock_until(slice)) {
+                return true;
+            }
+            if (slice == end) {
+                return false;
+            }
+        }
+        return false;
+    }
+}
+
+// Refers to a lockable whose timed waits also end when a stop is requested on a stop token. The algorithms run on
+// these for the stop_token overloads and see a cancelled wait as a timeout.
+template <class L>
+class stoppable_lockable {
+  public:
+    stoppable_lockable(L& l, const std::stop_token& st) noexcept : m_l(std::addressof(l)), m_st(std::addressof(st)) {}
+
+    void lock() const { m_l->lock(); }
+    bool try_lock() const { return m_l->try_lock(); }
+    void unlock() const { m_l->unlock(); }
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) const {
+        return try_lock_until(std::chrono::steady_clock::now() + dur);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) const {
+        return stoppable_lock_until(*m_l, *m_st, tp);
+    }
+
+    L* get() const noexcept { return m_l; }
+
+  private:
+    L*                     m_l;
+    const std::stop_token* m_st;
+};
+#endif
+} // namespace detail
+
+// The default key of ordered_lock which orders lockables by address.
+struct lockable_address {
+    template <class L>
+    const void* operator()(const L& l) const noexcept {
+        return std::addressof(l);
+    }
+};
+
+// Tag type for the ordered acquisition mode. Lockables are acquired one at a time in the order given by Key, which is
+// called with each lockable. The keys must be totally ordered by std::less<> and all threads locking the same
+// lockables in ordered mode must use the same key. Calls escalated by escalate_after count as ordered by address.
+template <class Key = lockable_address>
+struct ordered_lock_t {
+    Key key{};
+};
+
+inline constexpr ordered_lock_t<> ordered_lock{};
+
+template <class Key>
+constexpr ordered_lock_t<Key> ordered_by(Key key) {
+    return {std::move(key)};
+}
+
+template <class Clock, class Duration, class Backoff, detail::TimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, Ls&... ls) {
+    if constexpr (sizeof...(Ls) == 0) {
+        detail::observer_of(backoff).on_finished(-1, 0);
+        return -1;
+    } else if constexpr (sizeof...(Ls) == 1 && not detail::ObservedBackoff<Backoff>) {
+        return -static_cast<int>(std::get<0>(std::tie(ls...)).try_lock_until(tp));
+    } else {
+        return detail::try_lock_pack_until(tp, backoff, ls...);
+    }
+}
+
+template <class Clock, class Duration, detail::TimedLockable... Ls>
+[[nodiscard]] int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, Ls&... ls) {
+    return try_lock_until(tp, yield_backoff{}, ls...);
+}
+
+template <class Rep, class Period, class Backoff, detail::TimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] int try_lock_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, Ls&... ls) {
+    return try_lock_until(std::chrono::steady_clock::now() + dur, std::move(backoff), ls...);
+}
+
+template <class Rep, class Period, detail::TimedLockable... Ls>
+[[nodiscard]] int try_lock_for(const std::chrono::duration<Rep, Period>& dur, Ls&... ls) {
+    return try_lock_until(std::chrono::steady_clock::now() + dur, ls...);
+}
+
+template <class Clock, class Duration, class Backoff, detail::TimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, R&& r) {
+    const auto n = std::ranges::size(r);
+    if (n == 0) {
+        detail::observer_of(backoff).on_finished(-1, 0);
+        return -1;
+    } else if (n == 1 && not detail::ObservedBackoff<Backoff>) {
+        return -static_cast<int>(detail::lockable_ref(*std::ranges::begin(r)).try_lock_until(tp));
+    } else {
+        return detail::try_lock_range_until(tp, backoff, r);
+    }
+}
+
+template <class Clock, class Duration, detail::TimedLockableRange R>
+[[nodiscard]] int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, R&& r) {
+    return try_lock_until(tp, yield_backoff{}, r);
+}
+
+template <class Rep, class Period, class Backoff, detail::TimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] int try_lock_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, R&& r) {
+    return try_lock_until(std::chrono::steady_clock::now() + dur, std::move(backoff), r);
+}
+
+template <class Rep, class Period, detail::TimedLockableRange R>
+[[nodiscard]] int try_lock_for(const std::chrono::duration<Rep, Period>& dur, R&& r) {
+    return try_lock_until(std::chrono::steady_clock::now() + dur, r);
+}
+
+#if defined(__cpp_lib_jthread)
+// The result of the stop_token overloads when a stop was requested on the token before all lockables were locked.
+// Nothing is locked then.
+inline constexpr int lock_cancelled = -2;
+
+// Like the overloads above, but the call also ends when a stop is requested on st, with lock_cancelled. A stop
+// request wakes a waiter blocked on a futex_timed_mutex or adaptive_timed_mutex right away, other lockables notice it
+// within detail::stop_poll_interval.
+template <class Clock, class Duration, class Backoff, detail::TimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] int
+try_lock_until(std::stop_token st, const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, Ls&... ls) {
+    if (st.stop_requested()) {
+        return lock_cancelled;
+    }
+    if constexpr (sizeof...(Ls) == 0) {
+        detail::observer_of(backoff).on_finished(-1, 0);
+        return -1;
+    } else {
+        std::tuple<detail::stoppable_lockable<Ls>...> lks{detail::stoppable_lockable<Ls>(ls, st)...};
+        const int rv = std::apply([&](auto&... l) { return detail::try_lock_pack_until(tp, backoff, l...); }, lks);
+        return rv != -1 && st.stop_requested() ? lock_cancelled : rv;
+    }
+}
+
+template <class Clock, class Duration, detail::TimedLockable... Ls>
+[[nodiscard]] int try_lock_until(std::stop_token st, const std::chrono::time_point<Clock, Duration>& tp, Ls&... ls) {
+    return try_lock_until(std::move(st), tp, yield_backoff{}, ls...);
+}
+
+template <class Rep, class Period, class Backoff, detail::TimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] int
+try_lock_for(std::stop_token st, const std::chrono::duration<Rep, Period>& dur, Backoff backoff, Ls&... ls) {
+    return try_lock_until(std::move(st), std::chrono::steady_clock::now() + dur, std::move(backoff), ls...);
+}
+
+template <class Rep, class Period, detail::TimedLockable... Ls>
+[[nodiscard]] int try_lock_for(std::stop_token st, const std::chrono::duration<Rep, Period>& dur, Ls&... ls) {
+    return try_lock_until(std::move(st), std::chrono::steady_clock::now() + dur, ls...);
+}
+
+template <class Clock, class Duration, class Backoff, detail::TimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] int
+try_lock_until(std::stop_token st, const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, R&& r) {
+    if (st.stop_requested()) {
+        return lock_cancelled;
+    }
+    using lockable_type = detail::range_lockable_t<R>;
+    std::vector<detail::stoppable_lockable<lockable_type>> lks;
+    lks.reserve(static_cast<std::size_t>(std::ranges::size(r)));
+    for (auto&& elem : r) {
+        lks.emplace_back(detail::lockable_ref(elem), st);
+    }
+    if (lks.empty()) {
+        detail::observer_of(backoff).on_finished(-1, 0);
+        return -1;
+    }
+    const int rv = detail::try_lock_range_until(tp, backoff, lks);
+    return rv != -1 && st.stop_requested() ? lock_cancelled : rv;
+}
+
+template <class Clock, class Duration, detail::TimedLockableRange R>
+[[nodiscard]] int try_lock_until(std::stop_token st, const std::chrono::time_point<Clock, Duration>& tp, R&& r) {
+    return try_lock_until(std::move(st), tp, yield_backoff{}, r);
+}
+
+template <class Rep, class Period, class Backoff, detail::TimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] int
+try_lock_for(std::stop_token st, const std::chrono::duration<Rep, Period>& dur, Backoff backoff, R&& r) {
+    return try_lock_until(std::move(st), std::chrono::steady_clock::now() + dur, std::move(backoff), r);
+}
+
+template <class Rep, class Period, detail::TimedLockableRange R>
+[[nodiscard]] int try_lock_for(std::stop_token st, const std::chrono::duration<Rep, Period>& dur, R&& r) {
+    return try_lock_until(std::move(st), std::chrono::steady_clock::now() + dur, r);
+}
+#endif
+
+template <class Key, class Clock, class Duration, detail::TimedLockable... Ls>
+[[nodiscard]] int
+try_lock_until(const ordered_lock_t<Key>& ord, const std::chrono::time_point<Clock, Duration>& tp, Ls&... ls) {
+    if constexpr (sizeof...(Ls) == 0) {
+        return -1;
+    } else {
+        using key_type = std::common_type_t<std::invoke_result_t<const Key&, detail::underlying_lockable_t<Ls>&>...>;
+        const std::array<key_type, sizeof...(Ls)> keys{std::invoke(ord.key, detail::underlying_lockable(ls))...};
+        std::array<std::size_t, sizeof...(Ls)>    order;
+        detail::sort_order(order, keys);
+        return detail::with_lockable_table<std::chrono::time_point<Clock, Duration>>(
+            [&](auto lks) { return detail::try_lock_ordered_until(tp, lks, order); }, ls...);
+    }
+}
+
+template <class Key, class Rep, class Period, detail::TimedLockable... Ls>
+[[nodiscard]] int
+try_lock_for(const ordered_lock_t<Key>& ord, const std::chrono::duration<Rep, Period>& dur, Ls&... ls) {
+    return try_lock_until(ord, std::chrono::steady_clock::now() + dur, ls...);
+}
+
+template <class Key, class Clock, class Duration, detail::TimedLockableRange R>
+[[nodiscard]] int
+try_lock_until(const ordered_lock_t<Key>& ord, const std::chrono::time_point<Clock, Duration>& tp, R&& r) {
+    const auto n     = static_cast<std::size_t>(std::ranges::size(r));
+    const auto first = std::ranges::begin(r);
+    using lockable_t = detail::underlying_lockable_t<detail::range_lockable_t<R>>;
+    using key_type   = std::remove_cvref_t<std::invoke_result_t<const Key&, lockable_t&>>;
+
+    std::vector<key_type> keys;
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto idx = static_cast<std::iter_difference_t<decltype(first)>>(i);
+        keys.push_back(std::invoke(ord.key, detail::underlying_lockable(detail::lockable_ref(first[idx]))));
+    }
+    std::vector<std::size_t> order(n);
+    detail::sort_order(order, keys);
+    return detail::try_lock_ordered_until(tp, r, order);
+}
+
+template <class Key, class Rep, class Period, detail::TimedLockableRange R>
+[[nodiscard]] int
+try_lock_for(const ordered_lock_t<Key>& ord, const std::chrono::duration<Rep, Period>& dur, R&& r) {
+    return try_lock_until(ord, std::chrono::steady_clock::now() + dur, r);
+}
+
+template <class Clock, class Duration, class Backoff, detail::SharedTimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] int
+try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, Ls&... ls) {
+    std::tuple<shared_lockable<Ls>...> adapters{shared_lockable<Ls>(ls)...};
+    return std::apply([&](auto&... as) { return try_lock_until(tp, std::move(backoff), as...); }, adapters);
+}
+
+template <class Clock, class Duration, detail::SharedTimedLockable... Ls>
+[[nodiscard]] int try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& tp, Ls&... ls) {
+    return try_lock_shared_until(tp, yield_backoff{}, ls...);
+}
+
+template <class Rep, class Period, class Backoff, detail::SharedTimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] int try_lock_shared_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, Ls&... ls) {
+    return try_lock_shared_until(std::chrono::steady_clock::now() + dur, std::move(backoff), ls...);
+}
+
+template <class Rep, class Period, detail::SharedTimedLockable... Ls>
+[[nodiscard]] int try_lock_shared_for(const std::chrono::duration<Rep, Period>& dur, Ls&... ls) {
+    return try_lock_shared_until(std::chrono::steady_clock::now() + dur, ls...);
+}
+
+template <class Clock, class Duration, class Backoff, detail::SharedTimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] int try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, R&& r) {
+    const auto n     = static_cast<std::size_t>(std::ranges::size(r));
+    const auto first = std::ranges::begin(r);
+
+    std::vector<shared_lockable<detail::range_lockable_t<R>>> adapters;
+    adapters.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        adapters.emplace_back(detail::lockable_ref(first[static_cast<std::iter_difference_t<decltype(first)>>(i)]));
+    }
+    return try_lock_until(tp, std::move(backoff), adapters);
+}
+
+template <class Clock, class Duration, detail::SharedTimedLockableRange R>
+[[nodiscard]] int try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& tp, R&& r) {
+    return try_lock_shared_until(tp, yield_backoff{}, r);
+}
+
+template <class Rep, class Period, class Backoff, detail::SharedTimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] int try_lock_shared_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, R&& r) {
+    return try_lock_shared_until(std::chrono::steady_clock::now() + dur, std::move(backoff), r);
+}
+
+template <class Rep, class Period, detail::SharedTimedLockableRange R>
+[[nodiscard]] int try_lock_shared_for(const std::chrono::duration<Rep, Period>& dur, R&& r) {
+    return try_lock_shared_until(std::chrono::steady_clock::now() + dur, r);
+}
+
+// Locks any one of the lockables, for picking a free one from a pool. Returns the index of the lockable that was
+// locked or -1 if none of them could be locked before tp, which is the opposite of what try_lock_until returns.
+// Threads start looking at different lockables to spread out over the pool. When all the lockables are
+// futex_timed_mutexes and the default backoff policy is used, a thread that finds none of them free sleeps until the
+// first one is unlocked. Other lockables can't be waited for all at once: after calling the backoff policy, the thread
+// blocks in try_lock_until on one lockable it found locked, for up to a millisecond, taking turns over the busy ones.
+// A lockable unlocked meanwhile is then only noticed in the next round, up to that much later.
+template <class Clock, class Duration, class Backoff, detail::TimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] int try_lock_any_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, Ls&... ls) {
+    if constexpr (sizeof...(Ls) == 0) {
+        return -1;
+    } else {
+        std::array<std::size_t, 1> acquired;
+        return detail::try_lock_k_pack_until(tp, backoff, std::span(acquired), ls...)
+                   ? static_cast<int>(acquired[0])
+                   : -1;
+    }
+}
+
+template <class Clock, class Duration, detail::TimedLockable... Ls>
+[[nodiscard]] int try_lock_any_until(const std::chrono::time_point<Clock, Duration>& tp, Ls&... ls) {
+    return try_lock_any_until(tp, yield_backoff{}, ls...);
+}
+
+template <class Rep, class Period, class Backoff, detail::TimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] int try_lock_any_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, Ls&... ls) {
+    return try_lock_any_until(std::chrono::steady_clock::now() + dur, std::move(backoff), ls...);
+}
+
+template <class Rep, class Period, detail::TimedLockable... Ls>
+[[nodiscard]] int try_lock_any_for(const std::chrono::duration<Rep, Period>& dur, Ls&... ls) {
+    return try_lock_any_until(std::chrono::steady_clock::now() + dur, ls...);
+}
+
+template <class Clock, class Duration, class Backoff, detail::TimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] int try_lock_any_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, R&& r) {
+    if (std::ranges::size(r) == 0) {
+        return -1;
+    }
+    std::array<std::size_t, 1> acquired;
+    return detail::try_lock_k_range_until(tp, backoff, r, std::span(acquired)) ? static_cast<int>(acquired[0]) : -1;
+}
+
+template <class Clock, class Duration, detail::TimedLockableRange R>
+[[nodiscard]] int try_lock_any_until(const std::chrono::time_point<Clock, Duration>& tp, R&& r) {
+    return try_lock_any_until(tp, yield_backoff{}, r);
+}
+
+template <class Rep, class Period, class Backoff, detail::TimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] int try_lock_any_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, R&& r) {
+    return try_lock_any_until(std::chrono::steady_clock::now() + dur, std::move(backoff), r);
+}
+
+template <class Rep, class Period, detail::TimedLockableRange R>
+[[nodiscard]] int try_lock_any_for(const std::chrono::duration<Rep, Period>& dur, R&& r) {
+    return try_lock_any_until(std::chrono::steady_clock::now() + dur, r);
+}
+
+// Locks k of the lockables, like try_lock_any_until does for one. Returns the indices of the k lockables that were
+// locked, in no particular order, or nullopt if k of them could not be locked at the same time before tp or there are
+// fewer than k. Locking none of them always succeeds. Nothing is held while waiting.
+template <class Clock, class Duration, class Backoff, detail::TimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] std::optional<std::vector<std::size_t>>
+try_lock_k_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, std::size_t k, Ls&... ls) {
+    if (k == 0) {
+        return std::vector<std::size_t>{};
+    }
+    if constexpr (sizeof...(Ls) == 0) {
+        return std::nullopt;
+    } else {
+        if (k > sizeof...(Ls)) {
+            return std::nullopt;
+        }
+        std::vector<std::size_t> acquired(k);
+        if (not detail::try_lock_k_pack_until(tp, backoff, std::span(acquired), ls...)) {
+            return std::nullopt;
+        }
+        return acquired;
+    }
+}
+
+template <class Clock, class Duration, detail::TimedLockable... Ls>
+[[nodiscard]] std::optional<std::vector<std::size_t>>
+try_lock_k_until(const std::chrono::time_point<Clock, Duration>& tp, std::size_t k, Ls&... ls) {
+    return try_lock_k_until(tp, yield_backoff{}, k, ls...);
+}
+
+template <class Rep, class Period, class Backoff, detail::TimedLockable... Ls>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] std::optional<std::vector<std::size_t>>
+try_lock_k_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, std::size_t k, Ls&... ls) {
+    return try_lock_k_until(std::chrono::steady_clock::now() + dur, std::move(backoff), k, ls...);
+}
+
+template <class Rep, class Period, detail::TimedLockable... Ls>
+[[nodiscard]] std::optional<std::vector<std::size_t>>
+try_lock_k_for(const std::chrono::duration<Rep, Period>& dur, std::size_t k, Ls&... ls) {
+    return try_lock_k_until(std::chrono::steady_clock::now() + dur, k, ls...);
+}
+
+template <class Clock, class Duration, class Backoff, detail::TimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+[[nodiscard]] std::optional<std::vector<std::size_t>>
+try_lock_k_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, std::size_t k, R&& r) {
+    if (k == 0) {
+        return std::vector<std::size_t>{};
+    }
+    if (k > static_cast<std::size_t>(std::ranges::size(r))) {
+        return std::nullopt;
+    }
+    std::vector<std::size_t> acquired(k);
+    if (not detail::try_lock_k_range_until(tp, backoff, r, std::span(acquired))) {
+        return std::nullopt;
+    }
+    return acquired;
+}
+
+template <class Clock, class Duration, detail::TimedLockableRange R>
+[[nodiscard]] std::optional<std::vector<std::size_t>>
+try_lock_k_until(const std::chrono::time_point<Clock, Duration>& tp, std::size_t k, R&& r) {
+    return try_lock_k_until(tp, yield_backoff{}, k, r);
+}
+
+template <class Rep, class Period, class Backoff, detail::TimedLockableRange R>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+[[nodiscard]] std::optional<std::vector<std::size_t>>
+try_lock_k_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, std::size_t k, R&& r) {
+    return try_lock_k_until(std::chrono::steady_clock::now() + dur, std::move(backoff), k, r);
+}
+
+template <class Rep, class Period, detail::TimedLockableRange R>
+[[nodiscard]] std::optional<std::vector<std::size_t>>
+try_lock_k_for(const std::chrono::duration<Rep, Period>& dur, std::size_t k, R&& r) {
+    return try_lock_k_until(std::chrono::steady_clock::now() + dur, k, r);
+}
+
+template <detail::BasicLockable... Ms>
+class nothrow_multi_lock;
+
+template <detail::BasicLockable... Ms>
+class multi_lock {
+  public:
+    using mutex_type = std::tuple<detail::lockable_handle_t<Ms>...>;
+
+    // Constructors
+    multi_lock() noexcept = default;
+
+    explicit multi_lock(Ms&... ms, lock_order_site site = lock_order_site::current())
+        requires(sizeof...(Ms) > 0)
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        lock(site);
+    }
+
+    multi_lock(std::defer_lock_t, Ms&... ms) noexcept : m_ms(detail::make_lockable_handle(ms)...) {}
+
+    multi_lock(std::try_to_lock_t, Ms&... ms, lock_order_site site = lock_order_site::current())
+        requires(... && detail::Lockable<Ms>)
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock(site);
+    }
+
+    multi_lock(std::adopt_lock_t, Ms&... ms) noexcept : m_ms(detail::make_lockable_handle(ms)...), m_locked(true) {}
+
+    template <class Rep, class Period>
+        requires(... && detail::TimedLockable<Ms>)
+    multi_lock(const std::chrono::duration<Rep, Period>& dur,
+               Ms&...                                    ms,
+               lock_order_site                           site = lock_order_site::current())
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock_for(dur, yield_backoff{}, site);
+    }
+
+    template <class Clock, class Duration>
+        requires(... && detail::TimedLockable<Ms>)
+    multi_lock(const std::chrono::time_point<Clock, Duration>& tp,
+               Ms&...                                          ms,
+               lock_order_site                                 site = lock_order_site::current())
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock_until(tp, yield_backoff{}, site);
+    }
+
+    template <class Rep, class Period, class Backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> &&
+                 (... && detail::TimedLockable<Ms>))
+    multi_lock(const std::chrono::duration<Rep, Period>& dur,
+               Backoff                                   backoff,
+               Ms&...                                    ms,
+               lock_order_site                           site = lock_order_site::current())
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock_for(dur, std::move(backoff), site);
+    }
+
+    template <class Clock, class Duration, class Backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> &&
+                 (... && detail::TimedLockable<Ms>))
+    multi_lock(const std::chrono::time_point<Clock, Duration>& tp,
+               Backoff                                         backoff,
+               Ms&...                                          ms,
+               lock_order_site                                 site = lock_order_site::current())
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock_until(tp, std::move(backoff), site);
+    }
+
+    template <class Key, class Rep, class Period>
+        requires(... && detail::TimedLockable<Ms>)
+    multi_lock(const ordered_lock_t<Key>&                ord,
+               const std::chrono::duration<Rep, Period>& dur,
+               Ms&...                                    ms,
+               lock_order_site                           site = lock_order_site::current())
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock_for(ord, dur, site);
+    }
+
+    template <class Key, class Clock, class Duration>
+        requires(... && detail::TimedLockable<Ms>)
+    multi_lock(const ordered_lock_t<Key>&                      ord,
+               const std::chrono::time_point<Clock, Duration>& tp,
+               Ms&...                                          ms,
+               lock_order_site                                 site = lock_order_site::current())
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock_until(ord, tp, site);
+    }
+
+#if defined(__cpp_lib_jthread)
+    // Gives up when a stop is requested on st. The lock then doesn't own the lockables and st.stop_requested() tells
+    // a cancellation from a timeout.
+    template <class Rep, class Period>
+        requires(... && detail::TimedLockable<Ms>)
+    multi_lock(std::stop_token                           st,
+               const std::chrono::duration<Rep, Period>& dur,
+               Ms&...                                    ms,
+               lock_order_site                           site = lock_order_site::current())
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock_for(std::move(st), dur, yield_backoff{}, site);
+    }
+
+    template <class Clock, class Duration>
+        requires(... && detail::TimedLockable<Ms>)
+    multi_lock(std::stop_token                                 st,
+               const std::chrono::time_point<Clock, Duration>& tp,
+               Ms&...                                          ms,
+               lock_order_site                                 site = lock_order_site::current())
+        : m_ms(detail::make_lockable_handle(ms)...) {
+        try_lock_until(std::move(st), tp, yield_backoff{}, site);
+    }
+#endif
+
+    // Destructor
+    ~multi_lock() {
+        if (m_locked)
+            unlock();
+    }
+
+    // Move operations
+    multi_lock(multi_lock&& other) noexcept
+        : m_ms(std::exchange(other.m_ms, mutex_type{})), m_locked(std::exchange(other.m_locked, false)),
+          m_hold(std::exchange(other.m_hold, {})) {}
+
+    multi_lock& operator=(multi_lock&& other) noexcept {
+        multi_lock(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    // Deleted copy operations
+    multi_lock(const multi_lock&)            = delete;
+    multi_lock& operator=(const multi_lock&) = delete;
+
+    // Locking operations
+  private:
+    template <detail::BasicLockable... Ns>
+    friend class nothrow_multi_lock;
+
+    // the error a locking operation reports, or errc{} if it may go ahead
+    std::errc lock_error() const noexcept {
+        if (m_locked) {
+            return std::errc::resource_deadlock_would_occur;
+        }
+        if constexpr (sizeof...(Ms) != 0) {
+            if (detail::handle_ptr(std::get<0>(m_ms)) == nullptr) {
+                return std::errc::operation_not_permitted;
+            }
+        }
+        return std::errc{};
+    }
+
+    void lock_check() {
+        if (const auto ec = lock_error(); ec != std::errc{}) {
+            detail::throw_system_error(ec);
+        }
+    }
+
+    // calls func with references to the lockables
+    template <class Func>
+    decltype(auto) apply_lockables(Func&& func) const {
+        return std::apply([&](const auto&... hs) -> decltype(auto) { return func(detail::handle_ref(hs)...); }, m_ms);
+    }
+
+    // tell the lock-order validator, the hold timer and the trace points, if enabled, about the lockables passed by
+    // the user
+    void note_acquired([[maybe_unused]] const lock_order_site& site) noexcept {
+        if (m_locked) {
+            if constexpr (detail::validate_lock_order && sizeof...(Ms) != 0) {
+                lock_order_acquired(lockable_keys(), site);
+            }
+            if constexpr (detail::tracing && sizeof...(Ms) != 0) {
+                detail::trace_held(lockable_keys()[0], sizeof...(Ms));
+            }
+            m_hold.start(site);
+        }
+    }
+
+    void note_released() noexcept {
+        m_hold.stop();
+        if constexpr (detail::tracing && sizeof...(Ms) != 0) {
+            detail::trace_unlock(lockable_keys()[0], sizeof...(Ms));
+        }
+        if constexpr (detail::validate_lock_order && sizeof...(Ms) != 0) {
+            lock_order_released(lockable_keys());
+        }
+    }
+
+    // release() stops timing the hold but, as the lockables stay locked, leaves them held for the validator
+    void note_given_up() noexcept {
+        m_hold.cancel();
+        if constexpr (detail::tracing && sizeof...(Ms) != 0) {
+            detail::trace_release(lockable_keys()[0], sizeof...(Ms));
+        }
+    }
+
+    std::array<const void*, sizeof...(Ms)> lockable_keys() const noexcept {
+        return apply_lockables([](auto&... ms) {
+            return std::array<const void*, sizeof...(Ms)>{std::addressof(detail::underlying_lockable(ms))...};
+        });
+    }
+
+  public:
+    void lock(lock_order_site site = lock_order_site::current())
+        requires(sizeof...(Ms) == 1 || (... && detail::Lockable<Ms>))
+    {
+        lock_check();
+        if constexpr (sizeof...(Ms) == 1) {
+            detail::handle_ref(std::get<sizeof...(Ms) - 1>(m_ms)).lock();
+        } else if constexpr (sizeof...(Ms) > 1) {
+            apply_lockables([](auto&... ms) { std::lock(ms...); });
+        }
+        m_locked = true;
+        note_acquired(site);
+    }
+
+    int try_lock(lock_order_site site = lock_order_site::current())
+        requires(... && detail::Lockable<Ms>)
+    {
+        lock_check();
+        int rv;
+        if constexpr (sizeof...(Ms) == 0) {
+            rv = -1;
+        } else if constexpr (sizeof...(Ms) == 1) {
+            rv = -static_cast<int>(detail::handle_ref(std::get<sizeof...(Ms) - 1>(m_ms)).try_lock());
+        } else {
+            rv = apply_lockables([](auto&... ms) { return std::try_lock(ms...); });
+        }
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    template <class Rep, class Period, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> &&
+                 (... && detail::TimedLockable<Ms>))
+    int try_lock_for(const std::chrono::duration<Rep, Period>& dur,
+                     Backoff                                   backoff = {},
+                     lock_order_site                           site    = lock_order_site::current()) {
+        lock_check();
+        int rv = apply_lockables(
+            [&](auto&... ms) { return beman::timed_lock_alg::try_lock_for(dur, std::move(backoff), ms...); });
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    template <class Clock, class Duration, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> &&
+                 (... && detail::TimedLockable<Ms>))
+    int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp,
+                       Backoff                                        backoff = {},
+                       lock_order_site                                site    = lock_order_site::current()) {
+        lock_check();
+        int rv = apply_lockables(
+            [&](auto&... ms) { return beman::timed_lock_alg::try_lock_until(tp, std::move(backoff), ms...); });
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+#if defined(__cpp_lib_jthread)
+    // return lock_cancelled when a stop is requested on st before all lockables are locked
+    template <class Rep, class Period, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> &&
+                 (... && detail::TimedLockable<Ms>))
+    int try_lock_for(std::stop_token                           st,
+                     const std::chrono::duration<Rep, Period>& dur,
+                     Backoff                                   backoff = {},
+                     lock_order_site                           site    = lock_order_site::current()) {
+        return try_lock_until(std::move(st), std::chrono::steady_clock::now() + dur, std::move(backoff), site);
+    }
+
+    template <class Clock, class Duration, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> &&
+                 (... && detail::TimedLockable<Ms>))
+    int try_lock_until(std::stop_token                                st,
+                       const std::chrono::time_point<Clock, Duration>& tp,
+                       Backoff                                        backoff = {},
+                       lock_order_site                                site    = lock_order_site::current()) {
+        lock_check();
+        int rv   = apply_lockables([&](auto&... ms) {
+            return beman::timed_lock_alg::try_lock_until(std::move(st), tp, std::move(backoff), ms...);
+        });
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+#endif
+
+    template <class Key, class Rep, class Period>
+        requires(... && detail::TimedLockable<Ms>)
+    int try_lock_for(const ordered_lock_t<Key>&                  ord,
+                     const std::chrono::duration<Rep, Period>& dur,
+                     lock_order_site                           site = lock_order_site::current()) {
+        lock_check();
+        int rv   = apply_lockables([&](auto&... ms) { return beman::timed_lock_alg::try_lock_for(ord, dur, ms...); });
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    template <class Key, class Clock, class Duration>
+        requires(... && detail::TimedLockable<Ms>)
+    int try_lock_until(const ordered_lock_t<Key>&                       ord,
+                       const std::chrono::time_point<Clock, Duration>& tp,
+                       lock_order_site                                site = lock_order_site::current()) {
+        lock_check();
+        int rv   = apply_lockables([&](auto&... ms) { return beman::timed_lock_alg::try_lock_until(ord, tp, ms...); });
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    void unlock() {
+        if (not m_locked) {
+            detail::throw_system_error(std::errc::operation_not_permitted);
+        }
+        note_released();
+        // clang doesn't seem to understand that "unlocker" is actually used to unlock all mutexes at the end of the
+        // scope even if one of them throws so mark it as maybe_unused.
+        [[maybe_unused]] auto unlocker =
+            apply_lockables([](auto&... ms) { return std::scoped_lock(std::adopt_lock, ms...); });
+        m_locked = false;
+    }
+
+    // Modifiers
+    void swap(multi_lock& other) noexcept {
+        std::swap(m_ms, other.m_ms);
+        std::swap(m_locked, other.m_locked);
+        std::swap(m_hold, other.m_hold);
+    }
+
+    // Gives up ownership without unlocking. The lock-order validator keeps the lockables held until the caller
+    // reports unlocking them with lock_order_released.
+    mutex_type release() noexcept {
+        if (m_locked) {
+            note_given_up();
+        }
+        m_locked = false;
+        return std::exchange(m_ms, mutex_type{});
+    }
+
+    // Observers
+    mutex_type         mutex() const noexcept { return m_ms; }
+    bool               owns_lock() const noexcept { return m_locked; }
+    explicit           operator bool() const noexcept { return m_locked; }
+
+  private:
+    mutex_type                               m_ms;
+    bool                                     m_locked = false;
+    [[no_unique_address]] detail::hold_timer m_hold;
+};
+
+// The locking constructors take the site of the acquisition after the lockables, which keeps them from being deduced
+// from the constructors themselves.
+template <detail::BasicLockable... Ms>
+multi_lock(Ms&...) -> multi_lock<Ms...>;
+
+template <detail::BasicLockable... Ms>
+multi_lock(std::try_to_lock_t, Ms&...) -> multi_lock<Ms...>;
+
+template <class Rep, class Period, detail::BasicLockable... Ms>
+multi_lock(const std::chrono::duration<Rep, Period>&, Ms&...) -> multi_lock<Ms...>;
+
+template <class Clock, class Duration, detail::BasicLockable... Ms>
+multi_lock(const std::chrono::time_point<Clock, Duration>&, Ms&...) -> multi_lock<Ms...>;
+
+template <class Rep, class Period, class Backoff, detail::BasicLockable... Ms>
+    requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+multi_lock(const std::chrono::duration<Rep, Period>&, Backoff, Ms&...) -> multi_lock<Ms...>;
+
+template <class Clock, class Duration, class Backoff, detail::BasicLockable... Ms>
+    requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+multi_lock(const std::chrono::time_point<Clock, Duration>&, Backoff, Ms&...) -> multi_lock<Ms...>;
+
+template <class Key, class Rep, class Period, detail::BasicLockable... Ms>
+multi_lock(const ordered_lock_t<Key>&, const std::chrono::duration<Rep, Period>&, Ms&...) -> multi_lock<Ms...>;
+
+template <class Key, class Clock, class Duration, detail::BasicLockable... Ms>
+multi_lock(const ordered_lock_t<Key>&, const std::chrono::time_point<Clock, Duration>&, Ms&...) -> multi_lock<Ms...>;
+
+#if defined(__cpp_lib_jthread)
+template <class Rep, class Period, detail::BasicLockable... Ms>
+multi_lock(std::stop_token, const std::chrono::duration<Rep, Period>&, Ms&...) -> multi_lock<Ms...>;
+
+template <class Clock, class Duration, detail::BasicLockable... Ms>
+multi_lock(std::stop_token, const std::chrono::time_point<Clock, Duration>&, Ms&...) -> multi_lock<Ms...>;
+#endif
+
+template <class... Ms>
+void swap(multi_lock<Ms...>& lhs, multi_lock<Ms...>& rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+#if defined(__cpp_lib_expected)
+using lock_result = std::expected<void, std::errc>;
+#else
+class lock_result;
+
+namespace detail {
+constexpr lock_result lock_failure(std::errc ec) noexcept;
+} // namespace detail
+
+// The part of std::expected<void, std::errc> used by nothrow_multi_lock, for standard libraries without it.
+class lock_result {
+  public:
+    constexpr lock_result() noexcept = default;
+
+    // Observers
+    constexpr bool      has_value() const noexcept { return m_error == std::errc{}; }
+    constexpr explicit  operator bool() const noexcept { return has_value(); }
+    constexpr std::errc error() const noexcept { return m_error; }
+
+  private:
+    friend constexpr lock_result detail::lock_failure(std::errc ec) noexcept;
 
-template <class T>
-concept TimedLockable = Lockable<T> && requires(T t) {
-    { t.try_lock_for(std::chrono::nanoseconds{}) } -> std::same_as<bool>;
-    { t.try_lock_for(std::chrono::microseconds{}) } -> std::same_as<bool>;
-    { t.try_lock_for(std::chrono::milliseconds{}) } -> std::same_as<bool>;
-    { t.try_lock_until(std::chrono::time_point<std::chrono::steady_clock>{}) } -> std::same_as<bool>;
-    { t.try_lock_until(std::chrono::time_point<std::chrono::system_clock>{}) } -> std::same_as<bool>;
+    constexpr explicit lock_result(std::errc ec) noexcept : m_error(ec) {}
+
+    std::errc m_error{};
 };
-} // namespace beman::timed_lock_alg::detail
+#endif
 
-namespace beman::timed_lock_alg {
 namespace detail {
-template <class...>
-struct type_pack {}; // seems to compile slightly faster than using a tuple
-namespace rot_detail {
-template <std::size_t I, class IndexSeq>
-struct rotate;
-
-template <std::size_t I, std::size_t... J>
-struct rotate<I, std::index_sequence<J...>> {
-    using type = std::index_sequence<((J + I) % sizeof...(J))...>;
-};
+// a lock_result holding the error ec
+constexpr lock_result lock_failure(std::errc ec) noexcept {
+#if defined(__cpp_lib_expected)
+    return std::unexpected(ec);
+#else
+    return lock_result(ec);
+#endif
+}
+} // namespace detail
 
-template <class IndexSeq>
-struct make_pack_impl;
+// A multi_lock that reports misuse and failure through the results of its locking operations instead of exceptions,
+// so that it can be used in code built without them. The operations return an empty lock_result when they succeed,
+// or one of these errors:
+//   - resource_deadlock_would_occur when the lock already owns its lockables,
+//   - operation_not_permitted when it has none, or on unlock() when it doesn't own them,
+//   - device_or_resource_busy when try_lock() found a lockable locked,
+//   - timed_out when the deadline of try_lock_for/try_lock_until passed,
+//   - operation_canceled when a stop was requested on the stop_token passed.
+//
+// It makes the same checks as multi_lock, which the compiler folds together, so once inlined the code acquiring the
+// lockables is no larger than that of std::scoped_lock.
+template <detail::BasicLockable... Ms>
+class nothrow_multi_lock {
+  public:
+    using mutex_type = typename multi_lock<Ms...>::mutex_type;
 
-template <std::size_t... I>
-struct make_pack_impl<std::index_sequence<I...>> {
-    using type = type_pack<typename rotate<I, std::index_sequence<I...>>::type...>;
-};
-} // namespace rot_detail
+    // Constructors
+    nothrow_multi_lock() noexcept = default;
 
-template <std::size_t N>
-using make_pack_of_rotating_index_sequences = typename rot_detail::make_pack_impl<std::make_index_sequence<N>>::type;
-//-------------------------------------------------------------------------
-int friendly_try_lock(auto& l1) { return -static_cast<int>(l1.try_lock()); }
-int friendly_try_lock(auto&... ls) { return std::try_lock(ls...); }
-//-------------------------------------------------------------------------
-struct result {
-    int  idx;
-    bool retry;
-};
-//-------------------------------------------------------------------------
-template <class Timepoint, class Locks, class... Seqs>
-int try_lock_until_impl(const Timepoint& end_time, Locks locks, type_pack<Seqs...>) {
-    // an array with one function per lockable/sequence to try:
-    constexpr std::array<result (*)(const Timepoint&, Locks&), sizeof...(Seqs)> seqs{
-        {+[](const Timepoint& tp, Locks& lks) {
-            return []<class Tp, std::size_t I0, std::size_t... Is>(
-                       const Tp& itp, Locks& lcks, std::index_sequence<I0, Is...>) -> result {
-                if (std::unique_lock first{std::get<I0>(lcks), itp}) {
-                    int res = friendly_try_lock(std::get<Is>(lcks)...);
-                    if (res == -1) {
-                        first.release();
-                        return {-1, false}; // success
-                    }
-                    // return the index to try_lock_until next round
-                    constexpr std::array idxs{static_cast<int>(Is)...};
-                    return {idxs[static_cast<std::size_t>(res)], true};
-                }
-                // timeout
-                return {static_cast<int>(I0), false};
-            }(tp, lks, Seqs{});
-        }...}};
+    explicit nothrow_multi_lock(Ms&... ms, lock_order_site site = lock_order_site::current())
+        requires(sizeof...(Ms) > 0)
+        : m_lock(ms..., site) {}
+
+    nothrow_multi_lock(std::defer_lock_t, Ms&... ms) noexcept : m_lock(std::defer_lock, ms...) {}
+
+    nothrow_multi_lock(std::try_to_lock_t, Ms&... ms, lock_order_site site = lock_order_site::current())
+        requires(... && detail::Lockable<Ms>)
+        : m_lock(std::try_to_lock, ms..., site) {}
+
+    nothrow_multi_lock(std::adopt_lock_t, Ms&... ms) noexcept : m_lock(std::adopt_lock, ms...) {}
+
+    template <class Rep, class Period>
+        requires(... && detail::TimedLockable<Ms>)
+    nothrow_multi_lock(const std::chrono::duration<Rep, Period>& dur,
+                       Ms&...                                    ms,
+                       lock_order_site                           site = lock_order_site::current())
+        : m_lock(dur, ms..., site) {}
+
+    template <class Clock, class Duration>
+        requires(... && detail::TimedLockable<Ms>)
+    nothrow_multi_lock(const std::chrono::time_point<Clock, Duration>& tp,
+                       Ms&...                                          ms,
+                       lock_order_site                                 site = lock_order_site::current())
+        : m_lock(tp, ms..., site) {}
 
-    // try rotations in seqs while there is time to retry
-    result ret{};
-    while ((ret = seqs[static_cast<std::size_t>(ret.idx)](end_time, locks)).retry) {
-        std::this_thread::yield();
+    // Locking operations
+    [[nodiscard]] lock_result lock(lock_order_site site = lock_order_site::current())
+        requires(sizeof...(Ms) == 1 || (... && detail::Lockable<Ms>))
+    {
+        if (const auto ec = m_lock.lock_error(); ec != std::errc{}) {
+            return detail::lock_failure(ec);
+        }
+        m_lock.lock(site);
+        return {};
     }
-    return ret.idx;
-}
-} // namespace detail
 
-template <class Clock, class Duration, detail::TimedLockable... Ls>
-[[nodiscard]] int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, Ls&... ls) {
-    if constexpr (sizeof...(Ls) == 0) {
-        return -1;
-    } else if constexpr (sizeof...(Ls) == 1) {
-        return -static_cast<int>(std::get<0>(std::tie(ls...)).try_lock_until(tp));
-    } else {
-        return detail::try_lock_until_impl(
-            tp, std::tie(ls...), detail::make_pack_of_rotating_index_sequences<sizeof...(Ls)>{});
+    [[nodiscard]] lock_result try_lock(lock_order_site site = lock_order_site::current())
+        requires(... && detail::Lockable<Ms>)
+    {
+        if (const auto ec = m_lock.lock_error(); ec != std::errc{}) {
+            return detail::lock_failure(ec);
+        }
+        return m_lock.try_lock(site) == -1 ? lock_result{} : detail::lock_failure(std::errc::device_or_resource_busy);
     }
-}
 
-template <class Rep, class Period, detail::TimedLockable... Ls>
-[[nodiscard]] int try_lock_for(const std::chrono::duration<Rep, Period>& dur, Ls&... ls) {
-    return try_lock_until(std::chrono::steady_clock::now() + dur, ls...);
-}
+    template <class Rep, class Period, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> &&
+                 (... && detail::TimedLockable<Ms>))
+    [[nodiscard]] lock_result
+    try_lock_for(const std::chrono::duration<Rep, Period>& dur,
+                 Backoff                                   backoff = {},
+                 lock_order_site                           site    = lock_order_site::current()) {
+        if (const auto ec = m_lock.lock_error(); ec != std::errc{}) {
+            return detail::lock_failure(ec);
+        }
+        return m_lock.try_lock_for(dur, std::move(backoff), site) == -1 ? lock_result{}
+                                                                        : detail::lock_failure(std::errc::timed_out);
+    }
+
+    template <class Clock, class Duration, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> &&
+                 (... && detail::TimedLockable<Ms>))
+    [[nodiscard]] lock_result
+    try_lock_until(const std::chrono::time_point<Clock, Duration>& tp,
+                   Backoff                                         backoff = {},
+                   lock_order_site                                 site    = lock_order_site::current()) {
+        if (const auto ec = m_lock.lock_error(); ec != std::errc{}) {
+            return detail::lock_failure(ec);
+        }
+        return m_lock.try_lock_until(tp, std::move(backoff), site) == -1 ? lock_result{}
+                                                                         : detail::lock_failure(std::errc::timed_out);
+    }
+
+#if defined(__cpp_lib_jthread)
+    template <class Rep, class Period, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> &&
+                 (... && detail::TimedLockable<Ms>))
+    [[nodiscard]] lock_result
+    try_lock_for(std::stop_token                           st,
+                 const std::chrono::duration<Rep, Period>& dur,
+                 Backoff                                   backoff = {},
+                 lock_order_site                           site    = lock_order_site::current()) {
+        return try_lock_until(std::move(st), std::chrono::steady_clock::now() + dur, std::move(backoff), site);
+    }
+
+    template <class Clock, class Duration, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> &&
+                 (... && detail::TimedLockable<Ms>))
+    [[nodiscard]] lock_result
+    try_lock_until(std::stop_token                                 st,
+                   const std::chrono::time_point<Clock, Duration>& tp,
+                   Backoff                                         backoff = {},
+                   lock_order_site                                 site    = lock_order_site::current()) {
+        if (const auto ec = m_lock.lock_error(); ec != std::errc{}) {
+            return detail::lock_failure(ec);
+        }
+        const int rv = m_lock.try_lock_until(std::move(st), tp, std::move(backoff), site);
+        if (rv == -1) {
+            return {};
+        }
+        return detail::lock_failure(rv == lock_cancelled ? std::errc::operation_canceled : std::errc::timed_out);
+    }
+#endif
+
+    [[nodiscard]] lock_result unlock() noexcept {
+        if (not m_lock.owns_lock()) {
+            return detail::lock_failure(std::errc::operation_not_permitted);
+        }
+        m_lock.unlock();
+        return {};
+    }
+
+    // Modifiers
+    void swap(nothrow_multi_lock& other) noexcept { m_lock.swap(other.m_lock); }
+
+    mutex_type release() noexcept { return m_lock.release(); }
+
+    // Observers
+    mutex_type mutex() const noexcept { return m_lock.mutex(); }
+    bool       owns_lock() const noexcept { return m_lock.owns_lock(); }
+    explicit   operator bool() const noexcept { return m_lock.owns_lock(); }
+
+  private:
+    multi_lock<Ms...> m_lock;
+};
 
 template <detail::BasicLockable... Ms>
-class multi_lock {
+nothrow_multi_lock(Ms&...) -> nothrow_multi_lock<Ms...>;
+
+template <detail::BasicLockable... Ms>
+nothrow_multi_lock(std::try_to_lock_t, Ms&...) -> nothrow_multi_lock<Ms...>;
+
+template <class Rep, class Period, detail::BasicLockable... Ms>
+nothrow_multi_lock(const std::chrono::duration<Rep, Period>&, Ms&...) -> nothrow_multi_lock<Ms...>;
+
+template <class Clock, class Duration, detail::BasicLockable... Ms>
+nothrow_multi_lock(const std::chrono::time_point<Clock, Duration>&, Ms&...) -> nothrow_multi_lock<Ms...>;
+
+template <class... Ms>
+void swap(nothrow_multi_lock<Ms...>& lhs, nothrow_multi_lock<Ms...>& rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+// A multi_lock owning shared ownership of the mutexes.
+template <detail::SharedLockable... Ms>
+class multi_shared_lock {
   public:
     using mutex_type = std::tuple<Ms*...>;
 
     // Constructors
-    multi_lock() noexcept = default;
+    multi_shared_lock() noexcept = default;
 
-    explicit multi_lock(Ms&... ms)
+    explicit multi_shared_lock(Ms&... ms)
         requires(sizeof...(Ms) > 0)
         : m_ms(std::addressof(ms)...) {
         lock();
     }
 
-    multi_lock(std::defer_lock_t, Ms&... ms) noexcept : m_ms(std::addressof(ms)...) {}
+    multi_shared_lock(std::defer_lock_t, Ms&... ms) noexcept : m_ms(std::addressof(ms)...) {}
 
-    multi_lock(std::try_to_lock_t, Ms&... ms)
-        requires(... && detail::Lockable<Ms>)
-        : m_ms(std::addressof(ms)...) {
-        try_lock();
-    }
+    multi_shared_lock(std::try_to_lock_t, Ms&... ms) : m_ms(std::addressof(ms)...) { try_lock(); }
 
-    multi_lock(std::adopt_lock_t, Ms&... ms) noexcept : m_ms(std::addressof(ms)...), m_locked(true) {}
+    multi_shared_lock(std::adopt_lock_t, Ms&... ms) noexcept : m_ms(std::addressof(ms)...), m_locked(true) {}
 
     template <class Rep, class Period>
-        requires(... && detail::TimedLockable<Ms>)
-    multi_lock(const std::chrono::duration<Rep, Period>& dur, Ms&... ms) : m_ms(std::addressof(ms)...) {
+        requires(... && detail::SharedTimedLockable<Ms>)
+    multi_shared_lock(const std::chrono::duration<Rep, Period>& dur, Ms&... ms) : m_ms(std::addressof(ms)...) {
         try_lock_for(dur);
     }
 
     template <class Clock, class Duration>
-        requires(... && detail::TimedLockable<Ms>)
-    multi_lock(const std::chrono::time_point<Clock, Duration>& tp, Ms&... ms) : m_ms(std::addressof(ms)...) {
+        requires(... && detail::SharedTimedLockable<Ms>)
+    multi_shared_lock(const std::chrono::time_point<Clock, Duration>& tp, Ms&... ms) : m_ms(std::addressof(ms)...) {
         try_lock_until(tp);
     }
 
+    template <class Rep, class Period, class Backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> &&
+                 (... && detail::SharedTimedLockable<Ms>))
+    multi_shared_lock(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, Ms&... ms)
+        : m_ms(std::addressof(ms)...) {
+        try_lock_for(dur, std::move(backoff));
+    }
+
+    template <class Clock, class Duration, class Backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> &&
+                 (... && detail::SharedTimedLockable<Ms>))
+    multi_shared_lock(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, Ms&... ms)
+        : m_ms(std::addressof(ms)...) {
+        try_lock_until(tp, std::move(backoff));
+    }
+
     // Destructor
-    ~multi_lock() {
+    ~multi_shared_lock() {
         if (m_locked)
             unlock();
     }
 
     // Move operations
-    multi_lock(multi_lock&& other) noexcept
+    multi_shared_lock(multi_shared_lock&& other) noexcept
         : m_ms(std::exchange(other.m_ms, std::tuple<Ms*...>{})), m_locked(std::exchange(other.m_locked, false)) {}
 
-    multi_lock& operator=(multi_lock&& other) noexcept {
-        multi_lock(std::move(other)).swap(*this);
+    multi_shared_lock& operator=(multi_shared_lock&& other) noexcept {
+        multi_shared_lock(std::move(other)).swap(*this);
         return *this;
     }
 
     // Deleted copy operations
-    multi_lock(const multi_lock&)            = delete;
-    multi_lock& operator=(const multi_lock&) = delete;
+    multi_shared_lock(const multi_shared_lock&)            = delete;
+    multi_shared_lock& operator=(const multi_shared_lock&) = delete;
 
     // Locking operations
   private:
     void lock_check() {
         if (m_locked) {
-            throw std::system_error(std::make_error_code(std::errc::resource_deadlock_would_occur));
+            detail::throw_system_error(std::errc::resource_deadlock_would_occur);
         }
         if constexpr (sizeof...(Ms) != 0) {
             if (std::get<0>(m_ms) == nullptr) {
-                throw std::system_error(std::make_error_code(std::errc::operation_not_permitted));
+                detail::throw_system_error(std::errc::operation_not_permitted);
             }
         }
     }
 
+    std::tuple<shared_lockable<Ms>...> adapters() const noexcept {
+        return std::apply([](auto... ms) { return std::tuple(shared_lockable(*ms)...); }, m_ms);
+    }
+
   public:
-    void lock()
-        requires(sizeof...(Ms) == 1 || (... && detail::Lockable<Ms>))
-    {
+    void lock() {
         lock_check();
         if constexpr (sizeof...(Ms) == 1) {
-            std::get<sizeof...(Ms) - 1>(m_ms)->lock();
+            std::get<0>(m_ms)->lock_shared();
         } else if constexpr (sizeof...(Ms) > 1) {
-            std::apply([](auto... ms) { std::lock(*ms...); }, m_ms);
+            auto lks = adapters();
+            std::apply([](auto&... as) { std::lock(as...); }, lks);
         }
         m_locked = true;
     }
 
-    int try_lock()
-        requires(... && detail::Lockable<Ms>)
-    {
+    int try_lock() {
         lock_check();
         int rv;
         if constexpr (sizeof...(Ms) == 0) {
             rv = -1;
         } else if constexpr (sizeof...(Ms) == 1) {
-            rv = -static_cast<int>(std::get<sizeof...(Ms) - 1>(m_ms)->try_lock());
+            rv = -static_cast<int>(std::get<0>(m_ms)->try_lock_shared());
         } else {
-            rv = std::apply([](auto... ms) { return std::try_lock(*ms...); }, m_ms);
+            auto lks = adapters();
+            rv       = std::apply([](auto&... as) { return std::try_lock(as...); }, lks);
         }
         m_locked = rv == -1;
         return rv;
     }
 
-    template <class Rep, class Period>
-        requires(... && detail::TimedLockable<Ms>)
-    int try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+    template <class Rep, class Period, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> &&
+                 (... && detail::SharedTimedLockable<Ms>))
+    int try_lock_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff = {}) {
         lock_check();
-        int rv   = std::apply([&](auto... ms) { return beman::timed_lock_alg::try_lock_for(dur, *ms...); }, m_ms);
+        int rv = std::apply(
+            [&](auto... ms) { return beman::timed_lock_alg::try_lock_shared_for(dur, std::move(backoff), *ms...); },
+            m_ms);
         m_locked = rv == -1;
         return rv;
     }
 
-    template <class Clock, class Duration>
-        requires(... && detail::TimedLockable<Ms>)
-    int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+    template <class Clock, class Duration, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> &&
+                 (... && detail::SharedTimedLockable<Ms>))
+    int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff = {}) {
         lock_check();
-        int rv   = std::apply([&](auto... ms) { return beman::timed_lock_alg::try_lock_until(tp, *ms...); }, m_ms);
+        int rv = std::apply(
+            [&](auto... ms) { return beman::timed_lock_alg::try_lock_shared_until(tp, std::move(backoff), *ms...); },
+            m_ms);
         m_locked = rv == -1;
         return rv;
     }
 
     void unlock() {
         if (not m_locked) {
-            throw std::system_error(std::make_error_code(std::errc::operation_not_permitted));
+            detail::throw_system_error(std::errc::operation_not_permitted);
         }
-        // clang doesn't seem to understand that "unlocker" is actually used to unlock all mutexes at the end of the
-        // scope even if one of them throws so mark it as maybe_unused.
+        // see multi_lock::unlock
+        auto                  lks = adapters();
         [[maybe_unused]] auto unlocker =
-            std::apply([](auto... ms) { return std::scoped_lock(std::adopt_lock, *ms...); }, m_ms);
+            std::apply([](auto&... as) { return std::scoped_lock(std::adopt_lock, as...); }, lks);
         m_locked = false;
     }
 
     // Modifiers
-    void swap(multi_lock& other) noexcept {
+    void swap(multi_shared_lock& other) noexcept {
         std::swap(m_ms, other.m_ms);
         std::swap(m_locked, other.m_locked);
     }
@@ -261,7 +2121,342 @@ class multi_lock {
 };
 
 template <class... Ms>
-void swap(multi_lock<Ms...>& lhs, multi_lock<Ms...>& rhs) noexcept {
+void swap(multi_shared_lock<Ms...>& lhs, multi_shared_lock<Ms...>& rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+// A multi_lock over a lock set chosen at run time. Up to InlineN lockables are stored in the object itself, larger
+// sets allocate. Like multi_lock, a lock without a lock set, default constructed or moved from, reports
+// operation_not_permitted when locked. An empty set is trivially locked, like a multi_lock<> without lockables.
+template <detail::Lockable M, std::size_t InlineN = 8>
+class dynamic_multi_lock {
+  public:
+    using mutex_type = std::span<M* const>;
+
+    // Constructors
+    dynamic_multi_lock() noexcept = default;
+
+    template <detail::LockableRangeOf<M> R>
+    explicit dynamic_multi_lock(R&& r, lock_order_site site = lock_order_site::current()) {
+        assign(r);
+        lock(site);
+    }
+
+    template <detail::LockableRangeOf<M> R>
+    dynamic_multi_lock(std::defer_lock_t, R&& r) {
+        assign(r);
+    }
+
+    template <detail::LockableRangeOf<M> R>
+    dynamic_multi_lock(std::try_to_lock_t, R&& r, lock_order_site site = lock_order_site::current()) {
+        assign(r);
+        try_lock(site);
+    }
+
+    template <detail::LockableRangeOf<M> R>
+    dynamic_multi_lock(std::adopt_lock_t, R&& r) {
+        assign(r);
+        m_locked = true;
+    }
+
+    template <class Rep, class Period, detail::LockableRangeOf<M> R>
+        requires detail::TimedLockable<M>
+    dynamic_multi_lock(const std::chrono::duration<Rep, Period>& dur,
+                       R&&                                       r,
+                       lock_order_site                           site = lock_order_site::current()) {
+        assign(r);
+        try_lock_for(dur, yield_backoff{}, site);
+    }
+
+    template <class Clock, class Duration, detail::LockableRangeOf<M> R>
+        requires detail::TimedLockable<M>
+    dynamic_multi_lock(const std::chrono::time_point<Clock, Duration>& tp,
+                       R&&                                             r,
+                       lock_order_site                                 site = lock_order_site::current()) {
+        assign(r);
+        try_lock_until(tp, yield_backoff{}, site);
+    }
+
+    template <class Rep, class Period, class Backoff, detail::LockableRangeOf<M> R>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> && detail::TimedLockable<M>)
+    dynamic_multi_lock(const std::chrono::duration<Rep, Period>& dur,
+                       Backoff                                   backoff,
+                       R&&                                       r,
+                       lock_order_site                           site = lock_order_site::current()) {
+        assign(r);
+        try_lock_for(dur, std::move(backoff), site);
+    }
+
+    template <class Clock, class Duration, class Backoff, detail::LockableRangeOf<M> R>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> && detail::TimedLockable<M>)
+    dynamic_multi_lock(const std::chrono::time_point<Clock, Duration>& tp,
+                       Backoff                                         backoff,
+                       R&&                                             r,
+                       lock_order_site                                 site = lock_order_site::current()) {
+        assign(r);
+        try_lock_until(tp, std::move(backoff), site);
+    }
+
+    template <class Key, class Rep, class Period, detail::LockableRangeOf<M> R>
+        requires detail::TimedLockable<M>
+    dynamic_multi_lock(const ordered_lock_t<Key>&                ord,
+                       const std::chrono::duration<Rep, Period>& dur,
+                       R&&                                       r,
+                       lock_order_site                           site = lock_order_site::current()) {
+        assign(r);
+        try_lock_for(ord, dur, site);
+    }
+
+    template <class Key, class Clock, class Duration, detail::LockableRangeOf<M> R>
+        requires detail::TimedLockable<M>
+    dynamic_multi_lock(const ordered_lock_t<Key>&                      ord,
+                       const std::chrono::time_point<Clock, Duration>& tp,
+                       R&&                                             r,
+                       lock_order_site                                 site = lock_order_site::current()) {
+        assign(r);
+        try_lock_until(ord, tp, site);
+    }
+
+    // Destructor
+    ~dynamic_multi_lock() {
+        if (m_locked)
+            unlock();
+    }
+
+    // Move operations
+    dynamic_multi_lock(dynamic_multi_lock&& other) noexcept
+        : m_inline(other.m_inline), m_heap(std::move(other.m_heap)), m_size(std::exchange(other.m_size, 0)),
+          m_has_set(std::exchange(other.m_has_set, false)), m_locked(std::exchange(other.m_locked, false)),
+          m_hold(std::exchange(other.m_hold, {})) {}
+
+    dynamic_multi_lock& operator=(dynamic_multi_lock&& other) noexcept {
+        dynamic_multi_lock(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    // Deleted copy operations
+    dynamic_multi_lock(const dynamic_multi_lock&)            = delete;
+    dynamic_multi_lock& operator=(const dynamic_multi_lock&) = delete;
+
+    // Locking operations
+  private:
+    template <class R>
+    void assign(R& r) {
+        m_has_set = true;
+        m_size    = static_cast<std::size_t>(std::ranges::size(r));
+        if (m_size > InlineN) {
+            m_heap.reset(new M*[m_size]);
+        }
+        M** out = data();
+        for (auto&& elem : r) {
+            *out++ = std::addressof(detail::lockable_ref(elem));
+        }
+    }
+
+    M**       data() noexcept { return m_heap ? m_heap.get() : m_inline.data(); }
+    M* const* data() const noexcept { return m_heap ? m_heap.get() : m_inline.data(); }
+
+    void lock_check() const {
+        if (m_locked) {
+            detail::throw_system_error(std::errc::resource_deadlock_would_occur);
+        }
+        if (not m_has_set) {
+            detail::throw_system_error(std::errc::operation_not_permitted);
+        }
+    }
+
+    // tell the lock-order validator, the hold timer and the trace points, if enabled, about the lockables
+    void note_acquired([[maybe_unused]] const lock_order_site& site) noexcept {
+        if (m_locked) {
+            if constexpr (detail::validate_lock_order) {
+                lock_order_acquired(mutex(), site);
+            }
+            if constexpr (detail::tracing) {
+                if (m_size != 0) {
+                    detail::trace_held(data()[0], m_size);
+                }
+            }
+            m_hold.start(site);
+        }
+    }
+
+    void note_released() noexcept {
+        m_hold.stop();
+        if constexpr (detail::tracing) {
+            if (m_size != 0) {
+                detail::trace_unlock(data()[0], m_size);
+            }
+        }
+        if constexpr (detail::validate_lock_order) {
+            lock_order_released(mutex());
+        }
+    }
+
+    // release() stops timing the hold but, as the lockables stay locked, leaves them held for the validator
+    void note_given_up() noexcept {
+        m_hold.cancel();
+        if constexpr (detail::tracing) {
+            if (m_size != 0) {
+                detail::trace_release(data()[0], m_size);
+            }
+        }
+    }
+
+    // unlocks the first n lockables starting at first in rotation order
+    void unlock_from(std::size_t first, std::size_t n) noexcept {
+        for (std::size_t i = n; i != 0; --i) {
+            data()[(first + i - 1) % m_size]->unlock();
+        }
+    }
+
+  public:
+    // Like std::lock: blocks on one lockable, tries the others and starts over blocking on the one that failed.
+    void lock(lock_order_site site = lock_order_site::current()) {
+        lock_check();
+        std::size_t first = 0;
+        while (m_size != 0) {
+            std::unique_lock<M> lead(*data()[first]);
+            std::size_t         fail = (first + 1) % m_size;
+            {
+                detail::rotation_unlocker<M**> unlocker{data(), m_size, fail, fail};
+                for (; fail != first && data()[fail]->try_lock(); fail = (fail + 1) % m_size) {
+                    unlocker.to = (fail + 1) % m_size;
+                }
+                if (fail == first) {
+                    unlocker.from = unlocker.to; // keep all
+                    lead.release();
+                    break;
+                }
+            }
+            first = fail;
+            lead.unlock();
+            std::this_thread::yield();
+        }
+        m_locked = true;
+        note_acquired(site);
+    }
+
+    int try_lock(lock_order_site site = lock_order_site::current()) {
+        lock_check();
+        int rv = -1;
+        for (std::size_t i = 0; i != m_size; ++i) {
+            if (not data()[i]->try_lock()) {
+                unlock_from(0, i);
+                rv = static_cast<int>(i);
+                break;
+            }
+        }
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    template <class Rep, class Period, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point> && detail::TimedLockable<M>)
+    int try_lock_for(const std::chrono::duration<Rep, Period>& dur,
+                     Backoff                                   backoff = {},
+                     lock_order_site                           site    = lock_order_site::current()) {
+        lock_check();
+        int rv   = beman::timed_lock_alg::try_lock_for(dur, std::move(backoff), mutex());
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    template <class Clock, class Duration, class Backoff = yield_backoff>
+        requires(detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>> && detail::TimedLockable<M>)
+    int try_lock_until(const std::chrono::time_point<Clock, Duration>& tp,
+                       Backoff                                        backoff = {},
+                       lock_order_site                                site    = lock_order_site::current()) {
+        lock_check();
+        int rv   = beman::timed_lock_alg::try_lock_until(tp, std::move(backoff), mutex());
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    template <class Key, class Rep, class Period>
+        requires detail::TimedLockable<M>
+    int try_lock_for(const ordered_lock_t<Key>&                  ord,
+                     const std::chrono::duration<Rep, Period>& dur,
+                     lock_order_site                           site = lock_order_site::current()) {
+        lock_check();
+        int rv   = beman::timed_lock_alg::try_lock_for(ord, dur, mutex());
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    template <class Key, class Clock, class Duration>
+        requires detail::TimedLockable<M>
+    int try_lock_until(const ordered_lock_t<Key>&                       ord,
+                       const std::chrono::time_point<Clock, Duration>& tp,
+                       lock_order_site                                site = lock_order_site::current()) {
+        lock_check();
+        int rv   = beman::timed_lock_alg::try_lock_until(ord, tp, mutex());
+        m_locked = rv == -1;
+        note_acquired(site);
+        return rv;
+    }
+
+    void unlock() {
+        if (not m_locked) {
+            detail::throw_system_error(std::errc::operation_not_permitted);
+        }
+        m_locked = false;
+        note_released();
+        unlock_from(0, m_size);
+    }
+
+    // Modifiers
+    void swap(dynamic_multi_lock& other) noexcept {
+        std::swap(m_inline, other.m_inline);
+        std::swap(m_heap, other.m_heap);
+        std::swap(m_size, other.m_size);
+        std::swap(m_has_set, other.m_has_set);
+        std::swap(m_locked, other.m_locked);
+        std::swap(m_hold, other.m_hold);
+    }
+
+    // Gives up ownership without unlocking. The lock set stays associated with this object, so the result refers to
+    // it until it is destroyed, moved or assigned to, and releasing a temporary is not allowed. The lock-order
+    // validator keeps the lockables held until the caller reports unlocking them with lock_order_released.
+    mutex_type release() & noexcept {
+        if (m_locked) {
+            note_given_up();
+        }
+        m_locked = false;
+        return mutex();
+    }
+
+    mutex_type release() && = delete;
+
+    // Observers
+    mutex_type  mutex() const noexcept { return mutex_type(data(), m_size); }
+    std::size_t size() const noexcept { return m_size; }
+    bool        owns_lock() const noexcept { return m_locked; }
+    explicit    operator bool() const noexcept { return m_locked; }
+
+  private:
+    std::array<M*, InlineN>                  m_inline{};
+    std::unique_ptr<M*[]>                    m_heap;
+    std::size_t                              m_size    = 0;
+    bool                                     m_has_set = false;
+    bool                                     m_locked  = false;
+    [[no_unique_address]] detail::hold_timer m_hold;
+};
+
+template <std::ranges::input_range R>
+dynamic_multi_lock(R&&) -> dynamic_multi_lock<detail::range_lockable_t<R>>;
+
+template <class Tag, std::ranges::input_range R>
+dynamic_multi_lock(const Tag&, R&&) -> dynamic_multi_lock<detail::range_lockable_t<R>>;
+
+template <class T, class U, std::ranges::input_range R>
+dynamic_multi_lock(const T&, const U&, R&&) -> dynamic_multi_lock<detail::range_lockable_t<R>>;
+
+template <class M, std::size_t InlineN>
+void swap(dynamic_multi_lock<M, InlineN>& lhs, dynamic_multi_lock<M, InlineN>& rhs) noexcept {
     lhs.swap(rhs);
 }
 } // namespace beman::timed_lock_alg
@@ -0,0 +1,214 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_OBSERVER_HPP
+#define BEMAN_TIMED_LOCK_ALG_OBSERVER_HPP
+
+#include <beman/timed_lock_alg/backoff.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+namespace beman::timed_lock_alg::detail {
+// An observer is told what the timed lock algorithms do during a call:
+//   on_blocked(idx, dur)     - blocked dur in the timed wait for the lockable at idx
+//   on_failed(idx)           - a round failed because the lockable at idx could not be locked
+//   on_backoff()             - the backoff policy is about to be called before the next round
+//   on_finished(rv, rounds)  - the call returns rv after rounds rounds
+template <class O>
+concept LockObserver = requires(O& o, std::size_t idx, std::chrono::steady_clock::duration dur, int rv) {
+    o.on_blocked(idx, dur);
+    o.on_failed(idx);
+    o.on_backoff();
+    o.on_finished(rv, idx);
+};
+
+// An observer that also keeps a contention history makes the algorithms probe the lockables that made the most rounds
+// fail first, and block on the hottest one in the first round:
+//   hotness(idx)  - a score that's higher the more often the lockable at idx made rounds fail recently, 0 if unknown
+template <class O>
+concept ContentionHistory = LockObserver<O> && requires(const O& o, std::size_t idx) {
+    { o.hotness(idx) } -> std::convertible_to<std::uint32_t>;
+};
+
+struct null_observer {
+    void on_blocked(std::size_t, std::chrono::steady_clock::duration) const noexcept {}
+    void on_failed(std::size_t) const noexcept {}
+    void on_backoff() const noexcept {}
+    void on_finished(int, std::size_t) const noexcept {}
+};
+
+template <class B>
+concept ObservedBackoff = requires(const B& b) {
+    { b.observer() } -> LockObserver;
+};
+
+// the observer attached to the backoff policy or a null_observer which compiles away
+template <class Backoff>
+decltype(auto) observer_of(const Backoff& backoff) noexcept {
+    if constexpr (ObservedBackoff<Backoff>) {
+        return backoff.observer();
+    } else {
+        return null_observer{};
+    }
+}
+
+// std::unique_lock{l, tp} reporting the time blocked to the observer
+template <class Observer, class L, class Timepoint>
+std::unique_lock<L> observed_lock_until(Observer& observer, std::size_t idx, L& l, const Timepoint& tp) {
+    if constexpr (std::same_as<std::remove_cvref_t<Observer>, null_observer>) {
+        return std::unique_lock<L>{l, tp};
+    } else {
+        const auto          start = std::chrono::steady_clock::now();
+        std::unique_lock<L> lock{l, tp};
+        observer.on_blocked(idx, std::chrono::steady_clock::now() - start);
+        return lock;
+    }
+}
+} // namespace beman::timed_lock_alg::detail
+
+namespace beman::timed_lock_alg {
+// A backoff policy that attaches an observer to a call of the timed lock algorithms and otherwise behaves like
+// Backoff. It is passed wherever a backoff policy is accepted. Without it, the algorithms don't do any bookkeeping.
+template <class Observer, class Backoff = yield_backoff>
+class observed_backoff {
+  public:
+    constexpr explicit observed_backoff(Observer& observer, Backoff backoff = {}) noexcept(
+        std::is_nothrow_move_constructible_v<Backoff>)
+        : m_observer(std::addressof(observer)), m_backoff(std::move(backoff)) {}
+
+    template <class Timepoint>
+    void operator()(const Timepoint& tp) {
+        m_backoff(tp);
+    }
+
+    Observer& observer() const noexcept { return *m_observer; }
+
+    constexpr std::size_t escalation_rounds() const noexcept
+        requires requires(const Backoff& b) { b.escalation_rounds(); }
+    {
+        return m_backoff.escalation_rounds();
+    }
+
+  private:
+    Observer* m_observer;
+    Backoff   m_backoff;
+};
+
+template <detail::LockObserver Observer, class Backoff = yield_backoff>
+constexpr observed_backoff<Observer, Backoff> observe(Observer& observer, Backoff backoff = {}) {
+    return observed_backoff<Observer, Backoff>(observer, std::move(backoff));
+}
+
+// An observer aggregating the statistics of all calls it observes, typically one per call site. It may be shared
+// by threads. Failures are counted per argument index for the first MaxLockables indices.
+template <std::size_t MaxLockables = 16>
+class contention_counters {
+  public:
+    void on_blocked(std::size_t, std::chrono::steady_clock::duration dur) noexcept {
+        m_blocked_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(dur).count(),
+                               std::memory_order_relaxed);
+    }
+
+    void on_failed(std::size_t idx) noexcept {
+        if (idx < MaxLockables) {
+            // through data() since GCC's -Warray-bounds misfires on operator[] here despite the check above
+            m_failures.data()[idx].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void on_backoff() noexcept { m_backoffs.fetch_add(1, std::memory_order_relaxed); }
+
+    void on_finished(int rv, std::size_t rounds) noexcept {
+        m_calls.fetch_add(1, std::memory_order_relaxed);
+        m_rounds.fetch_add(rounds, std::memory_order_relaxed);
+        if (rv != -1) {
+            m_timeouts.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t calls() const noexcept { return m_calls.load(std::memory_order_relaxed); }
+    std::uint64_t timeouts() const noexcept { return m_timeouts.load(std::memory_order_relaxed); }
+    std::uint64_t rounds() const noexcept { return m_rounds.load(std::memory_order_relaxed); }
+    std::uint64_t backoffs() const noexcept { return m_backoffs.load(std::memory_order_relaxed); }
+
+    std::chrono::nanoseconds blocked_time() const noexcept {
+        return std::chrono::nanoseconds(m_blocked_ns.load(std::memory_order_relaxed));
+    }
+
+    // the number of failed rounds caused by the lockable at idx
+    std::uint64_t failures(std::size_t idx) const noexcept {
+        return idx < MaxLockables ? m_failures[idx].load(std::memory_order_relaxed) : 0;
+    }
+
+    void reset() noexcept {
+        m_calls.store(0, std::memory_order_relaxed);
+        m_timeouts.store(0, std::memory_order_relaxed);
+        m_rounds.store(0, std::memory_order_relaxed);
+        m_backoffs.store(0, std::memory_order_relaxed);
+        m_blocked_ns.store(0, std::memory_order_relaxed);
+        for (auto& failures : m_failures) {
+            failures.store(0, std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    std::atomic<std::uint64_t>                           m_calls{0};
+    std::atomic<std::uint64_t>                           m_timeouts{0};
+    std::atomic<std::uint64_t>                           m_rounds{0};
+    std::atomic<std::uint64_t>                           m_backoffs{0};
+    std::atomic<std::int64_t>                            m_blocked_ns{0};
+    std::array<std::atomic<std::uint64_t>, MaxLockables> m_failures{};
+};
+
+// An observer keeping a decaying count of the failed rounds per argument index, typically one per call site. With it,
+// the algorithms try to lock the lockables that fail most often first, so that a round touching a hot lockable fails
+// before locking the others. It may be shared by threads. The first MaxLockables indices are tracked, the scores are
+// halved every DecayInterval calls.
+template <std::size_t MaxLockables = 16, std::uint32_t DecayInterval = 64>
+class contention_history {
+  public:
+    static_assert(DecayInterval != 0);
+
+    void on_blocked(std::size_t, std::chrono::steady_clock::duration) const noexcept {}
+
+    void on_failed(std::size_t idx) noexcept {
+        if (idx < MaxLockables) {
+            m_scores[idx].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void on_backoff() const noexcept {}
+
+    void on_finished(int, std::size_t) noexcept {
+        if (m_calls.fetch_add(1, std::memory_order_relaxed) % DecayInterval == DecayInterval - 1) {
+            // not atomic as a whole, failures counted meanwhile may get lost which is fine for a heuristic
+            for (auto& score : m_scores) {
+                score.store(score.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::uint32_t hotness(std::size_t idx) const noexcept {
+        return idx < MaxLockables ? m_scores[idx].load(std::memory_order_relaxed) : 0;
+    }
+
+    void reset() noexcept {
+        m_calls.store(0, std::memory_order_relaxed);
+        for (auto& score : m_scores) {
+            score.store(0, std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    std::atomic<std::uint32_t>                           m_calls{0};
+    std::array<std::atomic<std::uint32_t>, MaxLockables> m_scores{};
+};
+} // namespace beman::timed_lock_alg
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_SHARDED_SHARED_TIMED_MUTEX_HPP
+#define BEMAN_TIMED_LOCK_ALG_SHARDED_SHARED_TIMED_MUTEX_HPP
+
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace beman::timed_lock_alg {
+// A SharedTimedLockable reader/writer mutex for read-mostly data. std::shared_timed_mutex counts its readers in a
+// single word, which every lock_shared/unlock_shared of every core writes. Here each thread counts its shared locks
+// in one of reader_slots() cache-line sized slots picked by the thread, so readers on different cores don't touch
+// the same cache line unless a writer comes along.
+//
+// A writer announces itself with a flag that readers check after counting themselves, and then waits until all
+// slots are empty, giving up at its deadline. Readers arriving while a writer is announced wait for it, so writers
+// are not starved. An exclusive lock costs a pass over the slots, so this fits data written rarely.
+class sharded_shared_timed_mutex {
+  public:
+    // the alignment of the reader slots, so that each has a cache line of its own
+    static constexpr std::size_t slot_alignment = 64;
+
+    // Uses the next power of two of std::thread::hardware_concurrency() slots, at most 256.
+    sharded_shared_timed_mutex();
+    // Uses slots slots, rounded up to a power of two.
+    explicit sharded_shared_timed_mutex(std::size_t slots);
+    sharded_shared_timed_mutex(const sharded_shared_timed_mutex&)            = delete;
+    sharded_shared_timed_mutex& operator=(const sharded_shared_timed_mutex&) = delete;
+
+    // Exclusive locking
+    void lock() { static_cast<void>(lock_until_steady(nullptr)); }
+
+    bool try_lock() noexcept;
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        return try_lock_until(std::chrono::steady_clock::now() + dur);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        const auto steady_tp = detail::to_steady(tp);
+        return lock_until_steady(&steady_tp);
+    }
+
+    void unlock() noexcept {
+        m_writer.store(false, std::memory_order_seq_cst);
+        if (m_waiting.load(std::memory_order_seq_cst) != 0) {
+            wake_waiters();
+        }
+    }
+
+    // Shared locking
+    void lock_shared() {
+        if (not try_lock_shared()) {
+            static_cast<void>(lock_shared_until_steady(nullptr));
+        }
+    }
+
+    bool try_lock_shared() noexcept {
+        auto& count = slot();
+        count.fetch_add(1, std::memory_order_seq_cst);
+        if (not m_writer.load(std::memory_order_seq_cst)) {
+            return true;
+        }
+        back_off(count);
+        return false;
+    }
+
+    template <class Rep, class Period>
+    bool try_lock_shared_for(const std::chrono::duration<Rep, Period>& dur) {
+        return try_lock_shared_until(std::chrono::steady_clock::now() + dur);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        if (try_lock_shared()) {
+            return true;
+        }
+        const auto steady_tp = detail::to_steady(tp);
+        return lock_shared_until_steady(&steady_tp);
+    }
+
+    void unlock_shared() noexcept {
+        slot().fetch_sub(1, std::memory_order_seq_cst);
+        if (m_writer.load(std::memory_order_seq_cst)) {
+            // the writer may be waiting for this reader
+            wake_writer();
+        }
+    }
+
+    // Observers
+    std::size_t reader_slots() const noexcept { return m_mask + 1; }
+
+  private:
+    struct alignas(slot_alignment) reader_slot {
+        std::atomic<std::uint32_t> count{0};
+    };
+
+    // the slot of the calling thread. Threads are given slots round robin in the order they first use one.
+    std::atomic<std::uint32_t>& slot() const noexcept {
+        static std::atomic<std::size_t> next{0};
+        thread_local const std::size_t  index = next.fetch_add(1, std::memory_order_relaxed);
+        return m_slots[index & m_mask].count;
+    }
+
+    // undoes the count of a reader that found a writer
+    void back_off(std::atomic<std::uint32_t>& count) noexcept {
+        count.fetch_sub(1, std::memory_order_seq_cst);
+        wake_writer();
+    }
+
+    // the slow paths, waiting until *tp or without a deadline if tp is null
+    bool lock_until_steady(const std::chrono::steady_clock::time_point* tp);
+    bool lock_shared_until_steady(const std::chrono::steady_clock::time_point* tp);
+
+    bool readers_drained() const noexcept;
+    // wakes the writer waiting for the readers to drain
+    void wake_writer() noexcept;
+    // wakes the threads waiting for m_writer to be cleared
+    void wake_waiters() noexcept;
+
+    std::unique_ptr<reader_slot[]> m_slots;
+    std::size_t                    m_mask = 0;
+    // set while a writer owns or is waiting for the readers to drain. On a cache line of its own since the readers
+    // read it on every lock_shared.
+    alignas(slot_alignment) std::atomic<bool> m_writer{false};
+    // the number of threads waiting on m_writer_gone
+    alignas(slot_alignment) std::atomic<std::uint32_t> m_waiting{0};
+    std::mutex              m_gate;
+    std::condition_variable m_writer_gone;
+    std::condition_variable m_drained;
+};
+} // namespace beman::timed_lock_alg
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_STRIPED_LOCK_TABLE_HPP
+#define BEMAN_TIMED_LOCK_ALG_STRIPED_LOCK_TABLE_HPP
+
+#include <beman/timed_lock_alg/backoff.hpp>
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <utility>
+
+namespace beman::timed_lock_alg {
+// The alignment of the stripes of a striped_lock_table, so that threads locking neighbouring stripes don't share a
+// cache line. std::hardware_destructive_interference_size isn't used since it may differ between translation units.
+inline constexpr std::size_t stripe_alignment = 64;
+
+// The default hash of striped_lock_table, which hashes each key with std::hash of its type.
+struct key_hash {
+    template <class K>
+    std::size_t operator()(const K& key) const noexcept(noexcept(std::hash<K>{}(key))) {
+        return std::hash<K>{}(key);
+    }
+};
+
+// Owns the stripes of a striped_lock_table locked by lock_keys_until/lock_keys_for, at most MaxStripes of them.
+template <class Mutex, std::size_t MaxStripes>
+class stripe_lock {
+  public:
+    // Constructors
+    stripe_lock() noexcept = default;
+
+    // Takes ownership of the first n mutexes in ms, which the calling thread has locked.
+    stripe_lock(std::adopt_lock_t, const std::array<Mutex*, MaxStripes>& ms, std::size_t n) noexcept
+        : m_ms(ms), m_size(n), m_locked(true) {}
+
+    // Destructor
+    ~stripe_lock() {
+        if (m_locked)
+            unlock();
+    }
+
+    // Move operations
+    stripe_lock(stripe_lock&& other) noexcept
+        : m_ms(other.m_ms), m_size(std::exchange(other.m_size, 0)), m_locked(std::exchange(other.m_locked, false)) {}
+
+    stripe_lock& operator=(stripe_lock&& other) noexcept {
+        stripe_lock(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    // Deleted copy operations
+    stripe_lock(const stripe_lock&)            = delete;
+    stripe_lock& operator=(const stripe_lock&) = delete;
+
+    // Locking operations
+    void unlock() {
+        if (not m_locked) {
+            detail::throw_system_error(std::errc::operation_not_permitted);
+        }
+        m_locked = false;
+        for (std::size_t i = m_size; i != 0; --i) {
+            m_ms[i - 1]->unlock();
+        }
+    }
+
+    // Modifiers
+    void swap(stripe_lock& other) noexcept {
+        std::swap(m_ms, other.m_ms);
+        std::swap(m_size, other.m_size);
+        std::swap(m_locked, other.m_locked);
+    }
+
+    // Gives up ownership without unlocking. The result refers to the stripes stored in this object until it is
+    // destroyed, moved or assigned to, and releasing a temporary is not allowed.
+    std::span<Mutex* const> release() & noexcept {
+        m_locked = false;
+        return mutex();
+    }
+
+    std::span<Mutex* const> release() && = delete;
+
+    // Observers
+    // the distinct stripes, which may be fewer than the keys
+    std::span<Mutex* const> mutex() const noexcept { return std::span<Mutex* const>(m_ms.data(), m_size); }
+    bool                    owns_lock() const noexcept { return m_locked; }
+    explicit                operator bool() const noexcept { return m_locked; }
+
+  private:
+    std::array<Mutex*, MaxStripes> m_ms{};
+    std::size_t                    m_size   = 0;
+    bool                           m_locked = false;
+};
+
+template <class Mutex, std::size_t MaxStripes>
+void swap(stripe_lock<Mutex, MaxStripes>& lhs, stripe_lock<Mutex, MaxStripes>& rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+// A fixed array of N mutexes protecting an unbounded set of keys. Each key is hashed with Hash onto one of the
+// stripes. lock_keys_until locks the stripes of several keys with the timed multi-lock algorithm. Keys that hash to
+// the same stripe lock it once, so colliding keys don't deadlock with themselves.
+template <detail::TimedLockable Mutex = std::timed_mutex, std::size_t N = 64, class Hash = key_hash>
+    requires(N > 0)
+class striped_lock_table {
+  public:
+    using mutex_type = Mutex;
+    using hasher     = Hash;
+
+    template <std::size_t MaxStripes>
+    using lock_type = stripe_lock<Mutex, MaxStripes>;
+
+    striped_lock_table() = default;
+    explicit striped_lock_table(Hash hash) : m_hash(std::move(hash)) {}
+
+    striped_lock_table(const striped_lock_table&)            = delete;
+    striped_lock_table& operator=(const striped_lock_table&) = delete;
+
+    static constexpr std::size_t size() noexcept { return N; }
+
+    template <class K>
+    std::size_t stripe_of(const K& key) const {
+        // std::hash is the identity for integers, so mix the bits before reducing to a stripe
+        const auto mixed = static_cast<std::uint64_t>(std::invoke(m_hash, key)) * 0x9e3779b97f4a7c15u;
+        return static_cast<std::size_t>((mixed >> 32) % N);
+    }
+
+    Mutex&       stripe(std::size_t idx) noexcept { return m_stripes[idx].mutex; }
+    const Mutex& stripe(std::size_t idx) const noexcept { return m_stripes[idx].mutex; }
+
+    template <class K>
+    Mutex& stripe_for(const K& key) {
+        return stripe(stripe_of(key));
+    }
+
+    // Locks the stripes of all keys. The returned lock owns them on success and nothing if they could not all be
+    // locked before tp.
+    template <class Clock, class Duration, class Backoff, class... Keys>
+        requires detail::BackoffPolicy<Backoff, std::chrono::time_point<Clock, Duration>>
+    [[nodiscard]] lock_type<sizeof...(Keys)>
+    lock_keys_until(const std::chrono::time_point<Clock, Duration>& tp, Backoff backoff, const Keys&... keys) {
+        if constexpr (sizeof...(Keys) == 0) {
+            return lock_type<0>(std::adopt_lock, {}, 0);
+        } else {
+            std::array<std::size_t, sizeof...(Keys)> idx{stripe_of(keys)...};
+            std::ranges::sort(idx);
+            const auto n = static_cast<std::size_t>(std::ranges::unique(idx).begin() - idx.begin());
+
+            std::array<Mutex*, sizeof...(Keys)> ms{};
+            for (std::size_t i = 0; i != n; ++i) {
+                ms[i] = std::addressof(stripe(idx[i]));
+            }
+            const std::span<Mutex* const> stripes(ms.data(), n);
+            if (beman::timed_lock_alg::try_lock_until(tp, std::move(backoff), stripes) != -1) {
+                return {};
+            }
+            return lock_type<sizeof...(Keys)>(std::adopt_lock, ms, n);
+        }
+    }
+
+    template <class Clock, class Duration, class... Keys>
+    [[nodiscard]] lock_type<sizeof...(Keys)> lock_keys_until(const std::chrono::time_point<Clock, Duration>& tp,
+                                                             const Keys&... keys) {
+        return lock_keys_until(tp, yield_backoff{}, keys...);
+    }
+
+    template <class Rep, class Period, class Backoff, class... Keys>
+        requires detail::BackoffPolicy<Backoff, std::chrono::steady_clock::time_point>
+    [[nodiscard]] lock_type<sizeof...(Keys)>
+    lock_keys_for(const std::chrono::duration<Rep, Period>& dur, Backoff backoff, const Keys&... keys) {
+        return lock_keys_until(std::chrono::steady_clock::now() + dur, std::move(backoff), keys...);
+    }
+
+    template <class Rep, class Period, class... Keys>
+    [[nodiscard]] lock_type<sizeof...(Keys)> lock_keys_for(const std::chrono::duration<Rep, Period>& dur,
+                                                           const Keys&... keys) {
+        return lock_keys_until(std::chrono::steady_clock::now() + dur, keys...);
+    }
+
+  private:
+    struct alignas(stripe_alignment) padded_stripe {
+        Mutex mutex;
+    };
+
+    std::array<padded_stripe, N> m_stripes;
+    [[no_unique_address]] Hash   m_hash;
+};
+} // namespace beman::timed_lock_alg
+
+#endif
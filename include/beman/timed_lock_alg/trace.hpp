@@ -0,0 +1,141 @@
+#ifndef BEMAN_TIMED_LOCK_ALG_TRACE_HPP
+#define BEMAN_TIMED_LOCK_ALG_TRACE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// Lock tracing reports the rounds of the timed lock algorithms and the lifetime of the locks held by multi_lock and
+// dynamic_multi_lock. It is enabled by compiling the whole program with BEMAN_TIMED_LOCK_ALG_TRACING defined (the
+// CMake option of the same name). Without it, no trace points are compiled in.
+//
+// Each trace point is a USDT probe of the provider beman_timed_lock_alg when <sys/sdt.h> is available, which costs a
+// nop until a tracer like perf or bpftrace attaches. The first argument of each probe is the address of the first
+// lockable of the set, which identifies the set:
+//   round_start(set, lead, round) - a round of the rotation algorithm starts blocking on the lockable at index lead
+//   block(set, idx)               - the call is about to block on the lockable at idx
+//   failed(set, idx)              - a round failed because the lockable at idx could not be locked
+//   acquired(set, rounds)         - the call locked all lockables after rounds rounds
+//   timeout(set, idx)             - the call timed out on the lockable at idx
+//   held(set, count)              - a multi_lock or dynamic_multi_lock acquired count lockables
+//   unlock(set, count)            - a multi_lock or dynamic_multi_lock unlocked them
+//   release(set, count)           - a multi_lock or dynamic_multi_lock gave them up with release() without unlocking
+//
+// A call in ordered mode is a single round blocking on each lockable in turn. A call on futex_timed_mutexes blocks
+// on all the contended ones at once after a failed round, starting with the one at idx.
+//
+// The same trace points can be recorded in a ring buffer in the process while a trace is started and written as
+// Chrome trace event JSON, which chrome://tracing and Perfetto display as a timeline.
+
+#if defined(BEMAN_TIMED_LOCK_ALG_TRACING) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define BEMAN_TIMED_LOCK_ALG_USDT2(name, a, b) DTRACE_PROBE2(beman_timed_lock_alg, name, a, b)
+#define BEMAN_TIMED_LOCK_ALG_USDT3(name, a, b, c) DTRACE_PROBE3(beman_timed_lock_alg, name, a, b, c)
+#endif
+#endif
+#if !defined(BEMAN_TIMED_LOCK_ALG_USDT2)
+#define BEMAN_TIMED_LOCK_ALG_USDT2(name, a, b) static_cast<void>(0)
+#define BEMAN_TIMED_LOCK_ALG_USDT3(name, a, b, c) static_cast<void>(0)
+#endif
+
+namespace beman::timed_lock_alg {
+// the number of events the ring buffer keeps, older events are overwritten
+inline constexpr std::size_t lock_trace_capacity = 1 << 16;
+
+// Starts recording the trace points in the ring buffer, discarding the events recorded before.
+void start_lock_trace();
+
+// Stops recording. The recorded events are kept until the next start_lock_trace().
+void stop_lock_trace() noexcept;
+
+// Writes the recorded events as Chrome trace event JSON. Lock calls are shown as "lock wait" slices on the thread
+// that made them with their rounds and failures as instant events, and held locks as async "hold" slices, which
+// end with "released" in their arguments when release() gave them up. Events recorded concurrently may or may not be
+// included.
+void write_chrome_trace(std::ostream& os);
+} // namespace beman::timed_lock_alg
+
+namespace beman::timed_lock_alg::detail {
+// whether the trace points are compiled in
+inline constexpr bool tracing =
+#if defined(BEMAN_TIMED_LOCK_ALG_TRACING)
+    true;
+#else
+    false;
+#endif
+
+enum class trace_point : std::uint8_t { round_start, block, failed, acquired, timeout, held, unlock, release };
+
+extern std::atomic<bool> lock_trace_active;
+
+void record_trace_point(trace_point point, const void* set, std::size_t value) noexcept;
+
+inline void trace(trace_point point, const void* set, std::size_t value) noexcept {
+    if (lock_trace_active.load(std::memory_order_relaxed)) {
+        record_trace_point(point, set, value);
+    }
+}
+
+inline void trace_round_start([[maybe_unused]] const void* set,
+                              [[maybe_unused]] std::size_t lead,
+                              [[maybe_unused]] std::size_t round) noexcept {
+    if constexpr (tracing) {
+        BEMAN_TIMED_LOCK_ALG_USDT3(round_start, set, lead, round);
+        trace(trace_point::round_start, set, round);
+    }
+}
+
+inline void trace_block([[maybe_unused]] const void* set, [[maybe_unused]] std::size_t idx) noexcept {
+    if constexpr (tracing) {
+        BEMAN_TIMED_LOCK_ALG_USDT2(block, set, idx);
+        trace(trace_point::block, set, idx);
+    }
+}
+
+inline void trace_failed([[maybe_unused]] const void* set, [[maybe_unused]] std::size_t idx) noexcept {
+    if constexpr (tracing) {
+        BEMAN_TIMED_LOCK_ALG_USDT2(failed, set, idx);
+        trace(trace_point::failed, set, idx);
+    }
+}
+
+// the end of a call to the timed lock algorithms returning rv after rounds rounds
+inline void trace_finished([[maybe_unused]] const void* set,
+                           [[maybe_unused]] int         rv,
+                           [[maybe_unused]] std::size_t rounds) noexcept {
+    if constexpr (tracing) {
+        if (rv == -1) {
+            BEMAN_TIMED_LOCK_ALG_USDT2(acquired, set, rounds);
+            trace(trace_point::acquired, set, rounds);
+        } else {
+            BEMAN_TIMED_LOCK_ALG_USDT2(timeout, set, rv);
+            trace(trace_point::timeout, set, static_cast<std::size_t>(rv));
+        }
+    }
+}
+
+inline void trace_held([[maybe_unused]] const void* set, [[maybe_unused]] std::size_t count) noexcept {
+    if constexpr (tracing) {
+        BEMAN_TIMED_LOCK_ALG_USDT2(held, set, count);
+        trace(trace_point::held, set, count);
+    }
+}
+
+inline void trace_unlock([[maybe_unused]] const void* set, [[maybe_unused]] std::size_t count) noexcept {
+    if constexpr (tracing) {
+        BEMAN_TIMED_LOCK_ALG_USDT2(unlock, set, count);
+        trace(trace_point::unlock, set, count);
+    }
+}
+
+inline void trace_release([[maybe_unused]] const void* set, [[maybe_unused]] std::size_t count) noexcept {
+    if constexpr (tracing) {
+        BEMAN_TIMED_LOCK_ALG_USDT2(release, set, count);
+        trace(trace_point::release, set, count);
+    }
+}
+} // namespace beman::timed_lock_alg::detail
+
+#endif
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/async.hpp>
+
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_COROUTINES)
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#if defined(__cpp_lib_jthread)
+#include <stop_token>
+#endif
+#include <thread>
+
+namespace beman::timed_lock_alg::detail {
+struct async_access {
+    static std::mutex& list_mutex(async_timed_mutex& m) noexcept { return m.m_mtx; }
+    static void        remove(async_timed_mutex& m, async_waiter& w) noexcept { m.remove(w); }
+};
+
+namespace {
+using status = async_waiter::status;
+
+// The waiters handed over or timed out while this thread completes another one, linked through next. They are
+// completed after it returns rather than inside it, so a chain of coroutines each unlocking the mutex for the next
+// doesn't nest their resumptions on the stack of this thread.
+struct completion_queue {
+    async_waiter* head     = nullptr;
+    async_waiter* tail     = nullptr;
+    bool          draining = false;
+};
+thread_local completion_queue t_completions;
+
+// called without holding any lock when the outcome of w is decided
+void complete(async_waiter& w) noexcept {
+    auto& q = t_completions;
+    w.next  = nullptr;
+    if (q.draining) {
+        (q.tail != nullptr ? q.tail->next : q.head) = &w;
+        q.tail                                      = &w;
+        return;
+    }
+    q.draining = true;
+    w.complete(w);
+    while (q.head != nullptr) {
+        auto* const next = q.head;
+        q.head           = next->next;
+        if (q.head == nullptr) {
+            q.tail = nullptr;
+        }
+        next->complete(*next);
+    }
+    q.draining = false;
+}
+
+// Times out the coroutines waiting for async_timed_mutexes. Its thread is started when the first waiter with a
+// deadline is added.
+//
+// The lock of the timer is only taken while holding the list lock of a mutex, never the other way around. The timer
+// thread therefore releases its lock before taking the list lock of the mutex a waiter is timing out on, after
+// marking the waiter as firing. If the mutex is handed over to a firing waiter meanwhile, the timer thread completes
+// it instead of the unlocking thread.
+class timer_service {
+  public:
+    static timer_service& instance() {
+        static timer_service service;
+        return service;
+    }
+
+    ~timer_service() {
+        {
+            std::lock_guard lock(m_mtx);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    // called with the list lock of the owner of w held
+    void add(async_waiter& w) {
+        std::lock_guard lock(m_mtx);
+        if (not m_thread.joinable()) {
+            m_thread = std::thread([this] { run(); });
+        }
+        const bool earliest = m_waiters.empty() || by_deadline{}(&w, *m_waiters.begin());
+        m_waiters.insert(&w);
+        if (earliest) {
+            m_cv.notify_one();
+        }
+    }
+
+    // called with the list lock of the owner of w held. Returns false if the timer thread will complete w.
+    bool cancel(async_waiter& w) {
+        std::lock_guard lock(m_mtx);
+        if (w.timer_firing) {
+            return false;
+        }
+        m_waiters.erase(&w);
+        return true;
+    }
+
+  private:
+    struct by_deadline {
+        bool operator()(const async_waiter* lhs, const async_waiter* rhs) const noexcept {
+            if (lhs->deadline != rhs->deadline) {
+                return lhs->deadline < rhs->deadline;
+            }
+            return std::less<>{}(lhs, rhs);
+        }
+    };
+
+    void run() {
+        std::unique_lock lock(m_mtx);
+        while (not m_stop) {
+            if (m_waiters.empty()) {
+                m_cv.wait(lock);
+                continue;
+            }
+            auto* w = *m_waiters.begin();
+            // copy the deadline since w may be completed while waiting
+            const auto deadline = w->deadline;
+            if (std::chrono::steady_clock::now() < deadline) {
+                m_cv.wait_until(lock, deadline);
+                continue;
+            }
+            m_waiters.erase(m_waiters.begin());
+            w->timer_firing   = true;
+            auto* const owner = w->owner;
+            lock.unlock();
+            {
+                std::lock_guard list_lock(async_access::list_mutex(*owner));
+                if (w->result == status::waiting) {
+                    async_access::remove(*owner, *w);
+                    w->result = status::timed_out;
+                }
+            }
+            complete(*w);
+            lock.lock();
+        }
+    }
+
+    std::mutex                           m_mtx;
+    std::condition_variable              m_cv;
+    std::set<async_waiter*, by_deadline> m_waiters;
+    std::thread                          m_thread;
+    bool                                 m_stop = false;
+};
+
+// lets a thread block on an async_timed_mutex
+struct blocking_waiter {
+    std::mutex              mtx;
+    std::condition_variable cv;
+    bool                    done = false;
+
+    static void complete(async_waiter& w) noexcept {
+        auto&           self = *static_cast<blocking_waiter*>(w.context);
+        std::lock_guard lock(self.mtx);
+        self.done = true;
+        // notify while holding the lock since the waiting thread destroys self as soon as it sees done
+        self.cv.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock lock(mtx);
+        cv.wait(lock, [this] { return done; });
+    }
+
+    bool wait_until(std::chrono::steady_clock::time_point tp) {
+        std::unique_lock lock(mtx);
+        return cv.wait_until(lock, tp, [this] { return done; });
+    }
+};
+
+// Called when the thread blocked on w in waiter stops waiting before w was completed. Returns true if m was handed
+// over to w meanwhile.
+bool give_up(async_timed_mutex& m, async_waiter& w, blocking_waiter& waiter) {
+    {
+        std::lock_guard lock(async_access::list_mutex(m));
+        if (w.result == status::waiting) {
+            async_access::remove(m, w);
+            w.result = status::timed_out;
+            return false;
+        }
+    }
+    // the outcome of w was decided meanwhile, wait until the thread deciding it is done with w
+    waiter.wait();
+    return w.result == status::acquired;
+}
+} // namespace
+} // namespace beman::timed_lock_alg::detail
+
+namespace beman::timed_lock_alg {
+void async_timed_mutex::lock() {
+    if (try_lock()) {
+        return;
+    }
+    detail::blocking_waiter waiter;
+    detail::async_waiter    w;
+    w.owner    = this;
+    w.context  = &waiter;
+    w.complete = &detail::blocking_waiter::complete;
+    if (enqueue(w)) {
+        waiter.wait();
+    }
+}
+
+bool async_timed_mutex::try_lock_until_steady(std::chrono::steady_clock::time_point tp) {
+    if (std::chrono::steady_clock::now() >= tp) {
+        return try_lock();
+    }
+    // the waiting thread times out by itself, so w has no deadline for the timer thread
+    detail::blocking_waiter waiter;
+    detail::async_waiter    w;
+    w.owner    = this;
+    w.context  = &waiter;
+    w.complete = &detail::blocking_waiter::complete;
+    if (not enqueue(w)) {
+        return w.result == detail::async_waiter::status::acquired;
+    }
+    if (waiter.wait_until(tp)) {
+        return true;
+    }
+    return detail::give_up(*this, w, waiter);
+}
+
+#if defined(__cpp_lib_jthread)
+bool async_timed_mutex::try_lock_until_steady(std::chrono::steady_clock::time_point tp, const std::stop_token& st) {
+    if (std::chrono::steady_clock::now() >= tp) {
+        return try_lock();
+    }
+    detail::blocking_waiter waiter;
+    detail::async_waiter    w;
+    w.owner    = this;
+    w.context  = &waiter;
+    w.complete = &detail::blocking_waiter::complete;
+    if (not enqueue(w)) {
+        return w.result == detail::async_waiter::status::acquired;
+    }
+    // A stop takes w off the list and completes it as timed out, waking the waiting thread without polling. cancel is
+    // declared after w and waiter since its destructor waits for a callback running on another thread.
+    std::stop_callback cancel(st, [this, &w] {
+        {
+            std::lock_guard lock(m_mtx);
+            if (w.result != detail::async_waiter::status::waiting) {
+                return;
+            }
+            remove(w);
+            w.result = detail::async_waiter::status::timed_out;
+        }
+        detail::complete(w);
+    });
+    if (waiter.wait_until(tp)) {
+        return w.result == detail::async_waiter::status::acquired;
+    }
+    return detail::give_up(*this, w, waiter);
+}
+#endif
+
+void async_timed_mutex::unlock_slow() {
+    detail::async_waiter* w = nullptr;
+    bool                  complete_here;
+    {
+        std::lock_guard lock(m_mtx);
+        if (m_head == nullptr) {
+            // the last waiter timed out after the fast path failed
+            m_state.store(unlocked, std::memory_order_release);
+            return;
+        }
+        // hand the mutex over to the first waiter, the state stays locked
+        w = m_head;
+        remove(*w);
+        w->result     = detail::async_waiter::status::acquired;
+        complete_here = w->deadline == std::chrono::steady_clock::time_point::max() ||
+                        detail::timer_service::instance().cancel(*w);
+    }
+    if (complete_here) {
+        detail::complete(*w);
+    }
+}
+
+bool async_timed_mutex::enqueue(detail::async_waiter& w) {
+    std::lock_guard lock(m_mtx);
+    auto            state = m_state.load(std::memory_order_relaxed);
+    while (true) {
+        if (state == unlocked) {
+            if (m_state.compare_exchange_weak(state, locked, std::memory_order_acquire, std::memory_order_relaxed)) {
+                w.result = detail::async_waiter::status::acquired;
+                return false;
+            }
+        } else if (state == locked) {
+            // make unlock take the slow path
+            if (m_state.compare_exchange_weak(state, waiters, std::memory_order_relaxed)) {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+    if (std::chrono::steady_clock::now() >= w.deadline) {
+        if (m_head == nullptr) {
+            m_state.store(locked, std::memory_order_relaxed);
+        }
+        w.result = detail::async_waiter::status::timed_out;
+        return false;
+    }
+
+    w.result = detail::async_waiter::status::waiting;
+    w.prev   = m_tail;
+    w.next   = nullptr;
+    (m_tail != nullptr ? m_tail->next : m_head) = &w;
+    m_tail                                      = &w;
+    if (w.deadline != std::chrono::steady_clock::time_point::max()) {
+        detail::timer_service::instance().add(w);
+    }
+    return true;
+}
+
+void async_timed_mutex::remove(detail::async_waiter& w) noexcept {
+    (w.prev != nullptr ? w.prev->next : m_head) = w.next;
+    (w.next != nullptr ? w.next->prev : m_tail) = w.prev;
+    w.prev = w.next = nullptr;
+    if (m_head == nullptr) {
+        m_state.store(locked, std::memory_order_relaxed);
+    }
+}
+} // namespace beman::timed_lock_alg
+#endif
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/condition_variable.hpp>
+
+#include <chrono>
+#include <mutex>
+
+namespace beman::timed_lock_alg {
+namespace detail {
+void cv_waiter_queue::push_back(cv_waiter& w) noexcept {
+    w.prev = m_tail;
+    w.next = nullptr;
+    (m_tail != nullptr ? m_tail->next : m_head) = &w;
+    m_tail                                      = &w;
+}
+
+cv_waiter& cv_waiter_queue::pop_front() noexcept {
+    cv_waiter& w = *m_head;
+    erase(w);
+    return w;
+}
+
+void cv_waiter_queue::erase(cv_waiter& w) noexcept {
+    (w.prev != nullptr ? w.prev->next : m_head) = w.next;
+    (w.next != nullptr ? w.next->prev : m_tail) = w.prev;
+    w.prev = w.next = nullptr;
+}
+} // namespace detail
+
+using status = detail::cv_waiter::status;
+
+void multi_lock_condition_variable::notify_one() noexcept {
+    std::lock_guard internal(m_mutex);
+    if (not m_waiting.empty()) {
+        auto& w = m_waiting.pop_front();
+        w.state = status::notified;
+        m_notified.push_back(w);
+        dispatch();
+    }
+}
+
+void multi_lock_condition_variable::notify_all() noexcept {
+    std::lock_guard internal(m_mutex);
+    while (not m_waiting.empty()) {
+        auto& w = m_waiting.pop_front();
+        w.state = status::notified;
+        m_notified.push_back(w);
+    }
+    dispatch();
+}
+
+void multi_lock_condition_variable::block(std::unique_lock<std::mutex>&                internal,
+                                          detail::cv_waiter&                           w,
+                                          const std::chrono::steady_clock::time_point* tp) {
+    const auto woken = [&w] { return w.state == status::woken; };
+    if (tp == nullptr) {
+        w.cv.wait(internal, woken);
+    } else if (not w.cv.wait_until(internal, *tp, woken)) {
+        // a waiter notified but not woken yet counts as notified, it just doesn't hold up the next batch
+        (w.state == status::waiting ? m_waiting : m_notified).erase(w);
+    }
+}
+
+void multi_lock_condition_variable::reacquired(detail::cv_waiter& w) noexcept {
+    if (w.state == status::woken) {
+        std::lock_guard internal(m_mutex);
+        --m_reacquiring;
+        dispatch();
+    }
+}
+
+void multi_lock_condition_variable::dispatch() noexcept {
+    while (m_reacquiring < m_batch_size && not m_notified.empty()) {
+        auto& w = m_notified.pop_front();
+        w.state = status::woken;
+        ++m_reacquiring;
+        // notify while holding m_mutex since w is destroyed as soon as its thread sees it woken
+        w.cv.notify_one();
+    }
+}
+} // namespace beman::timed_lock_alg
@@ -0,0 +1,307 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/hold_time.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace beman::timed_lock_alg {
+namespace {
+std::uint64_t to_ns(std::chrono::nanoseconds dur) noexcept {
+    return static_cast<std::uint64_t>(std::max(dur.count(), std::chrono::nanoseconds::rep{}));
+}
+} // namespace
+
+void hold_time_histogram::record(std::chrono::nanoseconds dur) noexcept {
+    const auto ns = to_ns(dur);
+    ++m_buckets[bucket_of(dur)];
+    ++m_count;
+    m_total += ns;
+    m_max = std::max(m_max, ns);
+}
+
+void hold_time_histogram::merge(const hold_time_histogram& other) noexcept {
+    for (std::size_t i = 0; i != bucket_count; ++i) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_total += other.m_total;
+    m_max = std::max(m_max, other.m_max);
+}
+
+std::chrono::nanoseconds hold_time_histogram::mean() const noexcept {
+    return std::chrono::nanoseconds(m_count == 0 ? 0 : static_cast<std::chrono::nanoseconds::rep>(m_total / m_count));
+}
+
+std::chrono::nanoseconds hold_time_histogram::percentile(double p) const noexcept {
+    if (m_count == 0) {
+        return {};
+    }
+    const auto rank =
+        std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(p / 100 * static_cast<double>(m_count))));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i != bucket_count; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            return std::min(bucket_upper_bound(i), max());
+        }
+    }
+    return max();
+}
+
+std::chrono::nanoseconds hold_time_histogram::bucket_upper_bound(std::size_t idx) noexcept {
+    const auto bound = idx == 0 ? 0 : (std::uint64_t{1} << (idx - 1)) * 2 - 1;
+    return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(bound));
+}
+
+std::size_t hold_time_histogram::bucket_of(std::chrono::nanoseconds dur) noexcept {
+    return std::min(static_cast<std::size_t>(std::bit_width(to_ns(dur))), bucket_count - 1);
+}
+
+namespace detail {
+// A histogram written by one thread and read by collect_hold_times. The owner updates it with plain loads and stores
+// since it is the only writer, also of the reset.
+struct hold_time_access {
+    struct shared_histogram {
+        std::array<std::atomic<std::uint64_t>, hold_time_histogram::bucket_count> buckets{};
+        std::atomic<std::uint64_t>                                                count{0};
+        std::atomic<std::uint64_t>                                                total{0};
+        std::atomic<std::uint64_t>                                                max{0};
+
+        static void add(std::atomic<std::uint64_t>& a, std::uint64_t v) noexcept {
+            a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        }
+
+        void record(std::chrono::nanoseconds dur) noexcept {
+            const auto ns = to_ns(dur);
+            add(buckets[hold_time_histogram::bucket_of(dur)], 1);
+            add(count, 1);
+            add(total, ns);
+            if (ns > max.load(std::memory_order_relaxed)) {
+                max.store(ns, std::memory_order_relaxed);
+            }
+        }
+
+        hold_time_histogram snapshot() const noexcept {
+            hold_time_histogram h;
+            for (std::size_t i = 0; i != buckets.size(); ++i) {
+                h.m_buckets[i] = buckets[i].load(std::memory_order_relaxed);
+            }
+            h.m_count = count.load(std::memory_order_relaxed);
+            h.m_total = total.load(std::memory_order_relaxed);
+            h.m_max   = max.load(std::memory_order_relaxed);
+            return h;
+        }
+
+        void reset() noexcept {
+            for (auto& b : buckets) {
+                b.store(0, std::memory_order_relaxed);
+            }
+            count.store(0, std::memory_order_relaxed);
+            total.store(0, std::memory_order_relaxed);
+            max.store(0, std::memory_order_relaxed);
+        }
+    };
+};
+} // namespace detail
+
+namespace {
+using shared_histogram = detail::hold_time_access::shared_histogram;
+
+// Bumped by reset_hold_times. The tables of the threads hold the counts of one epoch and are only reported while it is
+// the current one. Each thread clears its own table when it sees a new epoch, so that a reset never races with the
+// updates of the owner.
+std::atomic<std::uint64_t> hold_time_epoch{0};
+
+struct site_slot {
+    std::atomic<bool> used{false};
+    lock_order_site   site{}; // written by the owner before used is set
+    shared_histogram  histogram;
+};
+
+// The names of a site may be stored more than once, such as in each translation unit an inline function is used in,
+// so they are compared by value. Lines and columns rule most sites out first.
+bool same_site(const lock_order_site& a, const lock_order_site& b) noexcept {
+    return a.line() == b.line() && a.column() == b.column() &&
+           std::string_view(a.file_name()) == std::string_view(b.file_name()) &&
+           std::string_view(a.function_name()) == std::string_view(b.function_name());
+}
+
+// The sites a thread recorded hold times for. Once all slots are taken, other sites are counted in overflow.
+struct thread_table {
+    static constexpr std::size_t capacity = 32;
+
+    std::array<site_slot, capacity> slots;
+    site_slot                       overflow;
+    // the epoch the counts belong to, written by the owner after clearing them
+    std::atomic<std::uint64_t> epoch{hold_time_epoch.load(std::memory_order_relaxed)};
+
+    // clears the counts of an earlier epoch; only called by the owner
+    void enter_epoch() noexcept {
+        const auto current = hold_time_epoch.load(std::memory_order_relaxed);
+        if (epoch.load(std::memory_order_relaxed) != current) {
+            for (auto& slot : slots) {
+                slot.histogram.reset();
+            }
+            overflow.histogram.reset();
+            epoch.store(current, std::memory_order_release);
+        }
+    }
+
+    site_slot& find(const lock_order_site& site) noexcept {
+        const std::size_t hash = (site.line() * 0x9e3779b9u) ^ site.column();
+        for (std::size_t i = 0; i != capacity; ++i) {
+            auto& slot = slots[(hash + i) % capacity];
+            if (not slot.used.load(std::memory_order_relaxed)) {
+                slot.site = site;
+                slot.used.store(true, std::memory_order_release);
+                return slot;
+            }
+            if (same_site(slot.site, site)) {
+                return slot;
+            }
+        }
+        return overflow;
+    }
+};
+
+// The tables of the running threads and the merged histograms of the threads that exited.
+class registry {
+  public:
+    // never destroyed so that threads exiting after main can still retire their tables
+    static registry& instance() {
+        static registry* r = new registry;
+        return *r;
+    }
+
+    void add(thread_table& t) {
+        std::lock_guard lock(m_mtx);
+        m_live.push_back(&t);
+    }
+
+    void retire(thread_table& t) {
+        std::lock_guard lock(m_mtx);
+        merge_table(t, m_retired);
+        std::erase(m_live, &t);
+    }
+
+    std::vector<hold_time_site> collect() {
+        std::map<key_type, hold_time_histogram> merged;
+        {
+            std::lock_guard lock(m_mtx);
+            merged = m_retired;
+            for (thread_table* t : m_live) {
+                merge_table(*t, merged);
+            }
+        }
+        std::vector<hold_time_site> sites;
+        for (auto& [key, histogram] : merged) {
+            sites.push_back({std::get<0>(key), std::get<2>(key), std::get<1>(key), histogram});
+        }
+        std::ranges::stable_sort(sites, std::ranges::greater{}, [](const auto& s) { return s.histogram.total(); });
+        return sites;
+    }
+
+    // the live tables are cleared by their threads the next time they record
+    void reset() {
+        std::lock_guard lock(m_mtx);
+        m_retired.clear();
+        hold_time_epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+
+  private:
+    // file, line, function
+    using key_type = std::tuple<std::string, std::uint_least32_t, std::string>;
+
+    static void merge_table(const thread_table& t, std::map<key_type, hold_time_histogram>& into) {
+        if (t.epoch.load(std::memory_order_acquire) != hold_time_epoch.load(std::memory_order_relaxed)) {
+            return;
+        }
+        for (const auto& slot : t.slots) {
+            // a slot stays taken after a reset, but its site is only reported once it recorded again
+            if (slot.used.load(std::memory_order_acquire)) {
+                const auto histogram = slot.histogram.snapshot();
+                if (histogram.count() != 0) {
+                    const key_type key{slot.site.file_name(), slot.site.line(), slot.site.function_name()};
+                    into[key].merge(histogram);
+                }
+            }
+        }
+        const auto overflow = t.overflow.histogram.snapshot();
+        if (overflow.count() != 0) {
+            into[key_type{"", 0, "(other sites)"}].merge(overflow);
+        }
+    }
+
+    std::mutex                              m_mtx;
+    std::vector<thread_table*>              m_live;
+    std::map<key_type, hold_time_histogram> m_retired;
+};
+
+// registers the table of the thread on first use and retires it when the thread exits
+class thread_table_owner {
+  public:
+    ~thread_table_owner() {
+        if (m_table) {
+            registry::instance().retire(*m_table);
+        }
+    }
+
+    thread_table& get() {
+        if (not m_table) {
+            m_table = std::make_unique<thread_table>();
+            registry::instance().add(*m_table);
+        }
+        return *m_table;
+    }
+
+  private:
+    std::unique_ptr<thread_table> m_table;
+};
+
+thread_local thread_table_owner local_table;
+} // namespace
+
+std::vector<hold_time_site> collect_hold_times() { return registry::instance().collect(); }
+
+void dump_hold_times(std::ostream& os) {
+    for (const auto& site : collect_hold_times()) {
+        const auto& h = site.histogram;
+        os << site.file << ':' << site.line << ' ' << site.function << ": count=" << h.count()
+           << " mean=" << h.mean().count() << "ns p50=" << h.percentile(50).count()
+           << "ns p99=" << h.percentile(99).count() << "ns max=" << h.max().count() << "ns\n";
+    }
+}
+
+void reset_hold_times() { registry::instance().reset(); }
+
+void record_hold_time(const lock_order_site& site, std::chrono::nanoseconds dur) noexcept {
+#if defined(__cpp_exceptions)
+    try {
+#endif
+        auto& table = local_table.get();
+        table.enter_epoch();
+        table.find(site).histogram.record(dur);
+#if defined(__cpp_exceptions)
+    } catch (...) {
+        // dropped if the table of the thread can't be allocated
+    }
+#endif
+}
+} // namespace beman::timed_lock_alg
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/lock_order.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace beman::timed_lock_alg {
+namespace {
+struct held_lockable {
+    const void*     lockable;
+    lock_order_site site;
+};
+
+// the lockables the thread holds, in acquisition order
+thread_local std::vector<held_lockable> held;
+thread_local std::uint32_t              sample_count = 0;
+
+std::atomic<std::uint32_t> sampling{1};
+
+void print_cycle(const lock_order_cycle& cycle) {
+    std::cerr << "beman.timed_lock_alg: lock order cycle, potential deadlock:\n";
+    for (const auto& edge : cycle.edges) {
+        std::cerr << "  thread " << edge.thread << " acquired " << edge.acquired << " at "
+                  << edge.acquired_at.file_name() << ':' << edge.acquired_at.line() << " ("
+                  << edge.acquired_at.function_name() << ")\n"
+                  << "    while holding " << edge.held << " acquired at " << edge.held_at.file_name() << ':'
+                  << edge.held_at.line() << " (" << edge.held_at.function_name() << ")\n";
+    }
+}
+
+// The acquisition order graph. An edge a -> b means that b was acquired while holding a.
+class lock_order_graph {
+  public:
+    static lock_order_graph& instance() {
+        static lock_order_graph graph;
+        return graph;
+    }
+
+    // Adds the edges from all held lockables to the acquired ones and returns the cycles closed by new edges.
+    std::vector<lock_order_cycle>
+    add(std::span<const held_lockable> holding, std::span<const void* const> acquired, const lock_order_site& site) {
+        std::vector<lock_order_cycle> cycles;
+        std::lock_guard               lock(m_mtx);
+        for (const auto& h : holding) {
+            for (const void* a : acquired) {
+                if (h.lockable == a || m_edges[h.lockable].contains(a)) {
+                    continue;
+                }
+                lock_order_edge edge{h.lockable, a, h.site, site, std::this_thread::get_id()};
+                if (auto cycle = path(a, h.lockable)) {
+                    cycle->edges.push_back(edge);
+                    cycles.push_back(std::move(*cycle));
+                }
+                m_edges[h.lockable].emplace(a, edge);
+            }
+        }
+        return cycles;
+    }
+
+    void reset() {
+        std::lock_guard lock(m_mtx);
+        m_edges.clear();
+    }
+
+    void set_handler(lock_order_handler handler) {
+        std::lock_guard lock(m_mtx);
+        m_handler = std::move(handler);
+    }
+
+    lock_order_handler handler() {
+        std::lock_guard lock(m_mtx);
+        return m_handler;
+    }
+
+  private:
+    // the edges of a shortest path from -> to, if any
+    std::optional<lock_order_cycle> path(const void* from, const void* to) const {
+        std::unordered_map<const void*, const lock_order_edge*> reached_by{{from, nullptr}};
+        std::queue<const void*>                                  next;
+        next.push(from);
+        while (not next.empty()) {
+            const void* node = next.front();
+            next.pop();
+            const auto out = m_edges.find(node);
+            if (out == m_edges.end()) {
+                continue;
+            }
+            for (const auto& [target, edge] : out->second) {
+                if (not reached_by.emplace(target, &edge).second) {
+                    continue;
+                }
+                if (target == to) {
+                    lock_order_cycle cycle;
+                    for (const lock_order_edge* e = &edge; e != nullptr; e = reached_by.at(e->held)) {
+                        cycle.edges.push_back(*e);
+                    }
+                    std::ranges::reverse(cycle.edges);
+                    return cycle;
+                }
+                next.push(target);
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::mutex                                                                         m_mtx;
+    std::unordered_map<const void*, std::unordered_map<const void*, lock_order_edge>> m_edges;
+    lock_order_handler                                                                 m_handler = print_cycle;
+};
+
+// whether the acquisition starting now adds edges to the graph
+bool sampled() noexcept {
+    const auto one_in = sampling.load(std::memory_order_relaxed);
+    return not held.empty() && one_in != 0 && sample_count++ % one_in == 0;
+}
+
+void report(const std::vector<lock_order_cycle>& cycles) {
+    if (not cycles.empty()) {
+        const auto handler = lock_order_graph::instance().handler();
+        for (const auto& cycle : cycles) {
+            handler(cycle);
+        }
+    }
+}
+
+// Adds the edges of an acquisition and reports the cycles closed. The lockables are locked by then, so neither running
+// out of memory nor a throwing handler may keep the caller from owning them.
+void add_edges(std::span<const held_lockable> holding,
+               std::span<const void* const>   acquired,
+               const lock_order_site&         site) noexcept {
+#if defined(__cpp_exceptions)
+    try {
+#endif
+        report(lock_order_graph::instance().add(holding, acquired, site));
+#if defined(__cpp_exceptions)
+    } catch (...) {
+        // the edges not added yet and the cycles not reported yet are dropped
+    }
+#endif
+}
+
+void hold(const void* lockable, const lock_order_site& site) noexcept {
+#if defined(__cpp_exceptions)
+    try {
+#endif
+        held.push_back({lockable, site});
+#if defined(__cpp_exceptions)
+    } catch (...) {
+        // later acquisitions of the thread then miss the edges from lockable
+    }
+#endif
+}
+} // namespace
+
+void set_lock_order_handler(lock_order_handler handler) {
+    lock_order_graph::instance().set_handler(handler ? std::move(handler) : lock_order_handler(print_cycle));
+}
+
+void set_lock_order_sampling(std::uint32_t one_in) noexcept { sampling.store(one_in, std::memory_order_relaxed); }
+
+void reset_lock_order_graph() { lock_order_graph::instance().reset(); }
+
+void lock_order_acquired(std::span<const void* const> lockables, lock_order_site site) noexcept {
+    if (sampled()) {
+        add_edges(held, lockables, site);
+    }
+    for (const void* l : lockables) {
+        hold(l, site);
+    }
+}
+
+namespace detail {
+std::size_t lock_order_holding() noexcept { return sampled() ? held.size() : 0; }
+
+void lock_order_acquired_one(const void* lockable, std::size_t holding, const lock_order_site& site) noexcept {
+    if (holding != 0) {
+        add_edges(std::span<const held_lockable>(held.data(), holding), std::span(&lockable, 1), site);
+    }
+    hold(lockable, site);
+}
+} // namespace detail
+
+void lock_order_released(std::span<const void* const> lockables) noexcept {
+    for (const void* l : lockables) {
+        const auto it = std::find_if(held.rbegin(), held.rend(), [l](const auto& h) { return h.lockable == l; });
+        if (it != held.rend()) {
+            held.erase(std::next(it).base());
+        }
+    }
+}
+} // namespace beman::timed_lock_alg
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/lock_set_executor.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace beman::timed_lock_alg {
+lock_set_executor::lock_set_executor(std::size_t threads) {
+    threads = std::max<std::size_t>(threads, 1);
+    m_threads.reserve(threads);
+    for (std::size_t i = 0; i != threads; ++i) {
+        m_threads.emplace_back([this] { work(); });
+    }
+}
+
+lock_set_executor::~lock_set_executor() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_ready.notify_all();
+    for (auto& th : m_threads) {
+        th.join();
+    }
+}
+
+void lock_set_executor::wait_idle() {
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending == 0; });
+}
+
+void lock_set_executor::push(std::unique_ptr<detail::lock_set_task> task) {
+    {
+        std::lock_guard              lock(m_mutex);
+        [[maybe_unused]] std::size_t queued = 0; // only read when rolling back
+#if defined(__cpp_exceptions)
+        try {
+#endif
+            for (const void* key : task->keys) {
+                auto& waiters = m_waiters[key];
+                if (not waiters.empty()) {
+                    ++task->blockers;
+                }
+                waiters.push_back(task.get());
+                ++queued;
+            }
+            if (task->blockers == 0) {
+                // leaves task alone if it throws
+                m_runnable.push_back(std::move(task));
+            }
+#if defined(__cpp_exceptions)
+        } catch (...) {
+            // the task is destroyed, take it off the keys it's queued for, where it's the last one, and drop the
+            // queue it failed to join if it was created for it
+            for (std::size_t i = 0; i != task->keys.size() && i <= queued; ++i) {
+                const auto it = m_waiters.find(task->keys[i]);
+                if (it == m_waiters.end()) {
+                    break;
+                }
+                if (i != queued) {
+                    it->second.pop_back();
+                }
+                if (it->second.empty()) {
+                    m_waiters.erase(it);
+                }
+            }
+            throw;
+        }
+#endif
+        ++m_pending;
+        if (task) {
+            // owned by m_waiters until it becomes runnable
+            static_cast<void>(task.release());
+            return;
+        }
+    }
+    m_ready.notify_one();
+}
+
+void lock_set_executor::work() {
+    std::unique_lock lock(m_mutex);
+    for (;;) {
+        m_ready.wait(lock, [this] { return not m_runnable.empty() || (m_stopping && m_pending == 0); });
+        if (m_runnable.empty()) {
+            return;
+        }
+        auto task = std::move(m_runnable.front());
+        m_runnable.pop_front();
+        lock.unlock();
+
+        task->run();
+        // destroy the closure before locking since its destructor may submit tasks
+        const auto keys = std::move(task->keys);
+        task.reset();
+
+        lock.lock();
+        for (const void* key : keys) {
+            const auto it = m_waiters.find(key);
+            it->second.pop_front();
+            if (it->second.empty()) {
+                m_waiters.erase(it);
+            } else if (auto* next = it->second.front(); --next->blockers == 0) {
+                m_runnable.emplace_back(next);
+                m_ready.notify_one();
+            }
+        }
+        if (--m_pending == 0) {
+            m_idle.notify_all();
+            if (m_stopping) {
+                m_ready.notify_all();
+            }
+        }
+    }
+}
+} // namespace beman::timed_lock_alg
@@ -1,3 +1,421 @@
 // SPDX-License-Identifier: MIT
 
 #include <beman/timed_lock_alg/mutex.hpp>
+
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_FUTEX_TIMED_MUTEX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <memory>
+#include <span>
+
+namespace beman::timed_lock_alg::detail {
+struct futex_access {
+    static constexpr std::uint32_t unlocked  = futex_timed_mutex::unlocked;
+    static constexpr std::uint32_t locked    = futex_timed_mutex::locked;
+    static constexpr std::uint32_t contended = futex_timed_mutex::contended;
+
+    static std::atomic<std::uint32_t>& state(futex_timed_mutex& m) noexcept { return m.m_state; }
+};
+
+namespace {
+using state_type = std::atomic<std::uint32_t>;
+
+timespec to_timespec(std::chrono::steady_clock::time_point tp) noexcept {
+    const auto since_epoch = std::max(std::chrono::nanoseconds(tp.time_since_epoch()), std::chrono::nanoseconds{});
+    const auto secs        = std::chrono::floor<std::chrono::seconds>(since_epoch);
+    return {static_cast<std::time_t>(secs.count()), static_cast<long>((since_epoch - secs).count())};
+}
+
+std::uint32_t* futex_word(state_type& state) noexcept { return reinterpret_cast<std::uint32_t*>(&state); }
+
+// Waits while the futex word is equal to expected. abs is an absolute CLOCK_MONOTONIC time or nullptr to wait
+// without timeout. Returns false on timeout.
+bool futex_wait(state_type& state, std::uint32_t expected, const timespec* abs) noexcept {
+    const long rv = syscall(SYS_futex,
+                            futex_word(state),
+                            FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+                            expected,
+                            abs,
+                            nullptr,
+                            FUTEX_BITSET_MATCH_ANY);
+    return rv == 0 || errno != ETIMEDOUT;
+}
+
+void futex_wake(state_type& state, int count) noexcept {
+    syscall(SYS_futex, futex_word(state), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, nullptr, nullptr, 0);
+}
+
+// same layout as struct futex_waitv in <linux/futex.h> which isn't available in older kernel headers
+struct waitv_entry {
+    std::uint64_t val;
+    std::uint64_t uaddr;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+
+constexpr std::uint32_t waitv_flags = 0x02 /* FUTEX2_SIZE_U32 */ | FUTEX_PRIVATE_FLAG;
+constexpr std::size_t   waitv_max   = 128; // FUTEX_WAITV_MAX
+
+// cleared the first time futex_waitv turns out to be unsupported by the running kernel
+std::atomic<bool> waitv_supported{true};
+
+// Returns the index of the entry that was woken or -1 with errno set.
+long futex_waitv(std::span<waitv_entry> entries, const timespec* abs) noexcept {
+#if defined(SYS_futex_waitv)
+    return syscall(SYS_futex_waitv, entries.data(), static_cast<unsigned>(entries.size()), 0u, abs, CLOCK_MONOTONIC);
+#else
+    static_cast<void>(entries);
+    static_cast<void>(abs);
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+#if defined(__cpp_lib_jthread)
+// Waits while the futex word is equal to expected like futex_wait, but also wakes up when stopped becomes non-zero.
+// Returns false on timeout. Without futex_waitv, a stop racing with going to sleep is only seen after
+// stop_poll_interval.
+bool futex_wait_stoppable(state_type&                           state,
+                          std::uint32_t                         expected,
+                          std::chrono::steady_clock::time_point tp,
+                          state_type&                           stopped) noexcept {
+    if (waitv_supported.load(std::memory_order_relaxed)) {
+        std::array<waitv_entry, 2> entries{{
+            {expected, reinterpret_cast<std::uintptr_t>(futex_word(state)), waitv_flags, 0},
+            {0, reinterpret_cast<std::uintptr_t>(futex_word(stopped)), waitv_flags, 0},
+        }};
+        const timespec abs = to_timespec(tp);
+        if (futex_waitv(entries, &abs) >= 0) {
+            return true;
+        }
+        if (errno != ENOSYS) {
+            return errno != ETIMEDOUT;
+        }
+        waitv_supported.store(false, std::memory_order_relaxed);
+    }
+    const auto     slice = std::min(tp, std::chrono::steady_clock::now() + stop_poll_interval);
+    const timespec abs   = to_timespec(slice);
+    return futex_wait(state, expected, &abs) || slice != tp;
+}
+
+// Locks the futex word like futex_timed_mutex::try_lock_until_steady until tp unless a stop is requested on st
+// first. The stop callback wakes the waiter through the stop word.
+bool stoppable_futex_lock_until(state_type&                           state,
+                                std::chrono::steady_clock::time_point tp,
+                                const std::stop_token&                st) {
+    constexpr std::uint32_t unlocked  = futex_access::unlocked;
+    constexpr std::uint32_t contended = futex_access::contended;
+
+    state_type         stopped{0};
+    std::stop_callback wake(st, [&] {
+        stopped.store(1, std::memory_order_relaxed);
+        futex_wake(stopped, 1);
+        if (not waitv_supported.load(std::memory_order_relaxed)) {
+            futex_wake(state, std::numeric_limits<int>::max());
+        }
+    });
+    while (state.exchange(contended, std::memory_order_acquire) != unlocked) {
+        if (stopped.load(std::memory_order_relaxed) != 0) {
+            return false;
+        }
+        if (not futex_wait_stoppable(state, contended, tp, stopped)) {
+            return state.exchange(contended, std::memory_order_acquire) == unlocked;
+        }
+    }
+    return true;
+}
+#endif
+
+using waitv_entries = std::array<waitv_entry, waitv_max>;
+using waitv_indices = std::array<std::size_t, waitv_max>;
+
+// Marks all mutexes that are still locked as contended so that their owners wake us when unlocking them and fills in
+// the entries to wait for, starting with the mutex at index first. Returns the number of entries.
+template <class At>
+std::size_t prepare_waitv(std::size_t n, At at, std::size_t first, waitv_entries& entries, waitv_indices& entry_idx) {
+    std::size_t waiters = 0;
+    for (std::size_t i = 0; i != n && waiters != waitv_max; ++i) {
+        const auto idx   = (first + i) % n;
+        auto&      state = futex_access::state(at(idx));
+        auto       value = state.load(std::memory_order_relaxed);
+        if (value == futex_access::locked) {
+            state.compare_exchange_strong(value, futex_access::contended, std::memory_order_relaxed);
+            value = state.load(std::memory_order_relaxed);
+        }
+        if (value == futex_access::contended) {
+            entries[waiters]   = {futex_access::contended, reinterpret_cast<std::uintptr_t>(futex_word(state)),
+                                  waitv_flags, 0};
+            entry_idx[waiters] = idx;
+            ++waiters;
+        }
+    }
+    return waiters;
+}
+
+template <class At>
+int futex_try_lock_until_impl(std::chrono::steady_clock::time_point tp, std::size_t n, At at) {
+    const timespec abs = to_timespec(tp);
+
+    waitv_entries entries;
+    waitv_indices entry_idx;
+
+    const void* set   = std::addressof(at(0));
+    std::size_t start = 0;
+    std::size_t woken = n; // the mutex we were woken up from, if any
+    for (std::size_t rounds = 1;; ++rounds) {
+        // Try to lock all mutexes in rotation order, starting with the one most likely to be free. The one we were
+        // woken up from is locked as contended since there may be more waiters that we are now responsible for.
+        trace_round_start(set, start, rounds);
+        std::size_t count = 0;
+        std::size_t fail  = n;
+        for (; count != n; ++count) {
+            const auto idx   = (start + count) % n;
+            auto&      state = futex_access::state(at(idx));
+            const bool ok =
+                idx == woken
+                    ? state.exchange(futex_access::contended, std::memory_order_acquire) == futex_access::unlocked
+                    : at(idx).try_lock();
+            if (not ok) {
+                fail = idx;
+                break;
+            }
+        }
+        if (count == n) {
+            trace_finished(set, -1, rounds);
+            return -1; // success
+        }
+        for (std::size_t i = 0; i != count; ++i) {
+            at((start + i) % n).unlock();
+        }
+        if (std::chrono::steady_clock::now() >= tp) {
+            trace_finished(set, static_cast<int>(fail), rounds);
+            return static_cast<int>(fail); // timeout
+        }
+        trace_failed(set, fail);
+        start = fail;
+        woken = n;
+
+        // the wait starts with the one that failed
+        trace_block(set, fail);
+        if (not waitv_supported.load(std::memory_order_relaxed)) {
+            // wait for the one that failed like the generic algorithm does
+            auto& state = futex_access::state(at(fail));
+            if (state.exchange(futex_access::contended, std::memory_order_acquire) == futex_access::unlocked) {
+                at(fail).unlock();
+            } else {
+                futex_wait(state, futex_access::contended, &abs);
+            }
+            woken = fail;
+            continue;
+        }
+
+        // Sleep until one of the locked mutexes is unlocked, starting with the one that failed.
+        const std::size_t waiters = prepare_waitv(n, at, fail, entries, entry_idx);
+        if (waiters == 0) {
+            continue; // all were unlocked while preparing to wait
+        }
+
+        const long rv = futex_waitv(std::span(entries.data(), waiters), &abs);
+        if (rv >= 0) {
+            woken = start = entry_idx[static_cast<std::size_t>(rv)];
+        } else if (errno == ENOSYS) {
+            waitv_supported.store(false, std::memory_order_relaxed);
+        }
+        // on EAGAIN (a futex word changed), EINTR or ETIMEDOUT, just try again
+    }
+}
+// Locks out.size() of the n mutexes. Unlike futex_try_lock_until_impl, it sleeps until any one of the mutexes it
+// could not lock is unlocked and then tries that one first.
+template <class At>
+bool futex_try_lock_k_until_impl(std::chrono::steady_clock::time_point tp,
+                                 std::size_t                           n,
+                                 At                                    at,
+                                 std::span<std::size_t>                out) {
+    const timespec abs = to_timespec(tp);
+    const auto     k   = out.size();
+
+    waitv_entries entries;
+    waitv_indices entry_idx;
+
+    std::size_t start = pool_start_hint() % n;
+    std::size_t woken = n; // the mutex we were woken up from, if any
+    while (true) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i != n && count != k; ++i) {
+            const auto idx   = (start + i) % n;
+            auto&      state = futex_access::state(at(idx));
+            const bool ok =
+                idx == woken
+                    ? state.exchange(futex_access::contended, std::memory_order_acquire) == futex_access::unlocked
+                    : at(idx).try_lock();
+            if (ok) {
+                out[count++] = idx;
+            }
+        }
+        if (count == k) {
+            return true;
+        }
+        // don't hold on to any while sleeping
+        for (std::size_t i = 0; i != count; ++i) {
+            at(out[i]).unlock();
+        }
+        if (std::chrono::steady_clock::now() >= tp) {
+            return false;
+        }
+        start = start + 1 == n ? 0 : start + 1;
+        woken = n;
+
+        if (not waitv_supported.load(std::memory_order_relaxed)) {
+            auto& state = futex_access::state(at(start));
+            if (state.exchange(futex_access::contended, std::memory_order_acquire) == futex_access::unlocked) {
+                at(start).unlock();
+            } else {
+                futex_wait(state, futex_access::contended, &abs);
+            }
+            woken = start;
+            continue;
+        }
+
+        const std::size_t waiters = prepare_waitv(n, at, start, entries, entry_idx);
+        if (waiters == 0) {
+            continue; // all were unlocked while preparing to wait
+        }
+
+        // If there are more mutexes than futex_waitv can wait for, the ones left out are only noticed by polling.
+        timespec wake_at = abs;
+        if (waiters == waitv_max && n > waitv_max) {
+            wake_at = to_timespec(std::min(tp, std::chrono::steady_clock::now() + std::chrono::milliseconds(1)));
+        }
+        const long rv = futex_waitv(std::span(entries.data(), waiters), &wake_at);
+        if (rv >= 0) {
+            woken = start = entry_idx[static_cast<std::size_t>(rv)];
+        } else if (errno == ENOSYS) {
+            waitv_supported.store(false, std::memory_order_relaxed);
+        }
+    }
+}
+} // namespace
+
+int futex_try_lock_until(std::chrono::steady_clock::time_point tp, std::span<futex_timed_mutex* const> ms) {
+    return futex_try_lock_until_impl(tp, ms.size(), [ms](std::size_t i) -> futex_timed_mutex& { return *ms[i]; });
+}
+
+int futex_try_lock_until(std::chrono::steady_clock::time_point tp, std::span<futex_timed_mutex> ms) {
+    return futex_try_lock_until_impl(tp, ms.size(), [ms](std::size_t i) -> futex_timed_mutex& { return ms[i]; });
+}
+
+bool futex_try_lock_k_until(std::chrono::steady_clock::time_point tp,
+                            std::span<futex_timed_mutex* const>   ms,
+                            std::span<std::size_t>                out) {
+    return futex_try_lock_k_until_impl(
+        tp, ms.size(), [ms](std::size_t i) -> futex_timed_mutex& { return *ms[i]; }, out);
+}
+
+bool futex_try_lock_k_until(std::chrono::steady_clock::time_point tp,
+                            std::span<futex_timed_mutex>          ms,
+                            std::span<std::size_t>                out) {
+    return futex_try_lock_k_until_impl(
+        tp, ms.size(), [ms](std::size_t i) -> futex_timed_mutex& { return ms[i]; }, out);
+}
+} // namespace beman::timed_lock_alg::detail
+
+namespace beman::timed_lock_alg {
+void futex_timed_mutex::lock() {
+    if (try_lock()) {
+        return;
+    }
+    while (m_state.exchange(contended, std::memory_order_acquire) != unlocked) {
+        detail::futex_wait(m_state, contended, nullptr);
+    }
+}
+
+bool futex_timed_mutex::try_lock_until_steady(std::chrono::steady_clock::time_point tp) {
+    const timespec abs = detail::to_timespec(tp);
+    while (m_state.exchange(contended, std::memory_order_acquire) != unlocked) {
+        if (not detail::futex_wait(m_state, contended, &abs)) {
+            return m_state.exchange(contended, std::memory_order_acquire) == unlocked;
+        }
+    }
+    return true;
+}
+
+#if defined(__cpp_lib_jthread)
+bool futex_timed_mutex::try_lock_until_steady(std::chrono::steady_clock::time_point tp, const std::stop_token& st) {
+    return detail::stoppable_futex_lock_until(m_state, tp, st);
+}
+#endif
+
+void futex_timed_mutex::wake_one() noexcept { detail::futex_wake(m_state, 1); }
+
+bool adaptive_timed_mutex::spin_until(std::chrono::steady_clock::time_point tp) noexcept {
+    const auto spin = spin_duration();
+    if (spin == spin.zero()) {
+        return false;
+    }
+    const auto end = std::min(std::chrono::steady_clock::now() + spin, tp);
+    do {
+        // read the clock only every few polls
+        for (int i = 0; i < 16; ++i) {
+            if (m_state.load(std::memory_order_relaxed) == unlocked && try_lock()) {
+                return true;
+            }
+            detail::cpu_relax();
+        }
+    } while (std::chrono::steady_clock::now() < end);
+    return false;
+}
+
+void adaptive_timed_mutex::lock_slow() {
+    if (spin_until(std::chrono::steady_clock::time_point::max())) {
+        return;
+    }
+    while (m_state.exchange(contended, std::memory_order_acquire) != unlocked) {
+        detail::futex_wait(m_state, contended, nullptr);
+    }
+    on_acquired();
+}
+
+bool adaptive_timed_mutex::try_lock_until_steady(std::chrono::steady_clock::time_point tp) {
+    if (spin_until(tp)) {
+        return true;
+    }
+    const timespec abs = detail::to_timespec(tp);
+    while (m_state.exchange(contended, std::memory_order_acquire) != unlocked) {
+        if (not detail::futex_wait(m_state, contended, &abs)) {
+            if (m_state.exchange(contended, std::memory_order_acquire) != unlocked) {
+                return false;
+            }
+            break;
+        }
+    }
+    on_acquired();
+    return true;
+}
+
+#if defined(__cpp_lib_jthread)
+bool adaptive_timed_mutex::try_lock_until_steady(std::chrono::steady_clock::time_point tp, const std::stop_token& st) {
+    if (spin_until(tp)) {
+        return true;
+    }
+    if (not detail::stoppable_futex_lock_until(m_state, tp, st)) {
+        return false;
+    }
+    on_acquired();
+    return true;
+}
+#endif
+
+void adaptive_timed_mutex::wake_one() noexcept { detail::futex_wake(m_state, 1); }
+} // namespace beman::timed_lock_alg
+#endif
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/sharded_shared_timed_mutex.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace beman::timed_lock_alg {
+namespace {
+constexpr std::size_t max_default_slots = 256;
+
+std::size_t default_slots() {
+    static const std::size_t slots =
+        std::min(std::bit_ceil(std::max<std::size_t>(std::thread::hardware_concurrency(), 1)), max_default_slots);
+    return slots;
+}
+
+// waits on cv until pred() holds, giving up at *tp unless tp is null
+template <class Pred>
+bool wait(std::condition_variable&                     cv,
+          std::unique_lock<std::mutex>&                gate,
+          const std::chrono::steady_clock::time_point* tp,
+          Pred                                         pred) {
+    if (tp == nullptr) {
+        cv.wait(gate, pred);
+        return true;
+    }
+    return cv.wait_until(gate, *tp, pred);
+}
+} // namespace
+
+sharded_shared_timed_mutex::sharded_shared_timed_mutex() : sharded_shared_timed_mutex(default_slots()) {}
+
+sharded_shared_timed_mutex::sharded_shared_timed_mutex(std::size_t slots)
+    : m_slots(new reader_slot[std::bit_ceil(std::max<std::size_t>(slots, 1))]),
+      m_mask(std::bit_ceil(std::max<std::size_t>(slots, 1)) - 1) {}
+
+bool sharded_shared_timed_mutex::try_lock() noexcept {
+    bool expected = false;
+    if (not m_writer.compare_exchange_strong(expected, true, std::memory_order_seq_cst)) {
+        return false;
+    }
+    if (readers_drained()) {
+        return true;
+    }
+    unlock();
+    return false;
+}
+
+bool sharded_shared_timed_mutex::lock_until_steady(const std::chrono::steady_clock::time_point* tp) {
+    bool expected = false;
+    if (not m_writer.compare_exchange_strong(expected, true, std::memory_order_seq_cst)) {
+        // wait for the writer owning the mutex, competing with the readers waiting for it
+        std::unique_lock gate(m_gate);
+        m_waiting.fetch_add(1, std::memory_order_seq_cst);
+        const bool claimed = wait(m_writer_gone, gate, tp, [this] {
+            bool unowned = false;
+            return m_writer.compare_exchange_strong(unowned, true, std::memory_order_seq_cst);
+        });
+        m_waiting.fetch_sub(1, std::memory_order_relaxed);
+        if (not claimed) {
+            return false;
+        }
+    }
+    if (readers_drained()) {
+        return true;
+    }
+    std::unique_lock gate(m_gate);
+    if (wait(m_drained, gate, tp, [this] { return readers_drained(); })) {
+        return true;
+    }
+    gate.unlock();
+    unlock();
+    return false;
+}
+
+bool sharded_shared_timed_mutex::lock_shared_until_steady(const std::chrono::steady_clock::time_point* tp) {
+    auto& count = slot();
+    for (;;) {
+        {
+            std::unique_lock gate(m_gate);
+            m_waiting.fetch_add(1, std::memory_order_seq_cst);
+            const bool unowned =
+                wait(m_writer_gone, gate, tp, [this] { return not m_writer.load(std::memory_order_seq_cst); });
+            m_waiting.fetch_sub(1, std::memory_order_relaxed);
+            if (not unowned) {
+                return false;
+            }
+        }
+        count.fetch_add(1, std::memory_order_seq_cst);
+        if (not m_writer.load(std::memory_order_seq_cst)) {
+            return true;
+        }
+        // another writer came first
+        back_off(count);
+    }
+}
+
+bool sharded_shared_timed_mutex::readers_drained() const noexcept {
+    for (std::size_t i = 0; i <= m_mask; ++i) {
+        if (m_slots[i].count.load(std::memory_order_seq_cst) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void sharded_shared_timed_mutex::wake_writer() noexcept {
+    // taking the gate makes sure the writer is either waiting or hasn't checked the slots yet
+    {
+        std::lock_guard gate(m_gate);
+    }
+    m_drained.notify_one();
+}
+
+void sharded_shared_timed_mutex::wake_waiters() noexcept {
+    {
+        std::lock_guard gate(m_gate);
+    }
+    m_writer_gone.notify_all();
+}
+} // namespace beman::timed_lock_alg
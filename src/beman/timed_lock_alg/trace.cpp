@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/trace.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace beman::timed_lock_alg {
+namespace detail {
+std::atomic<bool> lock_trace_active{false};
+} // namespace detail
+
+namespace {
+// A slot of the ring buffer guarded by a sequence lock: seq is 0 while the slot is written and the position of the
+// event plus one once it is complete.
+struct trace_slot {
+    std::atomic<std::uint64_t>       seq{0};
+    std::atomic<std::int64_t>        ns{0};
+    std::atomic<const void*>         set{nullptr};
+    std::atomic<std::uint64_t>       value{0};
+    std::atomic<std::uint32_t>       tid{0};
+    std::atomic<detail::trace_point> point{};
+};
+
+struct trace_event {
+    std::uint64_t       seq;
+    std::int64_t        ns;
+    const void*         set;
+    std::uint64_t       value;
+    std::uint32_t       tid;
+    detail::trace_point point;
+};
+
+struct trace_buffer {
+    std::array<trace_slot, lock_trace_capacity> slots;
+    std::atomic<std::uint64_t>                  head{0};
+    std::atomic<std::int64_t>                   start_ns{0};
+};
+
+std::int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// never destroyed so that threads exiting after main can still record
+trace_buffer& buffer() {
+    static trace_buffer* b = new trace_buffer;
+    return *b;
+}
+
+// the buffer once start_lock_trace() allocated it
+std::atomic<trace_buffer*> active_buffer{nullptr};
+
+// small thread ids numbered in order of first use, which the trace viewers show more readably than native ones
+std::uint32_t trace_tid() noexcept {
+    static std::atomic<std::uint32_t> next{1};
+    thread_local const std::uint32_t  tid = next.fetch_add(1, std::memory_order_relaxed);
+    return tid;
+}
+
+std::vector<trace_event> snapshot(const trace_buffer& b) {
+    std::vector<trace_event> events;
+    const std::uint64_t      head  = b.head.load(std::memory_order_acquire);
+    const std::uint64_t      first = head > lock_trace_capacity ? head - lock_trace_capacity : 0;
+    events.reserve(static_cast<std::size_t>(head - first));
+    for (std::uint64_t pos = first; pos != head; ++pos) {
+        const auto& slot = b.slots[pos % lock_trace_capacity];
+        const auto  seq  = slot.seq.load(std::memory_order_acquire);
+        trace_event ev{seq,
+                       slot.ns.load(std::memory_order_relaxed),
+                       slot.set.load(std::memory_order_relaxed),
+                       slot.value.load(std::memory_order_relaxed),
+                       slot.tid.load(std::memory_order_relaxed),
+                       slot.point.load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq == pos + 1 && slot.seq.load(std::memory_order_relaxed) == seq) {
+            events.push_back(ev);
+        }
+    }
+    return events;
+}
+
+void write_event(std::ostream& os, bool& first, const trace_event& ev, const char* name, char phase) {
+    os << (first ? "\n" : ",\n") << R"({"name":")" << name << R"(","cat":"lock","ph":")" << phase
+       << R"(","pid":1,"tid":)" << ev.tid << R"(,"ts":)" << ev.ns / 1000 << '.' << ev.ns / 100 % 10 << ev.ns / 10 % 10
+       << ev.ns % 10;
+    first = false;
+}
+
+void write_set(std::ostream& os, const void* set) { os << R"("set":")" << set << '"'; }
+} // namespace
+
+void start_lock_trace() {
+    auto& b = buffer();
+    detail::lock_trace_active.store(false, std::memory_order_relaxed);
+    for (auto& slot : b.slots) {
+        slot.seq.store(0, std::memory_order_relaxed);
+    }
+    b.head.store(0, std::memory_order_relaxed);
+    b.start_ns.store(now_ns(), std::memory_order_relaxed);
+    active_buffer.store(&b, std::memory_order_release);
+    detail::lock_trace_active.store(true, std::memory_order_release);
+}
+
+void stop_lock_trace() noexcept { detail::lock_trace_active.store(false, std::memory_order_release); }
+
+void write_chrome_trace(std::ostream& os) {
+    const trace_buffer*      b = active_buffer.load(std::memory_order_acquire);
+    std::vector<trace_event> events;
+    if (b != nullptr) {
+        events = snapshot(*b);
+    }
+    os << R"({"displayTimeUnit":"ns","traceEvents":[)";
+    bool first = true;
+    for (const auto& ev : events) {
+        switch (ev.point) {
+        case detail::trace_point::round_start:
+            if (ev.value == 1) {
+                write_event(os, first, ev, "lock wait", 'B');
+                os << R"(,"args":{)";
+                write_set(os, ev.set);
+                os << "}}";
+            }
+            write_event(os, first, ev, "round", 'i');
+            os << R"(,"s":"t","args":{"round":)" << ev.value << "}}";
+            break;
+        case detail::trace_point::block:
+            write_event(os, first, ev, "block", 'i');
+            os << R"(,"s":"t","args":{"index":)" << ev.value << "}}";
+            break;
+        case detail::trace_point::failed:
+            write_event(os, first, ev, "failed", 'i');
+            os << R"(,"s":"t","args":{"index":)" << ev.value << "}}";
+            break;
+        case detail::trace_point::acquired:
+            write_event(os, first, ev, "lock wait", 'E');
+            os << R"(,"args":{"rounds":)" << ev.value << "}}";
+            break;
+        case detail::trace_point::timeout:
+            write_event(os, first, ev, "lock wait", 'E');
+            os << R"(,"args":{"timeout":)" << ev.value << "}}";
+            break;
+        case detail::trace_point::held:
+            write_event(os, first, ev, "hold", 'b');
+            os << R"(,"id":")" << ev.set << R"(","args":{"count":)" << ev.value << ',';
+            write_set(os, ev.set);
+            os << "}}";
+            break;
+        case detail::trace_point::unlock:
+            write_event(os, first, ev, "hold", 'e');
+            os << R"(,"id":")" << ev.set << R"("})";
+            break;
+        case detail::trace_point::release:
+            write_event(os, first, ev, "hold", 'e');
+            os << R"(,"id":")" << ev.set << R"(","args":{"released":)" << ev.value << "}}";
+            break;
+        }
+    }
+    os << "\n]}\n";
+}
+
+namespace detail {
+void record_trace_point(trace_point point, const void* set, std::size_t value) noexcept {
+    trace_buffer* b = active_buffer.load(std::memory_order_acquire);
+    if (b == nullptr) {
+        return;
+    }
+    const std::uint64_t pos  = b->head.fetch_add(1, std::memory_order_relaxed);
+    auto&               slot = b->slots[pos % lock_trace_capacity];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.ns.store(now_ns() - b->start_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    slot.set.store(set, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.tid.store(trace_tid(), std::memory_order_relaxed);
+    slot.point.store(point, std::memory_order_relaxed);
+    slot.seq.store(pos + 1, std::memory_order_release);
+}
+} // namespace detail
+} // namespace beman::timed_lock_alg
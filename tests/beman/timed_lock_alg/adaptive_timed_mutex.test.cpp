@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <gtest/gtest.h>
+
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_ADAPTIVE_TIMED_MUTEX)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+
+static_assert(tla::detail::TimedLockable<tla::adaptive_timed_mutex>);
+
+TEST(AdaptiveTimedMutex, LockUnlock) {
+    tla::adaptive_timed_mutex mtx;
+    mtx.lock();
+    EXPECT_FALSE(mtx.try_lock());
+    mtx.unlock();
+    EXPECT_TRUE(mtx.try_lock());
+    mtx.unlock();
+}
+
+TEST(AdaptiveTimedMutex, TryLockForTimesOut) {
+    tla::adaptive_timed_mutex mtx;
+    std::lock_guard           lg(mtx);
+    std::thread([&] {
+        const auto start = std::chrono::steady_clock::now();
+        EXPECT_FALSE(mtx.try_lock_for(10ms));
+        EXPECT_GE(std::chrono::steady_clock::now() - start, 10ms);
+        EXPECT_FALSE(mtx.try_lock_until(std::chrono::system_clock::now() + 1ms));
+    }).join();
+}
+
+TEST(AdaptiveTimedMutex, TryLockForWakesOnUnlock) {
+    tla::adaptive_timed_mutex mtx;
+    mtx.lock();
+    std::thread th([&] {
+        EXPECT_TRUE(mtx.try_lock_for(10s));
+        mtx.unlock();
+    });
+    std::this_thread::sleep_for(10ms);
+    mtx.unlock();
+    th.join();
+}
+
+TEST(AdaptiveTimedMutex, MutualExclusion) {
+    tla::adaptive_timed_mutex mtx;
+    int                       counter = 0;
+    std::vector<std::thread>  ths;
+    for (int t = 0; t < 4; ++t) {
+        ths.emplace_back([&] {
+            for (int i = 0; i < 10000; ++i) {
+                if (i % 2 == 0) {
+                    std::lock_guard lg(mtx);
+                    ++counter;
+                } else {
+                    std::unique_lock lock(mtx, 10s);
+                    ASSERT_TRUE(lock);
+                    ++counter;
+                }
+            }
+        });
+    }
+    for (auto& th : ths) {
+        th.join();
+    }
+    EXPECT_EQ(counter, 40000);
+}
+
+TEST(AdaptiveTimedMutex, SpinFollowsHoldTimes) {
+    tla::adaptive_timed_mutex mtx(20us);
+    for (std::uint32_t i = 0; i < 100 * tla::adaptive_timed_mutex::sample_interval; ++i) {
+        std::lock_guard lg(mtx);
+    }
+    EXPECT_LT(mtx.hold_time_estimate(), 10us);
+    EXPECT_EQ(std::min<std::chrono::nanoseconds>(2 * mtx.hold_time_estimate(), 20us), mtx.spin_duration());
+
+    // holds longer than the spin limit make waiters park right away
+    for (std::uint32_t i = 0; i < 20 * tla::adaptive_timed_mutex::sample_interval; ++i) {
+        std::lock_guard lg(mtx);
+        std::this_thread::sleep_for(50us);
+    }
+    EXPECT_GT(mtx.hold_time_estimate(), 20us);
+    EXPECT_EQ(0ns, mtx.spin_duration());
+}
+
+TEST(AdaptiveTimedMutex, WithAlgorithms) {
+    tla::adaptive_timed_mutex a, b;
+    std::timed_mutex          c;
+    std::atomic<int>          done = 0;
+    std::vector<std::thread>  ths;
+    for (int t = 0; t < 4; ++t) {
+        ths.emplace_back([&, t] {
+            for (int i = 0; i < 1000; ++i) {
+                if (t % 2 == 0) {
+                    tla::multi_lock lock(10s, a, b, c);
+                    ASSERT_TRUE(lock);
+                } else {
+                    ASSERT_EQ(-1, tla::try_lock_for(10s, c, b, a));
+                    a.unlock();
+                    b.unlock();
+                    c.unlock();
+                }
+            }
+            ++done;
+        });
+    }
+    for (auto& th : ths) {
+        th.join();
+    }
+    EXPECT_EQ(4, done);
+}
+
+#if defined(__cpp_lib_jthread)
+TEST(AdaptiveTimedMutex, StopWakesWaiter) {
+    tla::adaptive_timed_mutex mtx;
+    std::lock_guard           lg(mtx);
+    std::stop_source          ss;
+    std::thread               th([&] {
+        EXPECT_FALSE(mtx.try_lock_until(ss.get_token(), std::chrono::steady_clock::now() + 10s));
+    });
+    std::this_thread::sleep_for(10ms);
+    const auto start = std::chrono::steady_clock::now();
+    ss.request_stop();
+    th.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+#endif
+#else
+TEST(AdaptiveTimedMutex, Unsupported) { GTEST_SKIP() << "adaptive_timed_mutex is only available on Linux"; }
+#endif
@@ -0,0 +1,400 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/async.hpp>
+#include "jthread.hpp"
+
+#include <gtest/gtest.h>
+
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_COROUTINES)
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+using JThread = beman::timed_lock_alg::test::JThread;
+
+namespace {
+// an eagerly started coroutine that nobody waits for, used to drive the awaitables
+struct detached {
+    struct promise_type {
+        detached            get_return_object() noexcept { return {}; }
+        std::suspend_never  initial_suspend() noexcept { return {}; }
+        std::suspend_never  final_suspend() noexcept { return {}; }
+        void                return_void() noexcept {}
+        [[noreturn]] void   unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+constexpr int pending = -2;
+
+// a scheduler whose handles are resumed by the thread calling run
+struct queue_scheduler {
+    std::mutex                           mtx;
+    std::vector<std::coroutine_handle<>> handles;
+
+    void schedule(std::coroutine_handle<> h) {
+        std::lock_guard lock(mtx);
+        handles.push_back(h);
+    }
+
+    // waits up to 10s for scheduled handles and resumes them, returning how many there were
+    std::size_t run() {
+        const auto                           end = std::chrono::steady_clock::now() + 10s;
+        std::vector<std::coroutine_handle<>> hs;
+        while (hs.empty() && std::chrono::steady_clock::now() < end) {
+            {
+                std::lock_guard lock(mtx);
+                hs.swap(handles);
+            }
+            if (hs.empty()) {
+                std::this_thread::sleep_for(1ms);
+            }
+        }
+        for (auto h : hs) {
+            h.resume();
+        }
+        return hs.size();
+    }
+};
+static_assert(tla::async_scheduler<queue_scheduler>);
+
+detached lock_for(tla::async_timed_mutex& m, std::chrono::milliseconds dur, std::atomic<int>& result) {
+    result = (co_await m.async_try_lock_for(dur)) ? 1 : 0;
+}
+
+detached lock_for_on(tla::async_timed_mutex& m,
+                     std::chrono::milliseconds dur,
+                     queue_scheduler&          sched,
+                     std::atomic<int>&         result,
+                     std::thread::id&          resumed_on) {
+    const bool acquired = co_await m.async_try_lock_for(dur, sched);
+    resumed_on          = std::this_thread::get_id();
+    result              = acquired ? 1 : 0;
+}
+
+detached lock_and_log(tla::async_timed_mutex& m, int id, std::vector<int>& log) {
+    co_await m.async_lock();
+    log.push_back(id);
+    m.unlock();
+}
+
+template <class... Ms>
+detached lock_all_for(std::chrono::milliseconds dur, std::atomic<int>& result, Ms&... ms) {
+    result = co_await tla::async_try_lock_for(dur, ms...);
+}
+
+template <class... Ms>
+detached lock_all_for_on(queue_scheduler& sched, std::chrono::milliseconds dur, std::atomic<int>& result, Ms&... ms) {
+    result = co_await tla::async_try_lock_for(sched, dur, ms...);
+}
+
+template <class R>
+detached lock_range_for(std::chrono::milliseconds dur, std::atomic<int>& result, R& r) {
+    result = co_await tla::async_try_lock_for(dur, r);
+}
+
+detached lock_pair_and_release(tla::async_timed_mutex& a, tla::async_timed_mutex& b, std::atomic<int>& done) {
+    const int rv = co_await tla::async_try_lock_for(10s, a, b);
+    if (rv == -1) {
+        ++done;
+        a.unlock();
+        b.unlock();
+    }
+}
+
+void wait_for_result(const std::atomic<int>& result) {
+    const auto end = std::chrono::steady_clock::now() + 10s;
+    while (result == pending && std::chrono::steady_clock::now() < end) {
+        std::this_thread::sleep_for(1ms);
+    }
+}
+} // namespace
+
+TEST(AsyncTimedMutex, Uncontended) {
+    tla::async_timed_mutex m;
+    std::atomic<int>       result = pending;
+    lock_for(m, 0ms, result);
+    EXPECT_EQ(1, result);
+    EXPECT_FALSE(m.try_lock());
+    m.unlock();
+    EXPECT_TRUE(m.try_lock());
+    m.unlock();
+}
+
+TEST(AsyncTimedMutex, ResumedByUnlock) {
+    tla::async_timed_mutex m;
+    std::atomic<int>       result = pending;
+    m.lock();
+    lock_for(m, 10s, result);
+    EXPECT_EQ(pending, result);
+    m.unlock(); // hands the mutex over and resumes the coroutine on this thread
+    EXPECT_EQ(1, result);
+    EXPECT_FALSE(m.try_lock());
+    m.unlock();
+}
+
+TEST(AsyncTimedMutex, FifoHandOver) {
+    tla::async_timed_mutex m;
+    std::vector<int>       log;
+    m.lock();
+    for (int i = 0; i < 5; ++i) {
+        lock_and_log(m, i, log);
+    }
+    EXPECT_TRUE(log.empty());
+    m.unlock();
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), log);
+    EXPECT_TRUE(m.try_lock());
+    m.unlock();
+}
+
+TEST(AsyncTimedMutex, LongHandOverChain) {
+    // each coroutine is resumed by the unlock of the previous one, which must not nest them on the stack
+    constexpr int          count = 100000;
+    tla::async_timed_mutex m;
+    std::vector<int>       log;
+    log.reserve(count);
+    m.lock();
+    for (int i = 0; i < count; ++i) {
+        lock_and_log(m, i, log);
+    }
+    m.unlock();
+    ASSERT_EQ(static_cast<std::size_t>(count), log.size());
+    for (int i = 0; i < count; ++i) {
+        ASSERT_EQ(i, log[static_cast<std::size_t>(i)]);
+    }
+    EXPECT_TRUE(m.try_lock());
+    m.unlock();
+}
+
+TEST(AsyncTimedMutex, SchedulerResumesHandOver) {
+    tla::async_timed_mutex m;
+    queue_scheduler        sched;
+    std::atomic<int>       result = pending;
+    std::thread::id        resumed_on;
+    m.lock();
+    lock_for_on(m, 10s, sched, result, resumed_on);
+    m.unlock(); // hands the mutex over and schedules the coroutine
+    EXPECT_EQ(pending, result);
+    EXPECT_EQ(1u, sched.run());
+    EXPECT_EQ(1, result);
+    EXPECT_EQ(std::this_thread::get_id(), resumed_on);
+    m.unlock();
+}
+
+TEST(AsyncTimedMutex, SchedulerResumesTimeout) {
+    tla::async_timed_mutex m;
+    queue_scheduler        sched;
+    std::atomic<int>       result = pending;
+    std::thread::id        resumed_on;
+    m.lock();
+    lock_for_on(m, 20ms, sched, result, resumed_on);
+    EXPECT_EQ(1u, sched.run()); // scheduled by the timer thread
+    EXPECT_EQ(0, result);
+    EXPECT_EQ(std::this_thread::get_id(), resumed_on);
+    m.unlock();
+    EXPECT_TRUE(m.try_lock());
+    m.unlock();
+}
+
+TEST(AsyncTimedMutex, TimesOut) {
+    tla::async_timed_mutex m;
+    std::atomic<int>       result = pending;
+    m.lock();
+    lock_for(m, 0ms, result);
+    EXPECT_EQ(0, result);
+
+    result = pending;
+    lock_for(m, 20ms, result);
+    wait_for_result(result); // resumed by the timer thread
+    EXPECT_EQ(0, result);
+    m.unlock();
+    EXPECT_TRUE(m.try_lock());
+    m.unlock();
+}
+
+TEST(AsyncTimedMutex, BlockingTimedLockable) {
+    tla::async_timed_mutex m;
+    std::lock_guard        lg(m);
+    JThread                th([&] {
+        EXPECT_FALSE(m.try_lock_for(10ms));
+        EXPECT_FALSE(m.try_lock_until(std::chrono::system_clock::now() + 1ms));
+    });
+}
+
+TEST(AsyncTimedMutex, BlockingAndAsyncWaiters) {
+    tla::async_timed_mutex m;
+    int                    counter = 0;
+    {
+        std::vector<std::thread> ths;
+        for (int t = 0; t < 4; ++t) {
+            ths.emplace_back([&] {
+                for (int i = 0; i < 2000; ++i) {
+                    if (i % 2 == 0) {
+                        std::lock_guard lg(m);
+                        ++counter;
+                    } else {
+                        ASSERT_TRUE(m.try_lock_for(10s));
+                        ++counter;
+                        m.unlock();
+                    }
+                }
+            });
+        }
+        for (auto& th : ths) {
+            th.join();
+        }
+    }
+    EXPECT_EQ(8000, counter);
+}
+
+#if defined(__cpp_lib_jthread)
+TEST(AsyncTimedMutex, StopWakesWaiter) {
+    tla::async_timed_mutex m;
+    std::lock_guard        lg(m);
+    std::stop_source       ss;
+    std::atomic<bool>      waiting = false;
+    JThread                th([&] {
+        waiting       = true;
+        const bool ok = m.try_lock_until(ss.get_token(), std::chrono::steady_clock::now() + 10s);
+        EXPECT_FALSE(ok);
+    });
+    while (not waiting) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(5ms);
+    const auto start = std::chrono::steady_clock::now();
+    ss.request_stop();
+    th.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+    EXPECT_FALSE(m.try_lock_until(ss.get_token(), std::chrono::steady_clock::now() + 10s));
+}
+
+TEST(AsyncTimedMutex, StopRacesHandOver) {
+    tla::async_timed_mutex m;
+    for (int i = 0; i < 500; ++i) {
+        m.lock();
+        std::stop_source  ss;
+        std::atomic<bool> waiting = false;
+        bool              ok      = false;
+        {
+            JThread th([&] {
+                waiting = true;
+                ok      = m.try_lock_until(ss.get_token(), std::chrono::steady_clock::now() + 10s);
+            });
+            while (not waiting) {
+                std::this_thread::yield();
+            }
+            JThread stopper([&] { ss.request_stop(); });
+            m.unlock();
+        }
+        if (ok) {
+            m.unlock();
+        }
+        ASSERT_TRUE(m.try_lock());
+        m.unlock();
+    }
+}
+
+TEST(AsyncTryLock, StopCancelsPack) {
+    std::array<tla::async_timed_mutex, 3> mtxs;
+    std::lock_guard                       lg(mtxs[2]);
+    std::stop_source                      ss;
+    JThread                               th([&] {
+        std::this_thread::sleep_for(10ms);
+        ss.request_stop();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(tla::lock_cancelled, tla::try_lock_for(ss.get_token(), 10s, mtxs[0], mtxs[1], mtxs[2]));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+    EXPECT_TRUE(mtxs[0].try_lock());
+    EXPECT_TRUE(mtxs[1].try_lock());
+    mtxs[0].unlock();
+    mtxs[1].unlock();
+}
+#endif
+
+TEST(AsyncTryLock, ZeroMutexes) {
+    std::atomic<int> result = pending;
+    lock_all_for(0ms, result);
+    EXPECT_EQ(-1, result);
+}
+
+TEST(AsyncTryLock, ReleasesWhileSuspended) {
+    std::array<tla::async_timed_mutex, 3> mtxs;
+    std::atomic<int>                      result = pending;
+    mtxs[1].lock();
+    lock_all_for(10s, result, mtxs[0], mtxs[1], mtxs[2]);
+    EXPECT_EQ(pending, result);
+    EXPECT_TRUE(mtxs[0].try_lock()); // released while waiting for mtxs[1]
+    mtxs[0].unlock();
+
+    mtxs[1].unlock();
+    EXPECT_EQ(-1, result);
+    for (auto& m : mtxs) {
+        EXPECT_FALSE(m.try_lock());
+        m.unlock();
+    }
+}
+
+TEST(AsyncTryLock, Scheduler) {
+    std::array<tla::async_timed_mutex, 3> mtxs;
+    queue_scheduler                       sched;
+    std::atomic<int>                      result = pending;
+    mtxs[1].lock();
+    lock_all_for_on(sched, 10s, result, mtxs[0], mtxs[1], mtxs[2]);
+    mtxs[1].unlock();
+    EXPECT_EQ(pending, result);
+    EXPECT_EQ(1u, sched.run());
+    EXPECT_EQ(-1, result);
+    for (auto& m : mtxs) {
+        m.unlock();
+    }
+}
+
+TEST(AsyncTryLock, TimeoutReturnsFailedIndex) {
+    std::array<tla::async_timed_mutex, 3> mtxs;
+    std::atomic<int>                      result = pending;
+    mtxs[2].lock();
+    lock_range_for(20ms, result, mtxs);
+    wait_for_result(result);
+    EXPECT_EQ(2, result);
+    EXPECT_TRUE(mtxs[0].try_lock());
+    EXPECT_TRUE(mtxs[1].try_lock());
+    for (auto& m : mtxs) {
+        m.unlock();
+    }
+}
+
+TEST(AsyncTryLock, ManyWaitersOnOneThread) {
+    std::array<tla::async_timed_mutex, 4> mtxs;
+    std::atomic<int>                      done = 0;
+    for (auto& m : mtxs) {
+        m.lock();
+    }
+    for (int i = 0; i < 10000; ++i) {
+        lock_pair_and_release(mtxs[i % 4], mtxs[(i + 1 + i / 4) % 4 == i % 4 ? (i + 2) % 4 : (i + 1 + i / 4) % 4],
+                              done);
+    }
+    EXPECT_EQ(0, done);
+    for (auto& m : mtxs) {
+        m.unlock();
+    }
+    EXPECT_EQ(10000, done);
+}
+
+TEST(AsyncTryLock, UsableWithBlockingAlgorithms) {
+    tla::async_timed_mutex m1, m2;
+    ASSERT_EQ(-1, tla::try_lock_for(10ms, m1, m2));
+    tla::multi_lock lock(std::adopt_lock, m1, m2);
+    EXPECT_TRUE(lock.owns_lock());
+}
+#else
+TEST(AsyncTimedMutex, Unsupported) { GTEST_SKIP() << "coroutines are not supported by this compiler"; }
+#endif
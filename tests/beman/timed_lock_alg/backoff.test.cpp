@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/backoff.hpp>
+#include <beman/timed_lock_alg/mutex.hpp>
+#include "mock_timed_mutex.hpp"
+#include "jthread.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla   = beman::timed_lock_alg;
+using MockMutex = beman::timed_lock_alg::test::MockTimedMutex;
+using JThread   = beman::timed_lock_alg::test::JThread;
+
+namespace {
+// counts the calls in a counter owned by the test since the algorithms take the policy by value
+struct counting_backoff {
+    int* calls;
+
+    template <class Timepoint>
+    void operator()(const Timepoint&) const {
+        ++*calls;
+    }
+};
+
+// lets a failing MockMutex succeed in the round after the first failed round
+struct flaky_backoff {
+    MockMutex* mtx;
+
+    template <class Timepoint>
+    void operator()(const Timepoint&) const {
+        mtx->should_fail = false;
+    }
+};
+
+// a mutex that is only acquired by blocking, try_lock always fails while contended is set. Two of them make the
+// rotating algorithm lose every round.
+struct try_failing_mutex : MockMutex {
+    bool contended = true;
+
+    bool try_lock() { return not contended && MockMutex::try_lock(); }
+
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        return try_lock_until(std::chrono::steady_clock::now() + dur);
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        return Clock::now() < tp && MockMutex::try_lock();
+    }
+};
+
+template <class Backoff>
+void tricky_sequence(Backoff backoff) {
+    std::array<std::timed_mutex, 3> mtxs;
+    auto                            th = JThread([&] {
+        std::lock(mtxs[0], mtxs[1], mtxs[2]);
+        std::this_thread::sleep_for(55ms);
+        mtxs[0].unlock();
+        std::this_thread::sleep_for(5ms);
+        mtxs[2].unlock();
+        mtxs[0].lock();
+        mtxs[1].unlock();
+        std::this_thread::sleep_for(10ms);
+        mtxs[0].unlock();
+    });
+
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(-1, tla::try_lock_for(200ms, backoff, std::span(mtxs)));
+    std::apply([](auto&... mts) { return std::scoped_lock(std::adopt_lock, mts...); }, mtxs);
+}
+} // namespace
+
+// ============================================================================
+// Policy Tests
+// ============================================================================
+
+TEST(Backoff, NotCalledWhenUncontended) {
+    int       calls = 0;
+    MockMutex m1, m2, m3;
+    EXPECT_EQ(-1, tla::try_lock_for(10ms, counting_backoff{&calls}, m1, m2, m3));
+    EXPECT_EQ(0, calls);
+}
+
+TEST(Backoff, CalledAfterFailedRound) {
+    MockMutex m1, m2;
+    m2.should_fail = true;
+    EXPECT_EQ(-1, tla::try_lock_for(1s, flaky_backoff{&m2}, m1, m2));
+    EXPECT_EQ(1, m1.unlock_count); // released once after the failed round
+    EXPECT_TRUE(m1.locked);
+    EXPECT_TRUE(m2.locked);
+}
+
+TEST(Backoff, CalledAfterFailedRoundRange) {
+    std::array<MockMutex, 3> mtxs;
+    mtxs[2].should_fail = true;
+    EXPECT_EQ(-1, tla::try_lock_for(1s, flaky_backoff{&mtxs[2]}, mtxs));
+    EXPECT_EQ(1, mtxs[0].unlock_count);
+    EXPECT_EQ(1, mtxs[1].unlock_count);
+}
+
+TEST(Backoff, SleepBackoffDoesNotSleepPastDeadline) {
+    tla::sleep_backoff backoff(1h, 1h);
+    const auto         start = std::chrono::steady_clock::now();
+    backoff(start + 10ms);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+
+TEST(Backoff, SleepBackoffGrowsFromZero) {
+    // sleeps at least 1ns, 2ns, ... 1ms, 1ms, ... instead of sleep_for(0) each time
+    tla::sleep_backoff backoff(0ns, 1ms);
+    const auto         start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 30; ++i) {
+        backoff(start + 1h);
+    }
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 5ms);
+}
+
+TEST(Escalation, NeverWithoutEscalatingBackoff) {
+    std::array<try_failing_mutex, 2> mtxs;
+    EXPECT_NE(-1, tla::try_lock_for(20ms, mtxs));
+    EXPECT_FALSE(mtxs[0].locked);
+    EXPECT_FALSE(mtxs[1].locked);
+}
+
+TEST(Escalation, AcquiresInOrderAfterFailedRounds) {
+    int                              calls = 0;
+    std::array<try_failing_mutex, 2> mtxs;
+    EXPECT_EQ(-1, tla::try_lock_for(10s, tla::escalate_after(3, counting_backoff{&calls}), mtxs[0], mtxs[1]));
+    EXPECT_EQ(2, calls); // after the first two failed rounds, the third one escalates
+    EXPECT_TRUE(mtxs[0].locked);
+    EXPECT_TRUE(mtxs[1].locked);
+    EXPECT_EQ(3, mtxs[0].unlock_count + mtxs[1].unlock_count); // the lead of each failed round
+}
+
+TEST(Escalation, Range) {
+    std::vector<try_failing_mutex> mtxs(4);
+    EXPECT_EQ(-1, tla::try_lock_for(10s, tla::escalate_after(1), mtxs));
+    for (auto& m : mtxs) {
+        EXPECT_TRUE(m.locked);
+    }
+}
+
+TEST(Escalation, TimeoutReturnsIndex) {
+    std::array<try_failing_mutex, 3> mtxs;
+    mtxs[1].should_fail = true;
+    mtxs[0].contended   = false;
+    EXPECT_EQ(1, tla::try_lock_for(10s, tla::escalate_after(1), mtxs));
+    EXPECT_FALSE(mtxs[0].locked);
+    EXPECT_FALSE(mtxs[2].locked);
+}
+
+TEST(Escalation, Observed) {
+    tla::contention_counters<>       counters;
+    std::array<try_failing_mutex, 2> mtxs;
+    EXPECT_EQ(-1, tla::try_lock_for(10s, tla::observe(counters, tla::escalate_after(2)), mtxs));
+    EXPECT_EQ(-1, tla::try_lock_for(10s, tla::escalate_after(2, tla::observe(counters)), mtxs[0], mtxs[1]));
+    EXPECT_EQ(counters.calls(), 2u);
+    EXPECT_EQ(counters.rounds(), 6u);
+    EXPECT_EQ(counters.backoffs(), 2u);
+    EXPECT_EQ(counters.timeouts(), 0u);
+}
+
+// ============================================================================
+// Integration Tests with Real Mutexes
+// ============================================================================
+
+TEST(BackoffIntegration, Yield) { tricky_sequence(tla::yield_backoff{}); }
+
+TEST(BackoffIntegration, Spin) { tricky_sequence(tla::spin_backoff{}); }
+
+TEST(BackoffIntegration, Exponential) { tricky_sequence(tla::exponential_backoff{}); }
+
+TEST(BackoffIntegration, Sleep) { tricky_sequence(tla::sleep_backoff{}); }
+
+TEST(BackoffIntegration, MultiLockConstructor) {
+    std::timed_mutex m1, m2;
+    tla::multi_lock  lock(10ms, tla::exponential_backoff{}, m1, m2);
+    EXPECT_TRUE(lock.owns_lock());
+}
+
+TEST(BackoffIntegration, MultiLockTryLockUntil) {
+    std::timed_mutex m1, m2;
+    tla::multi_lock  lock(std::defer_lock, m1, m2);
+    EXPECT_EQ(-1, lock.try_lock_until(std::chrono::steady_clock::now() + 10ms, tla::sleep_backoff{}));
+    EXPECT_TRUE(lock.owns_lock());
+}
+
+TEST(BackoffIntegration, EscalatedAndRotatingThreads) {
+    std::array<std::timed_mutex, 4> mtxs;
+    int                             counter = 0;
+    {
+        std::vector<std::thread> ths;
+        for (unsigned t = 0; t < 4; ++t) {
+            ths.emplace_back([&, t] {
+                std::mt19937 gen(t);
+                for (int i = 0; i < 500; ++i) {
+                    const auto a = gen() % 4;
+                    const auto b = (a + 1 + gen() % 3) % 4;
+                    if (t % 2 == 0) {
+                        ASSERT_EQ(-1, tla::try_lock_for(10s, tla::escalate_after(1), mtxs[a], mtxs[b]));
+                    } else {
+                        ASSERT_EQ(-1, tla::try_lock_for(10s, mtxs[b], mtxs[a]));
+                    }
+                    std::scoped_lock sl(std::adopt_lock, mtxs[a], mtxs[b]);
+                    ++counter;
+                }
+            });
+        }
+        for (auto& th : ths) {
+            th.join();
+        }
+    }
+    EXPECT_EQ(counter, 2000);
+}
+
+TEST(BackoffIntegration, MultiLockEscalating) {
+    std::timed_mutex m1, m2;
+    tla::multi_lock  lock(10ms, tla::escalate_after(4, tla::exponential_backoff{}), m1, m2);
+    EXPECT_TRUE(lock.owns_lock());
+}
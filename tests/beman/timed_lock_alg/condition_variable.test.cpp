@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/condition_variable.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+
+namespace {
+// a std::timed_mutex counting the threads blocked on it at the same time
+class crowd_mutex {
+  public:
+    void lock() {
+        enter();
+        m_mtx.lock();
+        --m_inside;
+    }
+    bool try_lock() { return m_mtx.try_lock(); }
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        return try_lock_until(std::chrono::steady_clock::now() + dur);
+    }
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        enter();
+        const bool locked = m_mtx.try_lock_until(tp);
+        --m_inside;
+        return locked;
+    }
+    void unlock() { m_mtx.unlock(); }
+
+    int  max_crowd() const { return m_max; }
+    void reset_crowd() { m_max = 0; }
+
+  private:
+    void enter() {
+        const int inside = ++m_inside;
+        int       max    = m_max;
+        while (inside > max && not m_max.compare_exchange_weak(max, inside)) {
+        }
+    }
+
+    std::timed_mutex m_mtx;
+    std::atomic<int> m_inside = 0;
+    std::atomic<int> m_max    = 0;
+};
+} // namespace
+
+TEST(MultiLockConditionVariable, WaitReleasesAndReacquires) {
+    std::timed_mutex                   m1, m2;
+    tla::multi_lock_condition_variable cv;
+    bool                               ready = false;
+    std::thread                        waiter([&] {
+        tla::multi_lock lock(m1, m2);
+        cv.wait(lock, [&] { return ready; });
+        EXPECT_TRUE(lock.owns_lock());
+        std::thread([&] { EXPECT_FALSE(m2.try_lock()); }).join();
+    });
+    {
+        tla::multi_lock lock(10s, m2, m1);
+        ASSERT_TRUE(lock);
+        ready = true;
+    }
+    cv.notify_one();
+    waiter.join();
+}
+
+TEST(MultiLockConditionVariable, WaitForTimesOut) {
+    std::timed_mutex                   m1, m2;
+    tla::multi_lock_condition_variable cv;
+    tla::multi_lock                    lock(m1, m2);
+    const auto                         start = std::chrono::steady_clock::now();
+    EXPECT_EQ(std::cv_status::timeout, cv.wait_for(lock, 10ms));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 10ms);
+    EXPECT_TRUE(lock.owns_lock());
+    EXPECT_FALSE(cv.wait_until(lock, std::chrono::system_clock::now() + 1ms, [] { return false; }));
+    EXPECT_TRUE(lock.owns_lock());
+}
+
+TEST(MultiLockConditionVariable, ReacquireWithinDeadline) {
+    std::timed_mutex                   m1, m2;
+    tla::multi_lock_condition_variable cv;
+    std::atomic<bool>                  waiting = false;
+    bool                               ready   = false;
+    std::thread                        waiter([&] {
+        tla::multi_lock lock(m1, m2);
+        waiting = true;
+        EXPECT_FALSE(cv.wait_for(lock, 20ms, [&] { return ready; }));
+        EXPECT_FALSE(lock.owns_lock());
+    });
+    while (not waiting) {
+        std::this_thread::yield();
+    }
+    // keep m2 past the deadline of the waiter after notifying it
+    tla::multi_lock lock(10s, m1, m2);
+    ASSERT_TRUE(lock);
+    ready = true;
+    cv.notify_all();
+    m1.unlock();
+    std::this_thread::sleep_for(50ms);
+    waiter.join();
+    m2.unlock();
+    static_cast<void>(lock.release());
+}
+
+TEST(MultiLockConditionVariable, NotOwnedThrows) {
+    std::timed_mutex                   m;
+    tla::multi_lock_condition_variable cv;
+    tla::multi_lock                    lock(std::defer_lock, m);
+    EXPECT_THROW(cv.wait(lock), std::system_error);
+    EXPECT_THROW(static_cast<void>(cv.wait_for(lock, 1ms)), std::system_error);
+}
+
+TEST(MultiLockConditionVariable, NotifyAllWakesInBatches) {
+    for (const std::size_t batch : {1u, 3u}) {
+        crowd_mutex                        m1, m2;
+        tla::multi_lock_condition_variable cv(batch);
+        EXPECT_EQ(batch, cv.batch_size());
+        int                      entered = 0, woken = 0;
+        bool                     ready   = false;
+        std::vector<std::thread> ths;
+        for (int t = 0; t < 8; ++t) {
+            ths.emplace_back([&] {
+                tla::multi_lock lock(m1, m2);
+                ++entered;
+                ASSERT_TRUE(cv.wait_for(lock, 10s, [&] { return ready; }));
+                ++woken;
+                std::this_thread::sleep_for(1ms);
+            });
+        }
+        // each thread releases the locks only by waiting, so all are waiting once all entered
+        for (;;) {
+            tla::multi_lock lock(m1, m2);
+            if (entered == 8) {
+                m1.reset_crowd();
+                m2.reset_crowd();
+                ready = true;
+                cv.notify_all();
+                std::this_thread::sleep_for(20ms);
+                break;
+            }
+        }
+        for (auto& th : ths) {
+            th.join();
+        }
+        EXPECT_EQ(8, woken);
+        EXPECT_LE(std::max(m1.max_crowd(), m2.max_crowd()), static_cast<int>(batch));
+    }
+}
+
+TEST(MultiLockConditionVariable, OtherLockSets) {
+    std::timed_mutex                   m1, m2;
+    std::shared_timed_mutex            s1, s2;
+    tla::multi_lock_condition_variable cv;
+
+    std::array<std::timed_mutex*, 2> set{&m1, &m2};
+    tla::dynamic_multi_lock          dyn(set);
+    EXPECT_EQ(std::cv_status::timeout, cv.wait_for(dyn, 1ms));
+    EXPECT_TRUE(dyn.owns_lock());
+
+    tla::multi_shared_lock shared(s1, s2);
+    EXPECT_FALSE(cv.wait_for(shared, 1ms, [] { return false; }));
+    EXPECT_TRUE(shared.owns_lock());
+}
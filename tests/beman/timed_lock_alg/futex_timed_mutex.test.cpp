@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/mutex.hpp>
+#include "jthread.hpp"
+
+#include <gtest/gtest.h>
+
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_FUTEX_TIMED_MUTEX)
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+using JThread = beman::timed_lock_alg::test::JThread;
+
+TEST(FutexTimedMutex, LockUnlock) {
+    tla::futex_timed_mutex mtx;
+    mtx.lock();
+    EXPECT_FALSE(mtx.try_lock());
+    mtx.unlock();
+    EXPECT_TRUE(mtx.try_lock());
+    mtx.unlock();
+}
+
+TEST(FutexTimedMutex, TryLockForTimesOut) {
+    tla::futex_timed_mutex mtx;
+    std::lock_guard        lg(mtx);
+    JThread                th([&] {
+        const auto start = std::chrono::steady_clock::now();
+        EXPECT_FALSE(mtx.try_lock_for(10ms));
+        EXPECT_GE(std::chrono::steady_clock::now() - start, 10ms);
+        EXPECT_FALSE(mtx.try_lock_until(std::chrono::system_clock::now() + 1ms));
+    });
+}
+
+TEST(FutexTimedMutex, TryLockForWakesOnUnlock) {
+    tla::futex_timed_mutex mtx;
+    mtx.lock();
+    JThread th([&] {
+        EXPECT_TRUE(mtx.try_lock_for(10s));
+        mtx.unlock();
+    });
+    std::this_thread::sleep_for(10ms);
+    mtx.unlock();
+}
+
+TEST(FutexTimedMutex, MutualExclusion) {
+    tla::futex_timed_mutex mtx;
+    int                    counter = 0;
+    std::vector<std::thread> ths;
+    for (int t = 0; t < 4; ++t) {
+        ths.emplace_back([&] {
+            for (int i = 0; i < 10000; ++i) {
+                std::lock_guard lg(mtx);
+                ++counter;
+            }
+        });
+    }
+    for (auto& th : ths) {
+        th.join();
+    }
+    EXPECT_EQ(counter, 40000);
+}
+
+TEST(FutexTryLock, ManyMutexesUnlocked) {
+    std::array<tla::futex_timed_mutex, 3> mtxs;
+    ASSERT_EQ(tla::try_lock_for(0ms, mtxs[0], mtxs[1], mtxs[2]), -1);
+    for (auto& mtx : mtxs) {
+        EXPECT_FALSE(mtx.try_lock());
+        mtx.unlock();
+    }
+    ASSERT_EQ(tla::try_lock_for(0ms, mtxs), -1);
+    for (auto& mtx : mtxs) {
+        mtx.unlock();
+    }
+}
+
+TEST(FutexTryLock, TimeoutReturnsFailedIndexAndReleases) {
+    std::array<tla::futex_timed_mutex, 3> mtxs;
+    std::lock_guard                       lg(mtxs[1]);
+    JThread                               th([&] {
+        EXPECT_EQ(tla::try_lock_for(10ms, mtxs[0], mtxs[1], mtxs[2]), 1);
+        EXPECT_EQ(tla::try_lock_for(10ms, mtxs), 1);
+        std::array<tla::futex_timed_mutex*, 3> ptrs{&mtxs[2], &mtxs[1], &mtxs[0]};
+        EXPECT_EQ(tla::try_lock_for(10ms, ptrs), 1);
+        EXPECT_TRUE(mtxs[0].try_lock());
+        EXPECT_TRUE(mtxs[2].try_lock());
+        mtxs[0].unlock();
+        mtxs[2].unlock();
+    });
+}
+
+TEST(FutexTryLock, WakesWhenAnyIsUnlocked) {
+    std::array<tla::futex_timed_mutex, 4> mtxs;
+    mtxs[1].lock();
+    mtxs[3].lock();
+    JThread th([&] {
+        ASSERT_EQ(tla::try_lock_for(10s, mtxs), -1);
+        for (auto& mtx : mtxs) {
+            mtx.unlock();
+        }
+    });
+    std::this_thread::sleep_for(10ms);
+    mtxs[3].unlock();
+    std::this_thread::sleep_for(10ms);
+    mtxs[1].unlock();
+}
+
+TEST(FutexTryLock, OppositeOrdersMakeProgress) {
+    std::array<tla::futex_timed_mutex, 3> mtxs;
+    std::atomic<int>                      acquired = 0;
+    {
+        JThread th1([&] {
+            for (int i = 0; i < 2000; ++i) {
+                if (tla::try_lock_for(10s, mtxs[0], mtxs[1], mtxs[2]) == -1) {
+                    ++acquired;
+                    std::scoped_lock sl(std::adopt_lock, mtxs[0], mtxs[1], mtxs[2]);
+                }
+            }
+        });
+        JThread th2([&] {
+            for (int i = 0; i < 2000; ++i) {
+                if (tla::try_lock_for(10s, mtxs[2], mtxs[1], mtxs[0]) == -1) {
+                    ++acquired;
+                    std::scoped_lock sl(std::adopt_lock, mtxs[2], mtxs[1], mtxs[0]);
+                }
+            }
+        });
+    }
+    EXPECT_EQ(acquired, 4000);
+}
+
+TEST(FutexTryLockAny, WakesOnTheFirstUnlocked) {
+    std::array<tla::futex_timed_mutex, 3> mtxs;
+    for (auto& mtx : mtxs) {
+        mtx.lock();
+    }
+    JThread th([&] {
+        EXPECT_EQ(tla::try_lock_any_for(0ms, mtxs), -1);
+        ASSERT_EQ(tla::try_lock_any_for(10s, mtxs[0], mtxs[1], mtxs[2]), 2);
+        mtxs[2].unlock();
+    });
+    std::this_thread::sleep_for(10ms);
+    mtxs[2].unlock();
+    th.join();
+    mtxs[0].unlock();
+    mtxs[1].unlock();
+}
+
+TEST(FutexTryLockK, TimeoutReleases) {
+    std::array<tla::futex_timed_mutex, 3> mtxs;
+    std::lock_guard                       lg(mtxs[1]);
+    JThread                               th([&] {
+        EXPECT_FALSE(tla::try_lock_k_for(10ms, 3, mtxs));
+        std::array<tla::futex_timed_mutex*, 3> ptrs{&mtxs[2], &mtxs[1], &mtxs[0]};
+        EXPECT_EQ(tla::try_lock_k_for(10ms, 2, ptrs).value().size(), 2u);
+        mtxs[0].unlock();
+        mtxs[2].unlock();
+        EXPECT_TRUE(mtxs[0].try_lock());
+        EXPECT_TRUE(mtxs[2].try_lock());
+        mtxs[0].unlock();
+        mtxs[2].unlock();
+    });
+}
+
+TEST(FutexTryLockAny, PoolIsExclusive) {
+    std::array<tla::futex_timed_mutex, 2> pool;
+    std::array<std::atomic<int>, 2>       users{};
+    std::atomic<int>                      overlaps = 0;
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 2000; ++i) {
+                    const auto idx = static_cast<std::size_t>(tla::try_lock_any_for(10s, pool[0], pool[1]));
+                    ASSERT_LT(idx, pool.size());
+                    overlaps += ++users[idx] != 1;
+                    --users[idx];
+                    pool[idx].unlock();
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+    EXPECT_EQ(overlaps, 0);
+}
+
+#if defined(__cpp_lib_jthread)
+TEST(FutexTimedMutex, StopWakesWaiter) {
+    tla::futex_timed_mutex mtx;
+    std::lock_guard        lg(mtx);
+    std::stop_source       ss;
+    std::atomic<bool>      waiting = false;
+    JThread                th([&] {
+        waiting       = true;
+        const bool ok = mtx.try_lock_until(ss.get_token(), std::chrono::steady_clock::now() + 10s);
+        EXPECT_FALSE(ok);
+    });
+    while (not waiting) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(5ms);
+    const auto start = std::chrono::steady_clock::now();
+    ss.request_stop();
+    th.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+    EXPECT_FALSE(mtx.try_lock_until(ss.get_token(), std::chrono::steady_clock::now() + 10s));
+}
+
+TEST(FutexTryLock, StopCancelsPack) {
+    std::array<tla::futex_timed_mutex, 3> mtxs;
+    std::lock_guard                       lg(mtxs[2]);
+    std::stop_source                      ss;
+    JThread                               th([&] {
+        std::this_thread::sleep_for(10ms);
+        ss.request_stop();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(tla::lock_cancelled, tla::try_lock_for(ss.get_token(), 10s, mtxs[0], mtxs[1], mtxs[2]));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+    EXPECT_TRUE(mtxs[0].try_lock());
+    EXPECT_TRUE(mtxs[1].try_lock());
+    mtxs[0].unlock();
+    mtxs[1].unlock();
+}
+#endif
+#else
+TEST(FutexTimedMutex, Unsupported) { GTEST_SKIP() << "futex_timed_mutex is only available on Linux"; }
+#endif
@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/hold_time.hpp>
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+
+namespace {
+class HoldTime : public ::testing::Test {
+  protected:
+    void SetUp() override { tla::reset_hold_times(); }
+    void TearDown() override { tla::reset_hold_times(); }
+};
+
+// the histogram recorded for the site on line in this file, if any
+std::optional<tla::hold_time_histogram> recorded_at(std::uint_least32_t line) {
+    for (const auto& site : tla::collect_hold_times()) {
+        if (site.line == line && site.file.find("hold_time.test.cpp") != std::string::npos) {
+            return site.histogram;
+        }
+    }
+    return std::nullopt;
+}
+} // namespace
+
+TEST(HoldTimeHistogram, Buckets) {
+    EXPECT_EQ(0u, tla::hold_time_histogram::bucket_of(0ns));
+    EXPECT_EQ(1u, tla::hold_time_histogram::bucket_of(1ns));
+    EXPECT_EQ(2u, tla::hold_time_histogram::bucket_of(2ns));
+    EXPECT_EQ(2u, tla::hold_time_histogram::bucket_of(3ns));
+    EXPECT_EQ(10u, tla::hold_time_histogram::bucket_of(1us));
+    EXPECT_EQ(tla::hold_time_histogram::bucket_count - 1,
+              tla::hold_time_histogram::bucket_of(std::chrono::nanoseconds::max()));
+    EXPECT_EQ(3ns, tla::hold_time_histogram::bucket_upper_bound(2));
+    EXPECT_EQ(1023ns, tla::hold_time_histogram::bucket_upper_bound(10));
+}
+
+TEST(HoldTimeHistogram, Statistics) {
+    tla::hold_time_histogram h;
+    EXPECT_EQ(0ns, h.percentile(50));
+    EXPECT_EQ(0ns, h.mean());
+    for (int i = 0; i < 99; ++i) {
+        h.record(100ns);
+    }
+    h.record(1ms);
+    EXPECT_EQ(100u, h.count());
+    EXPECT_EQ(1ms, h.max());
+    EXPECT_EQ(99 * 100ns + 1ms, h.total());
+    EXPECT_EQ(127ns, h.percentile(50));
+    EXPECT_EQ(127ns, h.percentile(99));
+    EXPECT_EQ(1ms, h.percentile(100));
+
+    tla::hold_time_histogram other;
+    other.record(2ms);
+    h.merge(other);
+    EXPECT_EQ(101u, h.count());
+    EXPECT_EQ(2ms, h.max());
+}
+
+#if defined(BEMAN_TIMED_LOCK_ALG_HOLD_TIME_HISTOGRAMS)
+TEST_F(HoldTime, RecordsUntilUnlock) {
+    std::timed_mutex m1, m2;
+    tla::multi_lock  lock(std::defer_lock, m1, m2);
+    const auto       line = __LINE__ + 1;
+    ASSERT_EQ(-1, lock.try_lock_for(10ms));
+    std::this_thread::sleep_for(2ms);
+    lock.unlock();
+    std::this_thread::sleep_for(2ms);
+
+    const auto h = recorded_at(line);
+    ASSERT_TRUE(h);
+    EXPECT_EQ(1u, h->count());
+    EXPECT_GE(h->max(), 2ms);
+    EXPECT_LT(h->max(), 1s);
+}
+
+TEST_F(HoldTime, RecordsOnDestruction) {
+    std::timed_mutex                 m;
+    std::array<std::timed_mutex*, 1> set{&m};
+    std::uint_least32_t              line = 0;
+    for (int i = 0; i < 3; ++i) {
+        tla::dynamic_multi_lock lock(std::defer_lock, set);
+        line = __LINE__ + 1;
+        lock.lock();
+    }
+    const auto h = recorded_at(line);
+    ASSERT_TRUE(h);
+    EXPECT_EQ(3u, h->count());
+}
+
+TEST_F(HoldTime, RecordsConstructorCallers) {
+    std::timed_mutex                 m1, m2;
+    std::array<std::timed_mutex*, 2> set{&m1, &m2};
+    std::uint_least32_t              first = 0, second = 0, dynamic = 0;
+    for (int i = 0; i < 2; ++i) {
+        first = __LINE__ + 1;
+        tla::multi_lock lock(10ms, m1, m2);
+    }
+    {
+        second = __LINE__ + 1;
+        tla::multi_lock lock(m1, m2);
+    }
+    {
+        dynamic = __LINE__ + 1;
+        tla::dynamic_multi_lock lock(tla::ordered_lock, 10ms, set);
+    }
+    ASSERT_TRUE(recorded_at(first));
+    EXPECT_EQ(2u, recorded_at(first)->count());
+    ASSERT_TRUE(recorded_at(second));
+    EXPECT_EQ(1u, recorded_at(second)->count());
+    ASSERT_TRUE(recorded_at(dynamic));
+    EXPECT_EQ(1u, recorded_at(dynamic)->count());
+    EXPECT_EQ(3u, tla::collect_hold_times().size());
+}
+
+TEST_F(HoldTime, ReleaseIsNotCounted) {
+    std::timed_mutex m;
+    {
+        tla::multi_lock lock(std::defer_lock, m);
+        const auto      line = __LINE__ + 1;
+        ASSERT_EQ(-1, lock.try_lock());
+        static_cast<void>(lock.release());
+        m.unlock();
+        EXPECT_FALSE(recorded_at(line));
+    }
+}
+
+TEST_F(HoldTime, MovedLockKeepsTiming) {
+    std::timed_mutex m;
+    tla::multi_lock  lock(std::defer_lock, m);
+    const auto       line = __LINE__ + 1;
+    lock.lock();
+    {
+        auto moved = std::move(lock);
+    }
+    EXPECT_EQ(1u, recorded_at(line)->count());
+}
+#endif
+
+TEST_F(HoldTime, MergesThreads) {
+    const auto        site      = tla::lock_order_site::current();
+    std::atomic<bool> recorded  = false;
+    std::atomic<bool> collected = false;
+    std::thread       live([&] {
+        tla::record_hold_time(site, 1us);
+        recorded = true;
+        while (not collected) {
+            std::this_thread::yield();
+        }
+    });
+    for (int t = 0; t < 4; ++t) {
+        std::thread([&] {
+            for (int i = 0; i < 100; ++i) {
+                tla::record_hold_time(site, 10us);
+            }
+        }).join();
+    }
+    while (not recorded) {
+        std::this_thread::yield();
+    }
+    const auto h = recorded_at(site.line());
+    collected    = true;
+    live.join();
+#if defined(__cpp_lib_source_location)
+    ASSERT_TRUE(h);
+    EXPECT_EQ(401u, h->count());
+    EXPECT_EQ(400 * 10us + 1us, h->total());
+#else
+    static_cast<void>(h);
+#endif
+
+    std::ostringstream os;
+    tla::dump_hold_times(os);
+    EXPECT_NE(std::string::npos, os.str().find("count=401"));
+
+    tla::reset_hold_times();
+    EXPECT_TRUE(tla::collect_hold_times().empty());
+}
+
+TEST_F(HoldTime, ResetForgetsSitesOfLiveThreads) {
+    const auto site = tla::lock_order_site::current();
+    tla::record_hold_time(site, 1us);
+    ASSERT_FALSE(tla::collect_hold_times().empty());
+    tla::reset_hold_times();
+    EXPECT_TRUE(tla::collect_hold_times().empty());
+    tla::record_hold_time(site, 2us);
+    const auto sites = tla::collect_hold_times();
+    ASSERT_EQ(1u, sites.size());
+    EXPECT_EQ(1u, sites[0].histogram.count());
+    EXPECT_EQ(2us, sites[0].histogram.total());
+}
+
+TEST_F(HoldTime, ResetWhileRecording) {
+    const auto site = tla::lock_order_site::current();
+    for (int round = 0; round < 20; ++round) {
+        std::atomic<std::uint64_t> recorded = 0;
+        std::atomic<bool>          stop     = false;
+        std::thread                recorder([&] {
+            while (not stop) {
+                tla::record_hold_time(site, 1us);
+                ++recorded;
+            }
+        });
+        while (recorded < 10000) {
+            std::this_thread::yield();
+        }
+        const std::uint64_t before = recorded;
+        tla::reset_hold_times();
+        stop = true;
+        recorder.join();
+        // only hold times recorded after the reset may be left
+        std::uint64_t left = 0;
+        for (const auto& s : tla::collect_hold_times()) {
+            left += s.histogram.count();
+        }
+        EXPECT_LE(left, recorded - before);
+    }
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef BEMAN_TIMED_LOCK_ALG_TESTS_JTHREAD_HPP
+#define BEMAN_TIMED_LOCK_ALG_TESTS_JTHREAD_HPP
+
+#include <thread>
+#include <utility>
+
+namespace beman::timed_lock_alg::test {
+
+// joining thread for implementations missing std::jthread
+class JThread : public std::thread {
+  public:
+    template <class... Args>
+    JThread(Args&&... args) : std::thread(std::forward<Args>(args)...) {}
+    ~JThread() {
+        if (joinable()) {
+            join();
+        }
+    }
+};
+
+} // namespace beman::timed_lock_alg::test
+
+#endif // BEMAN_TIMED_LOCK_ALG_TESTS_JTHREAD_HPP
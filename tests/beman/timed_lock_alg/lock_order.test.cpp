@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/lock_order.hpp>
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+
+static_assert(tla::detail::validate_lock_order, "the lock-order tests are built with the validator enabled");
+
+namespace {
+// collects the cycles reported during a test
+class LockOrder : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        tla::reset_lock_order_graph();
+        tla::set_lock_order_handler([this](const tla::lock_order_cycle& cycle) { cycles.push_back(cycle); });
+    }
+
+    void TearDown() override {
+        tla::set_lock_order_handler({});
+        tla::set_lock_order_sampling(1);
+        tla::reset_lock_order_graph();
+    }
+
+    std::vector<tla::lock_order_cycle> cycles;
+};
+} // namespace
+
+TEST_F(LockOrder, ConsistentOrderIsNoCycle) {
+    std::timed_mutex a, b, c;
+    for (int i = 0; i < 3; ++i) {
+        tla::multi_lock outer(a);
+        tla::multi_lock inner(10ms, b, c);
+    }
+    {
+        tla::multi_lock outer(b);
+        tla::multi_lock inner(c);
+    }
+    EXPECT_TRUE(cycles.empty());
+}
+
+TEST_F(LockOrder, ReportsCycleWithSites) {
+    std::timed_mutex a, b;
+    {
+        tla::multi_lock outer(a);
+        tla::multi_lock inner(b);
+    }
+    EXPECT_TRUE(cycles.empty());
+    int line;
+    {
+        tla::multi_lock outer(b);
+        tla::multi_lock inner(std::defer_lock, a);
+        line = __LINE__ + 1;
+        ASSERT_EQ(-1, inner.try_lock_for(10ms));
+    }
+    ASSERT_EQ(1u, cycles.size());
+    const auto& edges = cycles[0].edges;
+    ASSERT_EQ(2u, edges.size());
+    EXPECT_EQ(&a, edges[0].held);
+    EXPECT_EQ(&b, edges[0].acquired);
+    EXPECT_EQ(&b, edges[1].held);
+    EXPECT_EQ(&a, edges[1].acquired);
+    EXPECT_EQ(std::this_thread::get_id(), edges[1].thread);
+#if defined(__cpp_lib_source_location)
+    EXPECT_EQ(static_cast<std::uint_least32_t>(line), edges[1].acquired_at.line());
+    EXPECT_NE(std::string_view::npos, std::string_view(edges[1].acquired_at.file_name()).find("lock_order.test.cpp"));
+#else
+    static_cast<void>(line);
+#endif
+
+    // the same edge is reported only once
+    {
+        tla::multi_lock outer(b);
+        tla::multi_lock inner(a);
+    }
+    EXPECT_EQ(1u, cycles.size());
+}
+
+TEST_F(LockOrder, CycleAcrossThreads) {
+    std::array<std::timed_mutex, 3> ms;
+    for (std::size_t i = 0; i < ms.size(); ++i) {
+        std::thread([&, i] {
+            tla::multi_lock outer(ms[i]);
+            tla::multi_lock inner(10ms, ms[(i + 1) % ms.size()]);
+        }).join();
+    }
+    ASSERT_EQ(1u, cycles.size());
+    const auto& edges = cycles[0].edges;
+    ASSERT_EQ(3u, edges.size());
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+        EXPECT_EQ(edges[i].acquired, edges[(i + 1) % edges.size()].held);
+    }
+    EXPECT_EQ(&ms[0], edges.back().acquired);
+}
+
+TEST_F(LockOrder, AcquiredTogetherIsNoCycle) {
+    std::timed_mutex a, b;
+    {
+        tla::multi_lock lock(a, b);
+    }
+    {
+        tla::multi_lock lock(10ms, b, a);
+    }
+    {
+        std::array<std::timed_mutex*, 2> set{&b, &a};
+        tla::dynamic_multi_lock          lock(set);
+    }
+    EXPECT_TRUE(cycles.empty());
+}
+
+TEST_F(LockOrder, DynamicMultiLock) {
+    std::timed_mutex                 a, b, c;
+    std::array<std::timed_mutex*, 2> bc{&b, &c};
+    std::array<std::timed_mutex*, 1> just_a{&a};
+    {
+        tla::dynamic_multi_lock outer(just_a);
+        tla::dynamic_multi_lock inner(10ms, bc);
+    }
+    {
+        tla::dynamic_multi_lock outer(bc);
+        tla::multi_lock         inner(a);
+    }
+    EXPECT_EQ(2u, cycles.size());
+}
+
+TEST_F(LockOrder, ReleasedLockablesStayHeld) {
+    std::timed_mutex a, b;
+    {
+        tla::multi_lock outer(a);
+        tla::multi_lock inner(b);
+    }
+    {
+        tla::multi_lock outer(b);
+        static_cast<void>(outer.release());
+        {
+            tla::multi_lock inner(a);
+        }
+        EXPECT_EQ(1u, cycles.size());
+        b.unlock();
+        const std::array<const void*, 1> kb{&b};
+        tla::lock_order_released(kb);
+        tla::multi_lock inner(a);
+    }
+    EXPECT_EQ(1u, cycles.size());
+}
+
+TEST_F(LockOrder, ThrowingHandlerKeepsTheLock) {
+    tla::set_lock_order_handler([](const tla::lock_order_cycle&) { throw std::runtime_error("cycle"); });
+    std::timed_mutex a, b;
+    {
+        tla::multi_lock outer(a);
+        tla::multi_lock inner(b);
+    }
+    {
+        tla::multi_lock outer(b);
+        tla::multi_lock inner(10ms, a);
+        EXPECT_TRUE(inner.owns_lock());
+    }
+    EXPECT_TRUE(a.try_lock());
+    EXPECT_TRUE(b.try_lock());
+    a.unlock();
+    b.unlock();
+}
+
+TEST_F(LockOrder, SamplingOff) {
+    tla::set_lock_order_sampling(0);
+    std::timed_mutex a, b;
+    {
+        tla::multi_lock outer(a);
+        tla::multi_lock inner(b);
+    }
+    {
+        tla::multi_lock outer(b);
+        tla::multi_lock inner(a);
+    }
+    EXPECT_TRUE(cycles.empty());
+}
+
+TEST_F(LockOrder, ManualAnnotations) {
+    std::mutex                       a, b;
+    const std::array<const void*, 1> ka{&a}, kb{&b};
+    tla::lock_order_acquired(ka);
+    tla::lock_order_acquired(kb);
+    tla::lock_order_released(kb);
+    tla::lock_order_released(ka);
+    tla::lock_order_acquired(kb);
+    tla::lock_order_acquired(ka);
+    tla::lock_order_released(ka);
+    tla::lock_order_released(kb);
+    EXPECT_EQ(1u, cycles.size());
+}
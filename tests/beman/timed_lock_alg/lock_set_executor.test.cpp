@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/lock_set_executor.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+
+namespace {
+// waits until pred() or 10s passed, so that a broken executor fails the test instead of hanging it
+template <class Pred>
+bool eventually(Pred pred) {
+    const auto end = std::chrono::steady_clock::now() + 10s;
+    while (not pred()) {
+        if (std::chrono::steady_clock::now() > end) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+} // namespace
+
+TEST(LockSetExecutor, ThreadCount) {
+    tla::lock_set_executor ex(0);
+    EXPECT_EQ(1u, ex.thread_count());
+    tla::lock_set_executor ex3(3);
+    EXPECT_EQ(3u, ex3.thread_count());
+}
+
+TEST(LockSetExecutor, RunsWithLocksHeld) {
+    std::timed_mutex       m1, m2;
+    tla::lock_set_executor ex(2);
+    std::array             set{&m1, &m2};
+    auto                   done = ex.submit(set, [&] {
+        std::thread([&] {
+            EXPECT_FALSE(m1.try_lock());
+            EXPECT_FALSE(m2.try_lock());
+        }).join();
+    });
+    EXPECT_TRUE(done.get());
+    EXPECT_TRUE(m1.try_lock());
+    EXPECT_TRUE(m2.try_lock());
+    m1.unlock();
+    m2.unlock();
+}
+
+TEST(LockSetExecutor, RepeatedLockableIsLockedOnce) {
+    std::timed_mutex       m1, m2;
+    tla::lock_set_executor ex(1);
+    std::array             set{&m1, &m2, &m1};
+    auto                   done = ex.submit(1s, set, [&] {
+        std::thread([&] {
+            EXPECT_FALSE(m1.try_lock());
+            EXPECT_FALSE(m2.try_lock());
+        }).join();
+    });
+    EXPECT_TRUE(done.get());
+    EXPECT_TRUE(m1.try_lock());
+    m1.unlock();
+}
+
+TEST(LockSetExecutor, MutualExclusion) {
+    std::array<std::timed_mutex, 4> ms;
+    std::array<int, 4>              counters{};
+    std::vector<std::future<bool>>  futures;
+    {
+        tla::lock_set_executor ex(4);
+        for (std::size_t i = 0; i != 400; ++i) {
+            const std::size_t              a = i % 4, b = (a + 1 + i / 4 % 3) % 4;
+            std::vector<std::timed_mutex*> set{&ms[a], &ms[b]};
+            futures.push_back(ex.submit(set, [&, a, b] {
+                ++counters[a];
+                ++counters[b];
+            }));
+        }
+    }
+    for (auto& f : futures) {
+        EXPECT_TRUE(f.get());
+    }
+    EXPECT_EQ(800, counters[0] + counters[1] + counters[2] + counters[3]);
+}
+
+TEST(LockSetExecutor, DisjointSetsRunInParallel) {
+    std::timed_mutex       m1, m2;
+    std::atomic<int>       running = 0;
+    tla::lock_set_executor ex(2);
+    auto                   task = [&] {
+        ++running;
+        EXPECT_TRUE(eventually([&] { return running == 2; }));
+    };
+    auto f1 = ex.submit(std::array{&m1}, task);
+    auto f2 = ex.submit(std::array{&m2}, task);
+    EXPECT_TRUE(f1.get());
+    EXPECT_TRUE(f2.get());
+}
+
+TEST(LockSetExecutor, ConflictingTasksWaitQueued) {
+    std::timed_mutex       m1, m2;
+    std::atomic<bool>      release = false;
+    std::atomic<int>       order   = 0;
+    int                    second  = 0;
+    tla::lock_set_executor ex(3);
+
+    auto first = ex.submit(std::array{&m1}, [&] { EXPECT_TRUE(eventually([&] { return release.load(); })); });
+    // queued behind first on m1, and keeps third from overtaking it on m2
+    auto blocked = ex.submit(std::array{&m1, &m2}, [&] { second = ++order; });
+    auto third   = ex.submit(std::array{&m2}, [&] { ++order; });
+    auto other   = ex.submit(std::vector<std::timed_mutex*>{}, [] {});
+
+    EXPECT_TRUE(other.get());
+    EXPECT_EQ(std::future_status::timeout, blocked.wait_for(10ms));
+    EXPECT_EQ(std::future_status::timeout, third.wait_for(0s));
+    release = true;
+    EXPECT_TRUE(first.get());
+    EXPECT_TRUE(blocked.get());
+    EXPECT_TRUE(third.get());
+    EXPECT_EQ(1, second);
+}
+
+TEST(LockSetExecutor, DeadlinePasses) {
+    std::timed_mutex       m1, m2;
+    std::lock_guard        held(m2);
+    bool                   called = false;
+    tla::lock_set_executor ex(1);
+    auto                   f = ex.submit(5ms, std::array{&m1, &m2}, [&] { called = true; });
+    EXPECT_FALSE(f.get());
+    EXPECT_FALSE(called);
+    EXPECT_TRUE(m1.try_lock());
+    m1.unlock();
+
+    auto g = ex.submit(std::chrono::system_clock::now() + 10s, std::array{&m1}, [&] { called = true; });
+    EXPECT_TRUE(g.get());
+    EXPECT_TRUE(called);
+}
+
+TEST(LockSetExecutor, ExceptionUnlocks) {
+    std::timed_mutex       m;
+    tla::lock_set_executor ex(1);
+    auto                   f = ex.submit(std::array{&m}, [] { throw std::runtime_error("task"); });
+    EXPECT_THROW(f.get(), std::runtime_error);
+    EXPECT_TRUE(m.try_lock());
+    m.unlock();
+}
+
+TEST(LockSetExecutor, WaitIdleAndDrain) {
+    std::timed_mutex m;
+    std::atomic<int> done = 0;
+    {
+        tla::lock_set_executor ex(2);
+        for (int i = 0; i != 50; ++i) {
+            static_cast<void>(ex.submit(std::array{&m}, [&] { ++done; }));
+        }
+        ex.wait_idle();
+        EXPECT_EQ(50, done);
+        for (int i = 0; i != 50; ++i) {
+            static_cast<void>(ex.submit(std::array{&m}, [&] { ++done; }));
+        }
+    }
+    EXPECT_EQ(100, done);
+}
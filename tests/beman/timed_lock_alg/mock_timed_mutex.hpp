@@ -48,6 +48,44 @@ struct MockTimedMutex {
     }
 };
 
+struct MockSharedTimedMutex : MockTimedMutex {
+    std::atomic<int> shared_owners{0};
+    std::atomic<int> lock_shared_count{0};
+    std::atomic<int> unlock_shared_count{0};
+    std::atomic<int> try_lock_shared_count{0};
+
+    void lock_shared() {
+        while (should_fail)
+            std::this_thread::yield();
+        ++lock_shared_count;
+        ++shared_owners;
+    }
+
+    bool try_lock_shared() {
+        ++try_lock_shared_count;
+        if (should_fail)
+            return false;
+        ++lock_shared_count;
+        ++shared_owners;
+        return true;
+    }
+
+    template <class Rep, class Period>
+    bool try_lock_shared_for(const std::chrono::duration<Rep, Period>&) {
+        return try_lock_shared();
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration>&) {
+        return try_lock_shared();
+    }
+
+    void unlock_shared() {
+        ++unlock_shared_count;
+        --shared_owners;
+    }
+};
+
 } // namespace beman::timed_lock_alg::test
 
 #endif // BEMAN_TIMED_LOCK_ALG_TESTS_MOCK_TIMED_MUTEX_HPP
@@ -5,13 +5,20 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
 #include <chrono>
 #include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace std::chrono_literals;
-namespace tla   = beman::timed_lock_alg;
-using MockMutex = beman::timed_lock_alg::test::MockTimedMutex;
+namespace tla         = beman::timed_lock_alg;
+using MockMutex       = beman::timed_lock_alg::test::MockTimedMutex;
+using MockSharedMutex = beman::timed_lock_alg::test::MockSharedTimedMutex;
 
 // ============================================================================
 // Mock Mutex Verification
@@ -110,6 +117,23 @@ TEST(MultiLock, TimedConstructorTimePoint) {
     EXPECT_EQ(1, m2.try_lock_count);
 }
 
+TEST(MultiLock, OrderedConstructorDuration) {
+    MockMutex       m1, m2;
+    tla::multi_lock lock(tla::ordered_lock, 100ms, m1, m2);
+    EXPECT_TRUE(lock.owns_lock());
+    EXPECT_EQ(1, m1.lock_count);
+    EXPECT_EQ(1, m2.lock_count);
+}
+
+TEST(MultiLock, OrderedConstructorTimePoint) {
+    MockMutex m1, m2;
+    m1.should_fail     = true;
+    auto            tp = std::chrono::steady_clock::now() + 100ms;
+    tla::multi_lock lock(tla::ordered_lock, tp, m1, m2);
+    EXPECT_FALSE(lock.owns_lock());
+    EXPECT_EQ(m2.lock_count, m2.unlock_count);
+}
+
 // ============================================================================
 // Move Semantics Tests
 // ============================================================================
@@ -239,6 +263,21 @@ TEST(MultiLock, TryLockUntilFailure) {
     EXPECT_FALSE(lock.owns_lock());
 }
 
+TEST(MultiLock, OrderedTryLockFor) {
+    MockMutex       m1, m2;
+    tla::multi_lock lock(std::defer_lock, m1, m2);
+    EXPECT_EQ(-1, lock.try_lock_for(tla::ordered_lock, 100ms));
+    EXPECT_TRUE(lock.owns_lock());
+}
+
+TEST(MultiLock, OrderedTryLockUntilFailure) {
+    MockMutex m1, m2;
+    m2.should_fail = true;
+    tla::multi_lock lock(std::defer_lock, m1, m2);
+    EXPECT_EQ(1, lock.try_lock_until(tla::ordered_lock, std::chrono::steady_clock::now()));
+    EXPECT_FALSE(lock.owns_lock());
+}
+
 TEST(MultiLock, UnlockSuccess) {
     MockMutex       m1, m2;
     tla::multi_lock lock(m1, m2);
@@ -348,6 +387,276 @@ TEST(MultiLock, MutexAccessor) {
     EXPECT_EQ(&m2, std::get<1>(mtxs));
 }
 
+// ============================================================================
+// Shared Ownership Tests
+// ============================================================================
+
+TEST(MultiSharedLock, DefaultConstructor) {
+    tla::multi_shared_lock<MockSharedMutex> lock;
+    EXPECT_FALSE(lock.owns_lock());
+}
+
+TEST(MultiSharedLock, ExplicitConstructorMultipleMutexes) {
+    MockSharedMutex m1, m2, m3;
+    {
+        tla::multi_shared_lock lock(m1, m2, m3);
+        EXPECT_TRUE(lock.owns_lock());
+        for (auto* m : {&m1, &m2, &m3}) {
+            EXPECT_EQ(1, m->shared_owners);
+            EXPECT_EQ(0, m->lock_count);
+        }
+    }
+    for (auto* m : {&m1, &m2, &m3}) {
+        EXPECT_EQ(0, m->shared_owners);
+    }
+}
+
+TEST(MultiSharedLock, TryToLockConstructorFailure) {
+    MockSharedMutex m1, m2;
+    m2.should_fail = true;
+    tla::multi_shared_lock lock(std::try_to_lock, m1, m2);
+    EXPECT_FALSE(lock.owns_lock());
+    EXPECT_EQ(0, m1.shared_owners);
+}
+
+TEST(MultiSharedLock, AdoptLockConstructor) {
+    MockSharedMutex m1, m2;
+    m1.lock_shared();
+    m2.lock_shared();
+    {
+        tla::multi_shared_lock lock(std::adopt_lock, m1, m2);
+        EXPECT_TRUE(lock.owns_lock());
+    }
+    EXPECT_EQ(1, m1.unlock_shared_count);
+    EXPECT_EQ(1, m2.unlock_shared_count);
+}
+
+TEST(MultiSharedLock, TimedConstructors) {
+    MockSharedMutex m1, m2;
+    {
+        tla::multi_shared_lock lock(10ms, m1, m2);
+        EXPECT_TRUE(lock.owns_lock());
+    }
+    {
+        tla::multi_shared_lock lock(std::chrono::steady_clock::now() + 10ms, tla::spin_backoff{}, m1, m2);
+        EXPECT_TRUE(lock.owns_lock());
+    }
+    m1.should_fail = true;
+    tla::multi_shared_lock lock(0ms, m1, m2);
+    EXPECT_FALSE(lock.owns_lock());
+    EXPECT_EQ(0, m2.shared_owners);
+}
+
+TEST(MultiSharedLock, LockingOperations) {
+    MockSharedMutex        m1, m2;
+    tla::multi_shared_lock lock(std::defer_lock, m1, m2);
+    lock.lock();
+    EXPECT_THROW(lock.lock(), std::system_error);
+    lock.unlock();
+    EXPECT_THROW(lock.unlock(), std::system_error);
+    EXPECT_EQ(-1, lock.try_lock());
+    lock.unlock();
+    EXPECT_EQ(-1, lock.try_lock_for(10ms));
+    lock.unlock();
+    m2.should_fail = true;
+    EXPECT_EQ(1, lock.try_lock_until(std::chrono::steady_clock::now()));
+    EXPECT_FALSE(lock.owns_lock());
+    EXPECT_EQ(0, m1.shared_owners);
+}
+
+TEST(MultiSharedLock, MoveAndRelease) {
+    MockSharedMutex        m1, m2;
+    tla::multi_shared_lock lock1(m1, m2);
+    tla::multi_shared_lock lock2(std::move(lock1));
+    EXPECT_FALSE(lock1.owns_lock());
+    EXPECT_TRUE(lock2.owns_lock());
+
+    auto mtxs = lock2.release();
+    EXPECT_FALSE(lock2.owns_lock());
+    EXPECT_EQ(&m1, std::get<0>(mtxs));
+    EXPECT_EQ(1, m1.shared_owners);
+    m1.unlock_shared();
+    m2.unlock_shared();
+}
+
+TEST(MultiLock, MixedSharedAndExclusive) {
+    MockMutex       m1;
+    MockSharedMutex s1;
+    {
+        tla::multi_lock lock(10ms, m1, tla::shared(s1));
+        EXPECT_TRUE(lock.owns_lock());
+        EXPECT_TRUE(m1.locked);
+        EXPECT_EQ(1, s1.shared_owners);
+        EXPECT_EQ(&s1, std::get<1>(lock.mutex()).get());
+
+        lock.unlock();
+        EXPECT_EQ(0, s1.shared_owners);
+        lock.lock();
+        EXPECT_EQ(1, s1.shared_owners);
+    }
+    EXPECT_FALSE(m1.locked);
+    EXPECT_EQ(0, s1.shared_owners);
+
+    s1.should_fail = true;
+    tla::multi_lock lock(std::try_to_lock, tla::shared(s1), m1);
+    EXPECT_FALSE(lock.owns_lock());
+    EXPECT_EQ(0, lock.try_lock_for(0ms, tla::yield_backoff{}));
+}
+
+// ============================================================================
+// Dynamic Lock Set Tests
+// ============================================================================
+
+TEST(DynamicMultiLock, DefaultConstructor) {
+    tla::dynamic_multi_lock<MockMutex> lock;
+    EXPECT_FALSE(lock);
+    EXPECT_EQ(0u, lock.size());
+    EXPECT_THROW(lock.lock(), std::system_error);
+    EXPECT_THROW(static_cast<void>(lock.try_lock_for(0ms)), std::system_error);
+    EXPECT_FALSE(lock.owns_lock());
+}
+
+TEST(DynamicMultiLock, EmptySet) {
+    std::vector<MockMutex*> set;
+    tla::dynamic_multi_lock lock(set);
+    EXPECT_TRUE(lock.owns_lock());
+    lock.unlock();
+    EXPECT_EQ(-1, lock.try_lock_until(std::chrono::steady_clock::now()));
+    EXPECT_TRUE(lock.owns_lock());
+
+    auto moved = std::move(lock);
+    moved.unlock();
+    EXPECT_THROW(static_cast<void>(lock.try_lock()), std::system_error);
+    EXPECT_EQ(-1, moved.try_lock());
+}
+
+TEST(DynamicMultiLock, LocksRangeOfPointers) {
+    MockMutex               m1, m2, m3;
+    std::vector<MockMutex*> set{&m1, &m2, &m3};
+    {
+        tla::dynamic_multi_lock lock(set);
+        static_assert(std::same_as<decltype(lock), tla::dynamic_multi_lock<MockMutex>>);
+        EXPECT_TRUE(lock.owns_lock());
+        ASSERT_EQ(3u, lock.size());
+        EXPECT_EQ(&m2, lock.mutex()[1]);
+        EXPECT_TRUE(m1.locked && m2.locked && m3.locked);
+    }
+    EXPECT_FALSE(m1.locked || m2.locked || m3.locked);
+}
+
+TEST(DynamicMultiLock, LargeSetsAllocate) {
+    std::array<MockMutex, 5>              ms;
+    tla::dynamic_multi_lock<MockMutex, 2> lock(std::defer_lock, ms);
+    EXPECT_FALSE(lock);
+    ASSERT_EQ(5u, lock.size());
+    EXPECT_EQ(-1, lock.try_lock_for(0ms));
+    for (std::size_t i = 0; i != ms.size(); ++i) {
+        EXPECT_EQ(&ms[i], lock.mutex()[i]);
+        EXPECT_TRUE(ms[i].locked);
+    }
+    auto moved = std::move(lock);
+    EXPECT_EQ(0u, lock.size());
+    EXPECT_TRUE(moved);
+    moved.unlock();
+    for (auto& m : ms) {
+        EXPECT_FALSE(m.locked);
+    }
+}
+
+TEST(DynamicMultiLock, TryToLockAndAdopt) {
+    std::array<MockMutex, 3> ms;
+    ms[1].should_fail = true;
+    {
+        tla::dynamic_multi_lock lock(std::try_to_lock, ms);
+        EXPECT_FALSE(lock);
+        EXPECT_FALSE(ms[0].locked);
+        EXPECT_EQ(1, lock.try_lock());
+        ms[1].should_fail = false;
+        EXPECT_EQ(-1, lock.try_lock());
+        EXPECT_THROW(lock.lock(), std::system_error);
+    }
+    EXPECT_FALSE(ms[0].locked || ms[1].locked || ms[2].locked);
+
+    ms[0].lock();
+    {
+        tla::dynamic_multi_lock lock(std::adopt_lock, std::span(ms).first(1));
+        EXPECT_TRUE(lock);
+    }
+    EXPECT_FALSE(ms[0].locked);
+}
+
+TEST(DynamicMultiLock, LockReleasesOnException) {
+    struct ThrowingMutex : MockMutex {
+        bool should_throw = false;
+        bool try_lock() {
+            if (should_throw) {
+                throw std::system_error(std::make_error_code(std::errc::resource_unavailable_try_again));
+            }
+            return MockMutex::try_lock();
+        }
+    };
+    std::array<ThrowingMutex, 3> ms;
+    ms[2].should_throw = true;
+    tla::dynamic_multi_lock lock(std::defer_lock, ms);
+    EXPECT_THROW(lock.lock(), std::system_error);
+    EXPECT_FALSE(lock);
+    for (auto& m : ms) {
+        EXPECT_FALSE(m.locked);
+        EXPECT_EQ(m.lock_count, m.unlock_count);
+    }
+}
+
+TEST(DynamicMultiLock, TimedConstructors) {
+    std::array<MockMutex, 3> ms;
+    ms[2].should_fail = true;
+    {
+        tla::dynamic_multi_lock lock(0ms, ms);
+        EXPECT_FALSE(lock);
+        tla::dynamic_multi_lock lock2(std::chrono::steady_clock::now(), tla::sleep_backoff{}, ms);
+        EXPECT_FALSE(lock2);
+        EXPECT_EQ(2, lock2.try_lock_for(0ms));
+    }
+    ms[2].should_fail = false;
+    {
+        tla::dynamic_multi_lock lock(std::chrono::steady_clock::now(), ms);
+        EXPECT_TRUE(lock);
+    }
+    {
+        tla::dynamic_multi_lock lock(tla::ordered_lock, 0ms, ms);
+        EXPECT_TRUE(lock);
+        EXPECT_TRUE(ms[0].locked && ms[1].locked && ms[2].locked);
+    }
+    EXPECT_FALSE(ms[0].locked || ms[1].locked || ms[2].locked);
+}
+
+TEST(DynamicMultiLock, ReleaseAndSwap) {
+    MockMutex                          m1, m2;
+    std::array<MockMutex*, 1>          set1{&m1};
+    std::array<MockMutex*, 1>          set2{&m2};
+    tla::dynamic_multi_lock<MockMutex> lock1(set1);
+    tla::dynamic_multi_lock<MockMutex> lock2(std::defer_lock, set2);
+    swap(lock1, lock2);
+    EXPECT_FALSE(lock1);
+    EXPECT_EQ(&m2, lock1.mutex()[0]);
+    EXPECT_TRUE(lock2);
+
+    const auto released = lock2.release();
+    EXPECT_FALSE(lock2);
+    ASSERT_EQ(1u, released.size());
+    EXPECT_EQ(&m1, released[0]);
+    EXPECT_TRUE(m1.locked);
+    m1.unlock();
+}
+
+namespace {
+template <class L>
+concept releasable = requires(L&& lock) { std::forward<L>(lock).release(); };
+} // namespace
+
+// the result of release() refers to the lock set of the lock, which a temporary doesn't outlive
+static_assert(releasable<tla::dynamic_multi_lock<MockMutex>&>);
+static_assert(not releasable<tla::dynamic_multi_lock<MockMutex>>);
+
 // ============================================================================
 // Integration Tests with Real Mutexes
 // ============================================================================
@@ -363,3 +672,62 @@ TEST(MultiLock, RealTimedMutexTryLockFor) {
     tla::multi_lock  lock(10ms, m1, m2);
     EXPECT_TRUE(lock.owns_lock());
 }
+
+TEST(MultiSharedLock, RealSharedTimedMutex) {
+    std::shared_timed_mutex m1, m2;
+    tla::multi_shared_lock  lock1(10ms, m1, m2);
+    tla::multi_shared_lock  lock2(10ms, m1, m2);
+    EXPECT_TRUE(lock1.owns_lock());
+    EXPECT_TRUE(lock2.owns_lock());
+    std::thread([&] { EXPECT_FALSE(m1.try_lock()); }).join();
+}
+
+TEST(DynamicMultiLock, RealMutexesInOppositeOrders) {
+    std::array<std::timed_mutex, 3>  ms;
+    std::array<std::timed_mutex*, 3> forward{&ms[0], &ms[1], &ms[2]};
+    std::array<std::timed_mutex*, 3> backward{&ms[2], &ms[1], &ms[0]};
+    int                              counter = 0;
+    auto                             worker  = [&](std::array<std::timed_mutex*, 3>& set, bool timed) {
+        for (int i = 0; i < 1000; ++i) {
+            tla::dynamic_multi_lock lock(std::defer_lock, set);
+            if (timed) {
+                ASSERT_EQ(-1, lock.try_lock_for(10s));
+            } else {
+                lock.lock();
+            }
+            ++counter;
+        }
+    };
+    std::thread th1(worker, std::ref(forward), false);
+    std::thread th2(worker, std::ref(backward), true);
+    th1.join();
+    th2.join();
+    EXPECT_EQ(2000, counter);
+}
+
+#if defined(__cpp_lib_jthread)
+TEST(MultiLock, StopTokenCancels) {
+    std::timed_mutex m1, m2;
+    std::stop_source ss;
+    {
+        tla::multi_lock lock(ss.get_token(), 10s, m1, m2);
+        EXPECT_TRUE(lock.owns_lock());
+    }
+
+    std::unique_lock held(m2);
+    std::thread      th([&] {
+        std::this_thread::sleep_for(10ms);
+        ss.request_stop();
+    });
+    {
+        tla::multi_lock lock(ss.get_token(), std::chrono::steady_clock::now() + 10s, m1, m2);
+        EXPECT_FALSE(lock.owns_lock());
+        EXPECT_TRUE(ss.stop_requested());
+        EXPECT_EQ(tla::lock_cancelled, lock.try_lock_for(ss.get_token(), 10s));
+        EXPECT_FALSE(lock.owns_lock());
+    }
+    th.join();
+    EXPECT_TRUE(m1.try_lock());
+    m1.unlock();
+}
+#endif
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/mutex.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#if defined(__cpp_lib_jthread)
+#include <stop_token>
+#endif
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+
+static_assert(noexcept(std::declval<tla::nothrow_multi_lock<std::timed_mutex>&>().unlock()));
+
+TEST(NothrowMultiLock, LocksAndUnlocks) {
+    std::timed_mutex        m1, m2;
+    tla::nothrow_multi_lock lock(m1, m2);
+    ASSERT_TRUE(lock);
+    std::thread([&] { EXPECT_FALSE(m2.try_lock()); }).join();
+    EXPECT_TRUE(lock.unlock());
+    EXPECT_FALSE(lock.owns_lock());
+    std::thread([&] {
+        EXPECT_TRUE(m1.try_lock());
+        m1.unlock();
+    }).join();
+    EXPECT_TRUE(lock.lock());
+    EXPECT_TRUE(lock.owns_lock());
+}
+
+TEST(NothrowMultiLock, MisuseIsReported) {
+    std::timed_mutex        m1, m2;
+    tla::nothrow_multi_lock lock(std::defer_lock, m1, m2);
+
+    auto rv = lock.unlock();
+    ASSERT_FALSE(rv);
+    EXPECT_EQ(std::errc::operation_not_permitted, rv.error());
+
+    ASSERT_TRUE(lock.try_lock());
+    rv = lock.lock();
+    ASSERT_FALSE(rv);
+    EXPECT_EQ(std::errc::resource_deadlock_would_occur, rv.error());
+    rv = lock.try_lock_for(1ms);
+    ASSERT_FALSE(rv);
+    EXPECT_EQ(std::errc::resource_deadlock_would_occur, rv.error());
+    EXPECT_TRUE(lock.owns_lock());
+
+    tla::nothrow_multi_lock<std::timed_mutex, std::timed_mutex> empty;
+    rv = empty.try_lock_until(std::chrono::system_clock::now() + 1ms);
+    ASSERT_FALSE(rv);
+    EXPECT_EQ(std::errc::operation_not_permitted, rv.error());
+}
+
+TEST(NothrowMultiLock, FailuresAreReported) {
+    std::timed_mutex m1, m2;
+    std::unique_lock held(m2);
+    std::thread([&] {
+        tla::nothrow_multi_lock lock(std::defer_lock, m1, m2);
+        auto                    rv = lock.try_lock();
+        ASSERT_FALSE(rv);
+        EXPECT_EQ(std::errc::device_or_resource_busy, rv.error());
+        rv = lock.try_lock_for(1ms);
+        ASSERT_FALSE(rv);
+        EXPECT_EQ(std::errc::timed_out, rv.error());
+        EXPECT_FALSE(lock.owns_lock());
+
+        tla::nothrow_multi_lock timed(1ms, m1, m2);
+        EXPECT_FALSE(timed);
+        EXPECT_TRUE(m1.try_lock());
+        m1.unlock();
+    }).join();
+}
+
+#if defined(__cpp_lib_jthread)
+TEST(NothrowMultiLock, StopIsReported) {
+    std::timed_mutex m1, m2;
+    std::unique_lock held(m1);
+    std::stop_source ss;
+    ss.request_stop();
+    std::thread([&] {
+        tla::nothrow_multi_lock lock(std::defer_lock, m1, m2);
+        auto                    rv = lock.try_lock_for(ss.get_token(), 10s);
+        ASSERT_FALSE(rv);
+        EXPECT_EQ(std::errc::operation_canceled, rv.error());
+        rv = lock.try_lock_for(std::stop_token{}, 1ms);
+        ASSERT_FALSE(rv);
+        EXPECT_EQ(std::errc::timed_out, rv.error());
+    }).join();
+}
+#endif
+
+TEST(NothrowMultiLock, Modifiers) {
+    std::timed_mutex        m1, m2;
+    tla::nothrow_multi_lock a(m1, m2);
+    tla::nothrow_multi_lock b(std::defer_lock, m1, m2);
+    swap(a, b);
+    EXPECT_FALSE(a);
+    EXPECT_TRUE(b);
+
+    tla::nothrow_multi_lock c(std::move(b));
+    EXPECT_FALSE(b.owns_lock());
+    EXPECT_TRUE(c.owns_lock());
+    EXPECT_EQ(&m2, std::get<1>(c.mutex()));
+
+    const auto ms = c.release();
+    EXPECT_FALSE(c);
+    std::get<0>(ms)->unlock();
+    std::get<1>(ms)->unlock();
+    tla::nothrow_multi_lock relocked(std::try_to_lock, m1, m2);
+    EXPECT_TRUE(relocked);
+}
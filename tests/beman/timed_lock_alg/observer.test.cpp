@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/mutex.hpp>
+#include <beman/timed_lock_alg/observer.hpp>
+#include "mock_timed_mutex.hpp"
+#include "jthread.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla   = beman::timed_lock_alg;
+using MockMutex = beman::timed_lock_alg::test::MockTimedMutex;
+using JThread   = beman::timed_lock_alg::test::JThread;
+
+namespace {
+// lets a failing MockMutex succeed in the round after the first failed round
+struct flaky_backoff {
+    MockMutex* mtx;
+
+    template <class Timepoint>
+    void operator()(const Timepoint&) const {
+        mtx->should_fail = false;
+    }
+};
+
+// records the events of the calls in order
+struct recording_observer {
+    std::vector<std::string> events;
+
+    void on_blocked(std::size_t idx, std::chrono::steady_clock::duration) {
+        events.push_back("blocked " + std::to_string(idx));
+    }
+    void on_failed(std::size_t idx) { events.push_back("failed " + std::to_string(idx)); }
+    void on_backoff() { events.push_back("backoff"); }
+    void on_finished(int rv, std::size_t rounds) {
+        events.push_back("finished " + std::to_string(rv) + " " + std::to_string(rounds));
+    }
+};
+
+// a contention history with fixed scores
+struct fixed_history {
+    std::vector<std::uint32_t> scores;
+
+    void          on_blocked(std::size_t, std::chrono::steady_clock::duration) {}
+    void          on_failed(std::size_t) {}
+    void          on_backoff() {}
+    void          on_finished(int, std::size_t) {}
+    std::uint32_t hotness(std::size_t idx) const { return idx < scores.size() ? scores[idx] : 0; }
+};
+
+// a MockMutex logging its id when someone tries to lock it
+struct LoggingMutex : MockMutex {
+    std::vector<int>* log = nullptr;
+    int               id  = 0;
+
+    bool try_lock() {
+        log->push_back(id);
+        return MockMutex::try_lock();
+    }
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>&) {
+        return try_lock();
+    }
+};
+
+void attach_log(std::span<LoggingMutex> mtxs, std::vector<int>& log) {
+    for (std::size_t i = 0; i < mtxs.size(); ++i) {
+        mtxs[i].log = &log;
+        mtxs[i].id  = static_cast<int>(i);
+    }
+}
+} // namespace
+
+TEST(Observer, Uncontended) {
+    tla::contention_counters<> counters;
+    MockMutex                  m1, m2, m3;
+    EXPECT_EQ(-1, tla::try_lock_for(10ms, tla::observe(counters), m1, m2, m3));
+    std::scoped_lock sl(std::adopt_lock, m1, m2, m3);
+
+    EXPECT_EQ(counters.calls(), 1u);
+    EXPECT_EQ(counters.timeouts(), 0u);
+    EXPECT_EQ(counters.rounds(), 1u);
+    EXPECT_EQ(counters.backoffs(), 0u);
+    for (std::size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(counters.failures(i), 0u);
+    }
+}
+
+TEST(Observer, ReportsFailingIndexOnTimeout) {
+    tla::contention_counters<> counters;
+    MockMutex                  m1, m2, m3;
+    m2.should_fail = true;
+    EXPECT_EQ(1, tla::try_lock_for(0ms, tla::observe(counters), m1, m2, m3));
+
+    EXPECT_EQ(counters.calls(), 1u);
+    EXPECT_EQ(counters.timeouts(), 1u);
+    EXPECT_EQ(counters.rounds(), 2u);
+    EXPECT_EQ(counters.backoffs(), 1u);
+    EXPECT_EQ(counters.failures(0), 0u);
+    EXPECT_EQ(counters.failures(1), 2u);
+    EXPECT_EQ(counters.failures(2), 0u);
+}
+
+TEST(Observer, EventsInOrder) {
+    recording_observer observer;
+    MockMutex          m1, m2, m3;
+    m3.should_fail = true;
+    EXPECT_EQ(-1, tla::try_lock_for(10ms, tla::observe(observer, flaky_backoff{&m3}), m1, m2, m3));
+    std::scoped_lock sl(std::adopt_lock, m1, m2, m3);
+
+    const std::vector<std::string> expected{"blocked 0", "failed 2", "backoff", "blocked 2", "finished -1 2"};
+    EXPECT_EQ(observer.events, expected);
+}
+
+TEST(Observer, ZeroAndOneLockable) {
+    recording_observer observer;
+    MockMutex          m1;
+    EXPECT_EQ(-1, tla::try_lock_for(10ms, tla::observe(observer)));
+    EXPECT_EQ(-1, tla::try_lock_for(10ms, tla::observe(observer), m1));
+    m1.unlock();
+    m1.should_fail = true;
+    EXPECT_EQ(0, tla::try_lock_for(10ms, tla::observe(observer), std::span(&m1, 1)));
+
+    const std::vector<std::string> expected{
+        "finished -1 0", "blocked 0", "finished -1 1", "blocked 0", "failed 0", "finished 0 1"};
+    EXPECT_EQ(observer.events, expected);
+}
+
+TEST(Observer, BlockedTime) {
+    tla::contention_counters<> counters;
+    std::timed_mutex           m1, m2;
+    m2.lock();
+    JThread th([&] {
+        std::this_thread::sleep_for(20ms);
+        m2.unlock();
+    });
+    ASSERT_EQ(-1, tla::try_lock_for(10s, tla::observe(counters), m1, m2));
+    std::scoped_lock sl(std::adopt_lock, m1, m2);
+
+    EXPECT_GE(counters.blocked_time(), 10ms);
+    EXPECT_EQ(counters.calls(), 1u);
+    EXPECT_EQ(counters.timeouts(), 0u);
+}
+
+TEST(Observer, SharedBetweenCallsAndReset) {
+    tla::contention_counters<2> counters;
+    std::array<MockMutex, 4>    mtxs;
+    mtxs[3].should_fail = true;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(3, tla::try_lock_for(0ms, tla::observe(counters), mtxs));
+    }
+    EXPECT_EQ(counters.calls(), 3u);
+    EXPECT_EQ(counters.timeouts(), 3u);
+    EXPECT_EQ(counters.failures(3), 0u); // not counted beyond MaxLockables
+
+    counters.reset();
+    EXPECT_EQ(counters.calls(), 0u);
+    EXPECT_EQ(counters.rounds(), 0u);
+}
+
+TEST(Observer, MultiLock) {
+    tla::contention_counters<> counters;
+    MockMutex                  m1, m2;
+    {
+        tla::multi_lock lock(10ms, tla::observe(counters), m1, m2);
+        EXPECT_TRUE(lock);
+        lock.unlock();
+        EXPECT_EQ(-1, lock.try_lock_for(10ms, tla::observe(counters)));
+    }
+    EXPECT_EQ(counters.calls(), 2u);
+    EXPECT_EQ(counters.rounds(), 2u);
+}
+
+TEST(ContentionHistory, BlocksOnHottestFirst) {
+    std::vector<int>            log;
+    std::array<LoggingMutex, 4> mtxs;
+    attach_log(mtxs, log);
+    fixed_history history{{0, 0, 0, 5}};
+    EXPECT_EQ(-1, tla::try_lock_for(10ms, tla::observe(history), mtxs[0], mtxs[1], mtxs[2], mtxs[3]));
+    std::scoped_lock sl(std::adopt_lock, mtxs[0], mtxs[1], mtxs[2], mtxs[3]);
+    EXPECT_EQ((std::vector<int>{3, 0, 1, 2}), log);
+}
+
+TEST(ContentionHistory, ProbesHotBeforeCold) {
+    std::vector<int>            log;
+    std::array<LoggingMutex, 4> mtxs;
+    attach_log(mtxs, log);
+    fixed_history history{{0, 3, 0, 5}};
+    mtxs[1].should_fail = true;
+    EXPECT_EQ(-1, tla::try_lock_for(10ms, tla::observe(history, flaky_backoff{&mtxs[1]}), mtxs));
+    std::scoped_lock sl(std::adopt_lock, mtxs[0], mtxs[1], mtxs[2], mtxs[3]);
+    // the first round fails on 1 without touching the cold ones, the second one restarts with 1
+    EXPECT_EQ((std::vector<int>{3, 1, 1, 3, 2, 0}), log);
+    EXPECT_EQ(mtxs[3].unlock_count, 1);
+    EXPECT_EQ(mtxs[0].unlock_count, 0);
+}
+
+TEST(ContentionHistory, LearnsFromFailures) {
+    tla::contention_history<> history;
+    std::array<MockMutex, 3>  mtxs;
+    mtxs[2].should_fail = true;
+    EXPECT_EQ(2, tla::try_lock_for(0ms, tla::observe(history), mtxs));
+    EXPECT_EQ(history.hotness(0), 0u);
+    EXPECT_EQ(history.hotness(1), 0u);
+    EXPECT_GT(history.hotness(2), 0u);
+
+    // the next call starts with the hot one and times out without locking the others
+    mtxs[0].lock_count = 0;
+    mtxs[1].lock_count = 0;
+    EXPECT_EQ(2, tla::try_lock_for(0ms, tla::observe(history), mtxs));
+    EXPECT_EQ(mtxs[0].lock_count, 0);
+    EXPECT_EQ(mtxs[1].lock_count, 0);
+
+    mtxs[2].should_fail = false;
+    EXPECT_EQ(-1, tla::try_lock_for(0ms, tla::observe(history), mtxs));
+    std::scoped_lock sl(std::adopt_lock, mtxs[0], mtxs[1], mtxs[2]);
+}
+
+TEST(ContentionHistory, Decays) {
+    tla::contention_history<4, 2> history;
+    MockMutex                     m1, m2;
+    m2.should_fail = true;
+    EXPECT_EQ(1, tla::try_lock_for(0ms, tla::observe(history), m1, m2));
+    const auto score = history.hotness(1);
+    EXPECT_GT(score, 0u);
+    m2.should_fail = false;
+    EXPECT_EQ(-1, tla::try_lock_for(0ms, tla::observe(history), m1, m2));
+    std::scoped_lock sl(std::adopt_lock, m1, m2);
+    EXPECT_EQ(history.hotness(1), score / 2);
+
+    history.reset();
+    EXPECT_EQ(history.hotness(1), 0u);
+}
+
+TEST(ContentionHistory, ManyThreadsWithHotLockable) {
+    tla::contention_history<>       history;
+    std::array<std::timed_mutex, 6> mtxs;
+    int                             counter = 0;
+    {
+        std::vector<std::thread> ths;
+        for (std::size_t t = 0; t < 4; ++t) {
+            ths.emplace_back([&, t] {
+                for (int i = 0; i < 500; ++i) {
+                    // everyone needs mtxs[5]
+                    auto& other = mtxs[(t + static_cast<std::size_t>(i)) % 5];
+                    ASSERT_EQ(-1, tla::try_lock_for(10s, tla::observe(history), other, mtxs[5]));
+                    std::scoped_lock sl(std::adopt_lock, other, mtxs[5]);
+                    ++counter;
+                }
+            });
+        }
+        for (auto& th : ths) {
+            th.join();
+        }
+    }
+    EXPECT_EQ(counter, 2000);
+}
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/sharded_shared_timed_mutex.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+
+static_assert(tla::detail::TimedLockable<tla::sharded_shared_timed_mutex>);
+static_assert(tla::detail::SharedTimedLockable<tla::sharded_shared_timed_mutex>);
+
+TEST(ShardedSharedTimedMutex, Slots) {
+    EXPECT_EQ(1u, tla::sharded_shared_timed_mutex(0).reader_slots());
+    EXPECT_EQ(8u, tla::sharded_shared_timed_mutex(5).reader_slots());
+    const auto slots = tla::sharded_shared_timed_mutex().reader_slots();
+    EXPECT_GE(slots, 1u);
+    EXPECT_LE(slots, 256u);
+}
+
+TEST(ShardedSharedTimedMutex, ExclusiveExcludesAll) {
+    tla::sharded_shared_timed_mutex mtx;
+    mtx.lock();
+    std::thread([&] {
+        EXPECT_FALSE(mtx.try_lock());
+        EXPECT_FALSE(mtx.try_lock_shared());
+        EXPECT_FALSE(mtx.try_lock_for(1ms));
+        EXPECT_FALSE(mtx.try_lock_shared_until(std::chrono::system_clock::now() + 1ms));
+    }).join();
+    mtx.unlock();
+    EXPECT_TRUE(mtx.try_lock_shared());
+    mtx.unlock_shared();
+}
+
+TEST(ShardedSharedTimedMutex, ReadersShare) {
+    tla::sharded_shared_timed_mutex mtx(4);
+    std::shared_lock                lock(mtx);
+    std::vector<std::thread>        ths;
+    for (int t = 0; t < 8; ++t) {
+        ths.emplace_back([&] {
+            std::shared_lock other(mtx, 10s);
+            EXPECT_TRUE(other.owns_lock());
+            EXPECT_FALSE(mtx.try_lock());
+        });
+    }
+    for (auto& th : ths) {
+        th.join();
+    }
+}
+
+TEST(ShardedSharedTimedMutex, WriterTimesOutDrainingReaders) {
+    tla::sharded_shared_timed_mutex mtx;
+    std::atomic<bool>               reading = false;
+    std::atomic<bool>               done    = false;
+    std::thread                     reader([&] {
+        std::shared_lock lock(mtx);
+        reading = true;
+        while (not done) {
+            std::this_thread::yield();
+        }
+    });
+    while (not reading) {
+        std::this_thread::yield();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(mtx.try_lock_for(10ms));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 10ms);
+    // readers are let in again once the writer gave up
+    EXPECT_TRUE(mtx.try_lock_shared_for(10s));
+    mtx.unlock_shared();
+    done = true;
+    reader.join();
+}
+
+TEST(ShardedSharedTimedMutex, WriterWaitsForReaders) {
+    tla::sharded_shared_timed_mutex mtx;
+    mtx.lock_shared();
+    std::thread writer([&] {
+        EXPECT_TRUE(mtx.try_lock_for(10s));
+        mtx.unlock();
+    });
+    std::this_thread::sleep_for(10ms);
+    mtx.unlock_shared();
+    writer.join();
+}
+
+TEST(ShardedSharedTimedMutex, ReadersWaitForWriter) {
+    tla::sharded_shared_timed_mutex mtx;
+    mtx.lock();
+    std::vector<std::thread> ths;
+    for (int t = 0; t < 4; ++t) {
+        ths.emplace_back([&] {
+            mtx.lock_shared();
+            mtx.unlock_shared();
+        });
+    }
+    std::this_thread::sleep_for(10ms);
+    mtx.unlock();
+    for (auto& th : ths) {
+        th.join();
+    }
+}
+
+TEST(ShardedSharedTimedMutex, WithAlgorithms) {
+    tla::sharded_shared_timed_mutex a, b;
+    std::timed_mutex                c;
+    {
+        tla::multi_lock lock(10ms, a, b, c);
+        ASSERT_TRUE(lock);
+        std::thread([&] { EXPECT_FALSE(a.try_lock_shared()); }).join();
+    }
+    ASSERT_EQ(-1, tla::try_lock_for(10ms, c, b, a));
+    a.unlock();
+    b.unlock();
+    c.unlock();
+    {
+        tla::multi_shared_lock lock(10ms, a, b);
+        ASSERT_TRUE(lock);
+        EXPECT_TRUE(a.try_lock_shared());
+        a.unlock_shared();
+    }
+    tla::multi_lock lock(10ms, tla::shared(a), b);
+    ASSERT_TRUE(lock);
+}
+
+TEST(ShardedSharedTimedMutex, ReadersSeeConsistentWrites) {
+    tla::sharded_shared_timed_mutex mtx;
+    int                             x = 0, y = 0;
+    std::atomic<bool>               stop = false;
+    std::vector<std::thread>        ths;
+    for (int t = 0; t < 6; ++t) {
+        ths.emplace_back([&, t] {
+            for (int i = 0; not stop; ++i) {
+                if (t < 2 && i % 16 == 0) {
+                    std::unique_lock lock(mtx, 10s);
+                    ASSERT_TRUE(lock.owns_lock());
+                    ++x;
+                    ++y;
+                } else {
+                    std::shared_lock lock(mtx);
+                    ASSERT_EQ(x, y);
+                }
+            }
+        });
+    }
+    std::this_thread::sleep_for(100ms);
+    stop = true;
+    for (auto& th : ths) {
+        th.join();
+    }
+    EXPECT_GT(x, 0);
+}
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/striped_lock_table.hpp>
+#include "mock_timed_mutex.hpp"
+#include "jthread.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+namespace tla   = beman::timed_lock_alg;
+using MockMutex = beman::timed_lock_alg::test::MockTimedMutex;
+using JThread   = beman::timed_lock_alg::test::JThread;
+
+namespace {
+// hashes every key onto the same stripe
+struct colliding_hash {
+    template <class K>
+    std::size_t operator()(const K&) const noexcept {
+        return 0;
+    }
+};
+
+// two keys hashing to different stripes of table
+template <class Table>
+std::array<int, 2> distinct_keys(const Table& table) {
+    int other = 1;
+    while (table.stripe_of(other) == table.stripe_of(0)) {
+        ++other;
+    }
+    return {0, other};
+}
+} // namespace
+
+TEST(StripedLockTable, StripesArePadded) {
+    tla::striped_lock_table<std::timed_mutex, 4> table;
+    EXPECT_GE(reinterpret_cast<std::uintptr_t>(&table.stripe(1)) - reinterpret_cast<std::uintptr_t>(&table.stripe(0)),
+              tla::stripe_alignment);
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(&table.stripe(0)) % tla::stripe_alignment);
+}
+
+TEST(StripedLockTable, KeysSpreadOverStripes) {
+    tla::striped_lock_table<std::timed_mutex, 16> table;
+    std::array<int, 16>                           hits{};
+    for (int key = 0; key < 1600; ++key) {
+        const auto idx = table.stripe_of(key);
+        ASSERT_LT(idx, table.size());
+        ++hits[idx];
+    }
+    for (int count : hits) {
+        EXPECT_GT(count, 50);
+    }
+    EXPECT_EQ(table.stripe_of(std::string("key")), table.stripe_of(std::string("key")));
+}
+
+TEST(StripedLockTable, LocksStripesOfAllKeys) {
+    tla::striped_lock_table<MockMutex, 8> table;
+    const auto                            keys = distinct_keys(table);
+    {
+        auto lock = table.lock_keys_for(0ms, keys[0], keys[1]);
+        ASSERT_TRUE(lock);
+        EXPECT_EQ(2u, lock.mutex().size());
+        EXPECT_TRUE(table.stripe_for(keys[0]).locked);
+        EXPECT_TRUE(table.stripe_for(keys[1]).locked);
+    }
+    EXPECT_FALSE(table.stripe_for(keys[0]).locked);
+    EXPECT_FALSE(table.stripe_for(keys[1]).locked);
+}
+
+TEST(StripedLockTable, CollidingKeysLockTheStripeOnce) {
+    tla::striped_lock_table<std::timed_mutex, 8, colliding_hash> table;
+    {
+        auto lock = table.lock_keys_for(0ms, 1, 2, std::string("three"));
+        ASSERT_TRUE(lock.owns_lock());
+        ASSERT_EQ(1u, lock.mutex().size());
+        EXPECT_EQ(&table.stripe(0), lock.mutex()[0]);
+    }
+    EXPECT_TRUE(table.stripe(0).try_lock());
+    table.stripe(0).unlock();
+}
+
+TEST(StripedLockTable, TimeoutOwnsNothing) {
+    tla::striped_lock_table<MockMutex, 8> table;
+    const auto                            keys = distinct_keys(table);
+    table.stripe_for(keys[1]).should_fail      = true;
+
+    auto lock = table.lock_keys_until(std::chrono::steady_clock::now(), tla::sleep_backoff{}, keys[0], keys[1]);
+    EXPECT_FALSE(lock);
+    EXPECT_TRUE(lock.mutex().empty());
+    EXPECT_THROW(lock.unlock(), std::system_error);
+    EXPECT_EQ(table.stripe_for(keys[0]).lock_count, table.stripe_for(keys[0]).unlock_count);
+}
+
+TEST(StripedLockTable, ZeroKeys) {
+    tla::striped_lock_table<MockMutex, 8> table;
+    auto                                  lock = table.lock_keys_for(0ms);
+    EXPECT_TRUE(lock);
+}
+
+TEST(StripedLockTable, MoveAndRelease) {
+    tla::striped_lock_table<MockMutex, 8> table;
+    auto                                  lock  = table.lock_keys_for(0ms, 42);
+    auto                                  moved = std::move(lock);
+    EXPECT_FALSE(lock);
+    ASSERT_TRUE(moved);
+    const auto released = moved.release();
+    EXPECT_FALSE(moved);
+    ASSERT_EQ(1u, released.size());
+    EXPECT_TRUE(released[0]->locked);
+    released[0]->unlock();
+}
+
+namespace {
+template <class L>
+concept releasable = requires(L&& lock) { std::forward<L>(lock).release(); };
+} // namespace
+
+// the result of release() refers to the stripes stored in the lock, which a temporary doesn't outlive
+static_assert(releasable<tla::stripe_lock<MockMutex, 4>&>);
+static_assert(not releasable<tla::stripe_lock<MockMutex, 4>>);
+
+TEST(StripedLockTableIntegration, TransfersBetweenKeys) {
+    tla::striped_lock_table<std::timed_mutex, 4> table;
+    std::vector<int>                             balances(32, 100);
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 2000; ++i) {
+                    const auto from = static_cast<std::size_t>((i * 7 + t) % 32);
+                    const auto to   = static_cast<std::size_t>((i * 13 + t * 5 + 1) % 32);
+                    auto       lock = table.lock_keys_for(10s, from, to);
+                    ASSERT_TRUE(lock);
+                    --balances[from];
+                    ++balances[to];
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+    int total = 0;
+    for (int balance : balances) {
+        total += balance;
+    }
+    EXPECT_EQ(3200, total);
+}
+
+TEST(StripedLockTableIntegration, WaitsForHeldStripe) {
+    tla::striped_lock_table<std::timed_mutex, 4> table;
+    std::unique_lock                             held(table.stripe_for(7));
+    std::atomic<bool>                            timed_out = false;
+    JThread                                      th([&] {
+        EXPECT_FALSE(table.lock_keys_for(10ms, 7, 8));
+        timed_out = true;
+        auto lock = table.lock_keys_for(10s, 8, 7);
+        EXPECT_TRUE(lock);
+    });
+    while (not timed_out) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(10ms);
+    held.unlock();
+}
+
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_FUTEX_TIMED_MUTEX)
+TEST(StripedLockTable, FutexStripes) {
+    tla::striped_lock_table<tla::futex_timed_mutex, 8> table;
+    const auto                                         keys = distinct_keys(table);
+    auto                                               lock = table.lock_keys_for(10ms, keys[0], keys[1], keys[0]);
+    ASSERT_TRUE(lock);
+    EXPECT_EQ(2u, lock.mutex().size());
+    EXPECT_FALSE(table.stripe_for(keys[1]).try_lock());
+}
+#endif
@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: MIT
+
+#include <beman/timed_lock_alg/mutex.hpp>
+#include <beman/timed_lock_alg/trace.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace std::chrono_literals;
+namespace tla = beman::timed_lock_alg;
+
+static_assert(tla::detail::tracing, "the trace tests are built with the trace points enabled");
+
+namespace {
+class Trace : public ::testing::Test {
+  protected:
+    void SetUp() override { tla::start_lock_trace(); }
+    void TearDown() override { tla::stop_lock_trace(); }
+
+    static std::string json() {
+        std::ostringstream os;
+        tla::write_chrome_trace(os);
+        return os.str();
+    }
+};
+
+std::size_t occurrences(std::string_view text, std::string_view what) {
+    std::size_t count = 0;
+    for (auto pos = text.find(what); pos != std::string_view::npos; pos = text.find(what, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+bool contains(std::string_view text, std::string_view what) { return text.find(what) != std::string_view::npos; }
+} // namespace
+
+TEST_F(Trace, NothingRecorded) {
+    tla::stop_lock_trace();
+    std::timed_mutex m1, m2;
+    {
+        tla::multi_lock lock(10ms, m1, m2);
+    }
+    const auto trace = json();
+    EXPECT_TRUE(trace.starts_with(R"({"displayTimeUnit":"ns","traceEvents":[)"));
+    EXPECT_TRUE(trace.ends_with("]}\n"));
+    EXPECT_EQ(0u, occurrences(trace, R"("ph")"));
+}
+
+TEST_F(Trace, ContendedWait) {
+    std::timed_mutex  m1, m2;
+    std::atomic<bool> holding = false;
+    std::thread       holder([&] {
+        std::lock_guard lock(m2);
+        holding = true;
+        std::this_thread::sleep_for(20ms);
+    });
+    while (not holding) {
+        std::this_thread::yield();
+    }
+    {
+        tla::multi_lock lock(std::defer_lock, m1, m2);
+        ASSERT_EQ(-1, lock.try_lock_for(10s));
+    }
+    holder.join();
+    tla::stop_lock_trace();
+
+    const auto trace = json();
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"lock wait","cat":"lock","ph":"B")"));
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"lock wait","cat":"lock","ph":"E")"));
+    EXPECT_TRUE(contains(trace, R"("args":{"rounds":2})"));
+    EXPECT_TRUE(contains(trace, R"({"name":"failed","cat":"lock","ph":"i")"));
+    EXPECT_TRUE(contains(trace, R"("args":{"index":1})"));
+    EXPECT_EQ(2u, occurrences(trace, R"({"name":"round")"));
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"hold","cat":"lock","ph":"b")"));
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"hold","cat":"lock","ph":"e")"));
+}
+
+#if defined(BEMAN_TIMED_LOCK_ALG_HAS_FUTEX_TIMED_MUTEX)
+TEST_F(Trace, FutexPack) {
+    tla::futex_timed_mutex m1, m2;
+    std::atomic<bool>      holding = false;
+    std::thread            holder([&] {
+        std::lock_guard lock(m2);
+        holding = true;
+        std::this_thread::sleep_for(20ms);
+    });
+    while (not holding) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(-1, tla::try_lock_for(10s, m1, m2));
+    m1.unlock();
+    m2.unlock();
+    holder.join();
+    tla::stop_lock_trace();
+
+    const auto trace = json();
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"lock wait","cat":"lock","ph":"B")"));
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"lock wait","cat":"lock","ph":"E")"));
+    EXPECT_TRUE(contains(trace, R"({"name":"failed","cat":"lock","ph":"i")"));
+    EXPECT_TRUE(contains(trace, R"({"name":"block","cat":"lock","ph":"i")"));
+    EXPECT_TRUE(contains(trace, R"("args":{"index":1})"));
+    EXPECT_LE(2u, occurrences(trace, R"({"name":"round")"));
+}
+#endif
+
+TEST_F(Trace, Ordered) {
+    std::timed_mutex m1, m2;
+    ASSERT_EQ(-1, tla::try_lock_for(tla::ordered_lock, 10ms, m1, m2));
+    m1.unlock();
+    m2.unlock();
+    tla::stop_lock_trace();
+
+    const auto trace = json();
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"lock wait","cat":"lock","ph":"B")"));
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"lock wait","cat":"lock","ph":"E")"));
+    EXPECT_TRUE(contains(trace, R"("args":{"rounds":1})"));
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"round")"));
+    EXPECT_EQ(2u, occurrences(trace, R"({"name":"block")"));
+}
+
+TEST_F(Trace, Timeout) {
+    std::timed_mutex m1, m2;
+    std::lock_guard  held(m2);
+    std::thread([&] {
+        tla::multi_lock lock(std::defer_lock, m1, m2);
+        EXPECT_EQ(1, lock.try_lock_for(5ms));
+    }).join();
+    tla::stop_lock_trace();
+
+    const auto trace = json();
+    EXPECT_TRUE(contains(trace, R"("args":{"timeout":1})"));
+    EXPECT_EQ(0u, occurrences(trace, R"({"name":"hold")"));
+}
+
+TEST_F(Trace, DynamicMultiLock) {
+    std::timed_mutex                 m1, m2;
+    std::array<std::timed_mutex*, 2> set{&m1, &m2};
+    {
+        tla::dynamic_multi_lock lock(10ms, set);
+        ASSERT_TRUE(lock.owns_lock());
+    }
+    tla::stop_lock_trace();
+
+    const auto trace = json();
+    EXPECT_TRUE(contains(trace, R"("args":{"count":2,)"));
+    EXPECT_EQ(1u, occurrences(trace, R"({"name":"hold","cat":"lock","ph":"e")"));
+}
+
+TEST_F(Trace, Release) {
+    std::timed_mutex                 m1, m2;
+    std::array<std::timed_mutex*, 2> set{&m1, &m2};
+    {
+        tla::multi_lock lock(10ms, m1, m2);
+        static_cast<void>(lock.release());
+        m1.unlock();
+        m2.unlock();
+    }
+    {
+        tla::dynamic_multi_lock lock(10ms, set);
+        static_cast<void>(lock.release());
+        m1.unlock();
+        m2.unlock();
+    }
+    tla::stop_lock_trace();
+
+    const auto trace = json();
+    EXPECT_EQ(2u, occurrences(trace, R"({"name":"hold","cat":"lock","ph":"b")"));
+    EXPECT_EQ(2u, occurrences(trace, R"({"name":"hold","cat":"lock","ph":"e")"));
+    EXPECT_EQ(2u, occurrences(trace, R"("args":{"released":2})"));
+}
+
+TEST_F(Trace, RingKeepsLatest) {
+    std::timed_mutex m1, m2;
+    // each call records round_start, block, acquired, held and unlock
+    const std::size_t calls = tla::lock_trace_capacity / 5 + 100;
+    for (std::size_t i = 0; i != calls; ++i) {
+        tla::multi_lock lock(10ms, m1, m2);
+    }
+    tla::stop_lock_trace();
+    {
+        tla::multi_lock lock(10ms, m1, m2);
+    }
+
+    const auto trace = json();
+    EXPECT_EQ(tla::lock_trace_capacity, occurrences(trace, R"("ph":")") - occurrences(trace, R"("ph":"B")"));
+}
@@ -2,35 +2,92 @@
 
 #include <beman/timed_lock_alg/mutex.hpp>
 #include "mock_timed_mutex.hpp"
+#include "jthread.hpp"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
 #include <thread>
 #include <tuple>
+#include <vector>
 
 using namespace std::chrono_literals;
-namespace tla   = beman::timed_lock_alg;
-using MockMutex = beman::timed_lock_alg::test::MockTimedMutex;
+namespace tla         = beman::timed_lock_alg;
+using MockMutex       = beman::timed_lock_alg::test::MockTimedMutex;
+using MockSharedMutex = beman::timed_lock_alg::test::MockSharedTimedMutex;
+using JThread         = beman::timed_lock_alg::test::JThread;
 
 namespace {
-// joining thread for implementations missing std::jthread
-class JThread : public std::thread {
-  public:
-    template <class... Args>
-    JThread(Args&&... args) : std::thread(std::forward<Args>(args)...) {}
-    ~JThread() {
-        if (joinable()) {
-            join();
-        }
-    }
-};
 const auto now         = std::chrono::steady_clock::now();
 const auto no_duration = 0ms;
 const auto extra_grace = 100ms;
 
+// records the order in which try_lock_until is called on the mutexes
+struct RecordingMutex : MockMutex {
+    int               id;
+    std::vector<int>* log;
+
+    RecordingMutex(int i, std::vector<int>& l) : id(i), log(&l) {}
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        log->push_back(id);
+        return MockMutex::try_lock_until(tp);
+    }
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        log->push_back(id);
+        return MockMutex::try_lock_for(dur);
+    }
+};
+
+// records the order in which it is acquired, in either mode
+struct RecordingSharedMutex : MockSharedMutex {
+    int               id;
+    std::vector<int>* log;
+
+    RecordingSharedMutex(int i, std::vector<int>& l) : id(i), log(&l) {}
+
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        log->push_back(id);
+        return MockSharedMutex::try_lock_until(tp);
+    }
+    template <class Clock, class Duration>
+    bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        log->push_back(id);
+        return MockSharedMutex::try_lock_shared_until(tp);
+    }
+};
+
+// a std::timed_mutex counting the calls to try_lock
+struct PolledMutex {
+    std::timed_mutex mtx;
+    std::atomic<int> polls{0};
+
+    void lock() { mtx.lock(); }
+    bool try_lock() {
+        ++polls;
+        return mtx.try_lock();
+    }
+    template <class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& dur) {
+        return mtx.try_lock_for(dur);
+    }
+    template <class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& tp) {
+        return mtx.try_lock_until(tp);
+    }
+    void unlock() { mtx.unlock(); }
+};
+
 template <class MutexType, std::size_t N>
 void unlocker(std::array<MutexType, N>& mtxs) {
     std::apply([](auto&... mts) { return std::scoped_lock(std::adopt_lock, mts...); }, mtxs);
@@ -93,6 +150,393 @@ TEST(TryLock, ManyMutexesOneLockedLast) {
     EXPECT_EQ(2, result);
 }
 
+TEST(TryLock, MixedMutexTypes) {
+    std::timed_mutex           m1;
+    MockMutex                  m2;
+    std::recursive_timed_mutex m3;
+
+    EXPECT_EQ(-1, tla::try_lock_for(no_duration, m1, m2, m3));
+    std::scoped_lock(std::adopt_lock, m1, m2, m3);
+
+    m2.should_fail = true;
+    EXPECT_EQ(1, tla::try_lock_for(no_duration, m1, m2, m3));
+    EXPECT_TRUE(m1.try_lock());
+    EXPECT_TRUE(m3.try_lock());
+    m1.unlock();
+    m3.unlock();
+}
+
+// ============================================================================
+// Range Tests with Mock Mutexes
+// ============================================================================
+
+TEST(TryLockRange, Empty) {
+    std::vector<MockMutex*> mtxs;
+    EXPECT_EQ(-1, tla::try_lock_until(now, mtxs));
+    EXPECT_EQ(-1, tla::try_lock_for(no_duration, mtxs));
+}
+
+TEST(TryLockRange, OneMutexUnlocked) {
+    std::array<MockMutex, 1> mtxs;
+    EXPECT_EQ(-1, tla::try_lock_until(now, mtxs));
+    EXPECT_EQ(1, mtxs[0].try_lock_count);
+    unlocker(mtxs);
+}
+
+TEST(TryLockRange, ManyMutexesUnlocked) {
+    std::array<MockMutex, 30> mtxs;
+
+    EXPECT_EQ(-1, tla::try_lock_until(now, std::span(mtxs)));
+    unlocker(mtxs);
+
+    EXPECT_EQ(-1, tla::try_lock_for(no_duration, std::span(mtxs)));
+    unlocker(mtxs);
+}
+
+TEST(TryLockRange, PointersToMutexes) {
+    std::array<MockMutex, 4> mtxs;
+    std::vector<MockMutex*>  ptrs{&mtxs[3], &mtxs[1], &mtxs[2]};
+
+    EXPECT_EQ(-1, tla::try_lock_for(no_duration, ptrs));
+    EXPECT_EQ(0, mtxs[0].lock_count);
+    EXPECT_EQ(1, mtxs[1].lock_count);
+    EXPECT_EQ(1, mtxs[2].lock_count);
+    EXPECT_EQ(1, mtxs[3].lock_count);
+}
+
+TEST(TryLockRange, ManyMutexesOneLocked) {
+    for (std::size_t locked = 0; locked < 3; ++locked) {
+        std::array<MockMutex, 3> mtxs;
+        mtxs[locked].should_fail = true;
+        EXPECT_EQ(static_cast<int>(locked), tla::try_lock_for(no_duration, mtxs));
+        for (auto& mtx : mtxs) {
+            EXPECT_EQ(mtx.lock_count, mtx.unlock_count);
+        }
+    }
+}
+
+// ============================================================================
+// Ordered Tests with Mock Mutexes
+// ============================================================================
+
+TEST(TryLockOrdered, ZeroMutexes) {
+    EXPECT_EQ(-1, tla::try_lock_until(tla::ordered_lock, now));
+    EXPECT_EQ(-1, tla::try_lock_for(tla::ordered_lock, no_duration));
+}
+
+TEST(TryLockOrdered, ManyMutexesUnlocked) {
+    std::array<MockMutex, 30> mtxs;
+
+    EXPECT_EQ(-1, std::apply([](auto&... mts) { return tla::try_lock_until(tla::ordered_lock, now, mts...); }, mtxs));
+    unlocker(mtxs);
+
+    EXPECT_EQ(-1, tla::try_lock_for(tla::ordered_lock, no_duration, mtxs));
+    unlocker(mtxs);
+}
+
+TEST(TryLockOrdered, AcquiresInAddressOrder) {
+    std::vector<int>              log;
+    std::array<RecordingMutex, 3> mtxs{RecordingMutex(0, log), RecordingMutex(1, log), RecordingMutex(2, log)};
+
+    EXPECT_EQ(-1, tla::try_lock_for(tla::ordered_lock, no_duration, mtxs[2], mtxs[0], mtxs[1]));
+    EXPECT_EQ((std::vector<int>{0, 1, 2}), log);
+    unlocker(mtxs);
+}
+
+TEST(TryLockOrdered, AcquiresInKeyOrder) {
+    std::vector<int>              log;
+    std::array<RecordingMutex, 3> mtxs{RecordingMutex(0, log), RecordingMutex(1, log), RecordingMutex(2, log)};
+    const auto                    by_id_desc = tla::ordered_by([](const RecordingMutex& m) { return -m.id; });
+
+    EXPECT_EQ(-1, tla::try_lock_for(by_id_desc, no_duration, mtxs[0], mtxs[2], mtxs[1]));
+    EXPECT_EQ((std::vector<int>{2, 1, 0}), log);
+    unlocker(mtxs);
+
+    log.clear();
+    std::vector<RecordingMutex*> ptrs{&mtxs[1], &mtxs[0], &mtxs[2]};
+    EXPECT_EQ(-1, tla::try_lock_for(by_id_desc, no_duration, ptrs));
+    EXPECT_EQ((std::vector<int>{2, 1, 0}), log);
+    unlocker(mtxs);
+}
+
+TEST(TryLockOrdered, FailureReturnsArgumentIndexAndReleases) {
+    std::array<MockMutex, 3> mtxs;
+    mtxs[1].should_fail = true;
+
+    EXPECT_EQ(2, tla::try_lock_for(tla::ordered_lock, no_duration, mtxs[0], mtxs[2], mtxs[1]));
+    EXPECT_EQ(1, tla::try_lock_for(tla::ordered_lock, no_duration, mtxs));
+    for (auto& mtx : mtxs) {
+        EXPECT_EQ(mtx.lock_count, mtx.unlock_count);
+    }
+}
+
+// ============================================================================
+// Shared Tests with Mock Mutexes
+// ============================================================================
+
+TEST(TryLockShared, ZeroMutexes) {
+    EXPECT_EQ(-1, tla::try_lock_shared_until(now));
+    EXPECT_EQ(-1, tla::try_lock_shared_for(no_duration));
+}
+
+TEST(TryLockShared, ManyMutexesUnlocked) {
+    std::array<MockSharedMutex, 30> mtxs;
+
+    EXPECT_EQ(-1, std::apply([](auto&... mts) { return tla::try_lock_shared_for(no_duration, mts...); }, mtxs));
+    for (auto& mtx : mtxs) {
+        EXPECT_EQ(1, mtx.shared_owners);
+        EXPECT_EQ(0, mtx.lock_count);
+        mtx.unlock_shared();
+    }
+
+    std::vector<MockSharedMutex*> ptrs{&mtxs[3], &mtxs[1], &mtxs[2]};
+    EXPECT_EQ(-1, tla::try_lock_shared_until(now, ptrs));
+    EXPECT_EQ(1, mtxs[1].shared_owners);
+    EXPECT_EQ(0, mtxs[0].shared_owners);
+    for (auto* mtx : ptrs) {
+        mtx->unlock_shared();
+    }
+}
+
+TEST(TryLockShared, FailureReturnsIndexAndReleases) {
+    std::array<MockSharedMutex, 3> mtxs;
+    mtxs[1].should_fail = true;
+
+    EXPECT_EQ(1, tla::try_lock_shared_for(no_duration, mtxs[0], mtxs[1], mtxs[2]));
+    EXPECT_EQ(1, tla::try_lock_shared_for(no_duration, mtxs));
+    for (auto& mtx : mtxs) {
+        EXPECT_EQ(0, mtx.shared_owners);
+        EXPECT_EQ(mtx.lock_shared_count, mtx.unlock_shared_count);
+    }
+}
+
+TEST(TryLockShared, MixedWithExclusive) {
+    MockMutex       m1, m2;
+    MockSharedMutex s1;
+
+    EXPECT_EQ(-1, tla::try_lock_for(no_duration, m1, tla::shared(s1), m2));
+    EXPECT_EQ(1, s1.shared_owners);
+    EXPECT_EQ(0, s1.lock_count);
+    EXPECT_TRUE(m1.locked);
+    EXPECT_TRUE(m2.locked);
+    m1.unlock();
+    m2.unlock();
+    s1.unlock_shared();
+
+    s1.should_fail = true;
+    EXPECT_EQ(1, tla::try_lock_until(now, tla::spin_backoff{}, m1, tla::shared(s1), m2));
+    EXPECT_EQ(m1.lock_count, m1.unlock_count);
+    EXPECT_EQ(m2.lock_count, m2.unlock_count);
+}
+
+TEST(TryLockShared, MixedOrdered) {
+    MockMutex                      m1;
+    std::array<MockSharedMutex, 2> ss;
+
+    EXPECT_EQ(-1, tla::try_lock_for(tla::ordered_lock, no_duration, tla::shared(ss[1]), m1, tla::shared(ss[0])));
+    EXPECT_EQ(1, ss[0].shared_owners);
+    EXPECT_EQ(1, ss[1].shared_owners);
+    m1.unlock();
+    ss[0].unlock_shared();
+    ss[1].unlock_shared();
+}
+
+TEST(TryLockShared, MixedOrderedRange) {
+    std::vector<int>                    log;
+    std::array<RecordingSharedMutex, 2> ss{RecordingSharedMutex(0, log), RecordingSharedMutex(1, log)};
+
+    // the adapters are ordered by the mutexes they refer to, so shared and exclusive callers agree on the order
+    EXPECT_EQ(-1, tla::try_lock_until(tla::ordered_lock, now, ss[1], ss[0]));
+    const std::vector<int> exclusive_order = log;
+    ss[0].unlock();
+    ss[1].unlock();
+
+    log.clear();
+    std::array adapters{tla::shared(ss[1]), tla::shared(ss[0])};
+    EXPECT_EQ(-1, tla::try_lock_until(tla::ordered_lock, now, adapters));
+    EXPECT_EQ(exclusive_order, log);
+    EXPECT_EQ(1, ss[0].shared_owners);
+    EXPECT_EQ(1, ss[1].shared_owners);
+    ss[0].unlock_shared();
+    ss[1].unlock_shared();
+
+    log.clear();
+    const auto by_id = tla::ordered_by([](const RecordingSharedMutex& m) { return m.id; });
+    EXPECT_EQ(-1, tla::try_lock_until(by_id, now, adapters));
+    EXPECT_EQ((std::vector<int>{0, 1}), log);
+    ss[0].unlock_shared();
+    ss[1].unlock_shared();
+}
+
+// ============================================================================
+// Any and K-of-N Tests with Mock Mutexes
+// ============================================================================
+
+TEST(TryLockAny, ZeroMutexes) {
+    EXPECT_EQ(-1, tla::try_lock_any_until(now));
+    EXPECT_EQ(-1, tla::try_lock_any_for(no_duration));
+}
+
+TEST(TryLockAny, LocksTheFreeOne) {
+    std::array<MockMutex, 3> mtxs;
+    mtxs[0].should_fail = true;
+    mtxs[2].should_fail = true;
+    EXPECT_EQ(1, tla::try_lock_any_for(no_duration, mtxs[0], mtxs[1], mtxs[2]));
+    EXPECT_TRUE(mtxs[1].locked);
+    EXPECT_EQ(1, tla::try_lock_any_until(now, mtxs));
+    EXPECT_EQ(2, mtxs[1].lock_count);
+}
+
+TEST(TryLockAny, TimeoutReturnsMinusOne) {
+    std::array<MockMutex, 3> mtxs;
+    for (auto& mtx : mtxs) {
+        mtx.should_fail = true;
+    }
+    EXPECT_EQ(-1, tla::try_lock_any_for(no_duration, mtxs[0], mtxs[1], mtxs[2]));
+    EXPECT_EQ(-1, tla::try_lock_any_for(1ms, tla::sleep_backoff{}, mtxs));
+    for (auto& mtx : mtxs) {
+        EXPECT_GT(mtx.try_lock_count, 0);
+        EXPECT_EQ(0, mtx.lock_count);
+    }
+}
+
+TEST(TryLockAny, BlocksWhileAllAreBusy) {
+    std::array<PolledMutex, 3> mtxs;
+    std::atomic<bool>          held = false;
+    JThread                    holder([&] {
+        for (auto& mtx : mtxs) {
+            mtx.lock();
+        }
+        held = true;
+        std::this_thread::sleep_for(50ms);
+        mtxs[1].unlock();
+        std::this_thread::sleep_for(10ms);
+        mtxs[0].unlock();
+        mtxs[2].unlock();
+    });
+    while (not held) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(1, tla::try_lock_any_for(10s, mtxs));
+    // about one round per millisecond instead of polling all the time
+    int polls = 0;
+    for (auto& mtx : mtxs) {
+        polls += mtx.polls;
+    }
+    EXPECT_LT(polls, 1000);
+    mtxs[1].unlock();
+}
+
+TEST(TryLockAny, MixedMutexTypes) {
+    std::timed_mutex m1;
+    MockMutex        m2;
+    std::lock_guard  lg(m1);
+    EXPECT_EQ(1, tla::try_lock_any_for(no_duration, m1, m2));
+    m2.unlock();
+}
+
+TEST(TryLockK, LocksKDistinct) {
+    std::array<MockMutex, 5> mtxs;
+    auto                     acquired = tla::try_lock_k_for(no_duration, 3, mtxs).value();
+    ASSERT_EQ(3u, acquired.size());
+    std::sort(acquired.begin(), acquired.end());
+    EXPECT_EQ(acquired.end(), std::adjacent_find(acquired.begin(), acquired.end()));
+    int locked = 0;
+    for (auto& mtx : mtxs) {
+        locked += mtx.locked;
+    }
+    EXPECT_EQ(3, locked);
+    for (auto idx : acquired) {
+        EXPECT_TRUE(mtxs[idx].locked);
+    }
+}
+
+TEST(TryLockK, SkipsLockedOnes) {
+    std::array<MockMutex, 4> mtxs;
+    mtxs[1].should_fail = true;
+    mtxs[2].should_fail = true;
+    auto acquired       = tla::try_lock_k_until(now, 2, mtxs[0], mtxs[1], mtxs[2], mtxs[3]).value();
+    std::sort(acquired.begin(), acquired.end());
+    EXPECT_EQ((std::vector<std::size_t>{0, 3}), acquired);
+}
+
+TEST(TryLockK, ReleasesWhenTooFewAreFree) {
+    std::array<MockMutex, 4> mtxs;
+    for (auto& mtx : std::span(mtxs).first(3)) {
+        mtx.should_fail = true;
+    }
+    EXPECT_FALSE(tla::try_lock_k_for(no_duration, 2, mtxs));
+    EXPECT_FALSE(tla::try_lock_k_for(1ms, tla::sleep_backoff{}, 2, mtxs[0], mtxs[1], mtxs[2], mtxs[3]));
+    EXPECT_GT(mtxs[3].lock_count, 0);
+    EXPECT_EQ(mtxs[3].lock_count, mtxs[3].unlock_count);
+}
+
+TEST(TryLockK, KOutOfRange) {
+    std::array<MockMutex, 2> mtxs;
+    EXPECT_FALSE(tla::try_lock_k_for(no_duration, 3, mtxs));
+    EXPECT_FALSE(tla::try_lock_k_for(no_duration, 3, mtxs[0], mtxs[1]));
+    EXPECT_FALSE(tla::try_lock_k_until(now, 1));
+    EXPECT_EQ(0, mtxs[0].try_lock_count + mtxs[1].try_lock_count);
+}
+
+TEST(TryLockK, ZeroSucceeds) {
+    std::array<MockMutex, 2> mtxs;
+    mtxs[0].should_fail = true;
+    mtxs[1].should_fail = true;
+    const auto acquired = tla::try_lock_k_for(no_duration, 0, mtxs);
+    ASSERT_TRUE(acquired);
+    EXPECT_TRUE(acquired->empty());
+    EXPECT_EQ(std::optional<std::vector<std::size_t>>(std::vector<std::size_t>{}),
+              tla::try_lock_k_until(now, 0, mtxs[0], mtxs[1]));
+    EXPECT_TRUE(tla::try_lock_k_until(now, 0));
+    EXPECT_EQ(0, mtxs[0].try_lock_count + mtxs[1].try_lock_count);
+}
+
+TEST(TryLockK, RangeOfPointers) {
+    std::array<MockMutex, 3> mtxs;
+    std::vector<MockMutex*>  ptrs{&mtxs[2], &mtxs[0], &mtxs[1]};
+    mtxs[2].should_fail = true;
+    auto acquired       = tla::try_lock_k_for(no_duration, 2, ptrs).value();
+    std::sort(acquired.begin(), acquired.end());
+    EXPECT_EQ((std::vector<std::size_t>{1, 2}), acquired);
+}
+
+// ============================================================================
+// Stop Token Tests
+// ============================================================================
+
+#if defined(__cpp_lib_jthread)
+TEST(TryLockStop, StoppedBeforeLocksNothing) {
+    MockMutex        m1, m2;
+    std::stop_source ss;
+    ss.request_stop();
+    EXPECT_EQ(tla::lock_cancelled, tla::try_lock_until(ss.get_token(), now, m1, m2));
+    EXPECT_EQ(tla::lock_cancelled, tla::try_lock_for(ss.get_token(), no_duration, tla::spin_backoff{}, m1));
+
+    std::array<MockMutex*, 2> ptrs{&m1, &m2};
+    EXPECT_EQ(tla::lock_cancelled, tla::try_lock_for(ss.get_token(), no_duration, ptrs));
+    EXPECT_EQ(0, m1.try_lock_count + m2.try_lock_count);
+}
+
+TEST(TryLockStop, NotStoppedBehavesAsBefore) {
+    std::array<MockMutex, 3> mtxs;
+    std::stop_source         ss;
+    EXPECT_EQ(-1, std::apply([&](auto&... ms) { return tla::try_lock_until(ss.get_token(), now, ms...); }, mtxs));
+    for (auto& m : mtxs) {
+        EXPECT_TRUE(m.locked);
+        m.unlock();
+    }
+
+    mtxs[1].should_fail = true;
+    EXPECT_EQ(1, tla::try_lock_for(ss.get_token(), no_duration, mtxs[0], mtxs[1], mtxs[2]));
+    EXPECT_FALSE(mtxs[0].locked);
+    EXPECT_FALSE(mtxs[2].locked);
+    EXPECT_EQ(1, tla::try_lock_until(ss.get_token(), now, mtxs));
+
+    EXPECT_EQ(-1, tla::try_lock_until(ss.get_token(), now, std::span<MockMutex>{}));
+}
+#endif
+
 // ============================================================================
 // Integration Tests with Real Mutexes (verify actual threading behavior)
 // ============================================================================
@@ -167,3 +611,175 @@ TEST(TryLockIntegration, SucceedWithThreeInTrickySequence) {
     std::this_thread::sleep_for(50ms);
     EXPECT_EQ(-1, std::apply([](auto&... mts) { return tla::try_lock_for(100ms + extra_grace, mts...); }, mtxs));
 }
+
+TEST(TryLockIntegration, RangeReturnLastFailed) {
+    std::array<std::timed_mutex, 2> mtxs;
+    auto                            th = JThread([&] {
+        std::lock(mtxs[0], mtxs[1]);
+        std::this_thread::sleep_for(100ms);
+        mtxs[0].unlock(); // 50ms after try_lock_for started, 200ms left
+
+        // try_lock_for here hangs on mtxs[1] and should return 1:
+        std::this_thread::sleep_for(300ms + extra_grace);
+        mtxs[1].unlock();
+    });
+
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(1, tla::try_lock_for(200ms, std::span(mtxs)));
+}
+
+TEST(TryLockIntegration, RangeSucceedWithThreeInTrickySequence) {
+    std::array<std::timed_mutex, 3> mtxs;
+    std::vector<std::timed_mutex*>  ptrs{&mtxs[0], &mtxs[1], &mtxs[2]};
+    auto                            th = JThread([&] {
+        std::lock(mtxs[0], mtxs[1], mtxs[2]);
+        std::this_thread::sleep_for(55ms);
+        mtxs[0].unlock();
+        std::this_thread::sleep_for(5ms);
+        mtxs[2].unlock();
+        mtxs[0].lock();
+        mtxs[1].unlock();
+        std::this_thread::sleep_for(10ms);
+        mtxs[0].unlock();
+    });
+
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(-1, tla::try_lock_for(100ms + extra_grace, ptrs));
+    unlocker(mtxs);
+}
+
+TEST(TryLockIntegration, OrderedOppositeArgumentOrders) {
+    std::timed_mutex m1, m2;
+    int              counter = 0;
+    auto             worker  = [&](std::timed_mutex& a, std::timed_mutex& b) {
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_EQ(-1, tla::try_lock_for(tla::ordered_lock, 1s, a, b));
+            std::scoped_lock lock(std::adopt_lock, a, b);
+            ++counter;
+        }
+    };
+    {
+        JThread t1(worker, std::ref(m1), std::ref(m2));
+        JThread t2(worker, std::ref(m2), std::ref(m1));
+    }
+    EXPECT_EQ(2000, counter);
+}
+
+TEST(TryLockIntegration, SharedReadersDontExcludeEachOther) {
+    std::array<std::shared_timed_mutex, 3> mtxs;
+    std::shared_lock                       reader(mtxs[1]);
+
+    JThread th([&] {
+        EXPECT_EQ(-1, tla::try_lock_shared_for(10ms, mtxs[0], mtxs[1], mtxs[2]));
+        for (auto& mtx : mtxs) {
+            mtx.unlock_shared();
+        }
+        EXPECT_EQ(1, tla::try_lock_for(10ms, mtxs[0], mtxs[1], mtxs[2]));
+    });
+}
+
+TEST(TryLockIntegration, SharedWaitsForWriter) {
+    std::array<std::shared_timed_mutex, 2> mtxs;
+    std::atomic<bool>                      locked = false;
+    JThread                                th([&] {
+        std::lock_guard writer(mtxs[1]);
+        locked = true;
+        std::this_thread::sleep_for(20ms);
+    });
+    while (not locked) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_EQ(1, tla::try_lock_shared_for(0ms, mtxs));
+    EXPECT_EQ(-1, tla::try_lock_shared_for(1s, mtxs));
+    for (auto& mtx : mtxs) {
+        mtx.unlock_shared();
+    }
+}
+
+TEST(TryLockIntegration, MixedReadersOfSharedInputRunInParallel) {
+    std::shared_timed_mutex input;
+    std::timed_mutex        out1, out2;
+    std::atomic<int>        readers = 0;
+    std::atomic<bool>       overlap = false;
+    auto                    worker  = [&](std::timed_mutex& out) {
+        for (int i = 0; i < 200 && not overlap; ++i) {
+            ASSERT_EQ(-1, tla::try_lock_for(1s, tla::shared(input), out));
+            if (++readers == 2) {
+                overlap = true;
+            }
+            std::this_thread::sleep_for(100us);
+            --readers;
+            out.unlock();
+            input.unlock_shared();
+        }
+    };
+    {
+        JThread t1(worker, std::ref(out1));
+        JThread t2(worker, std::ref(out2));
+    }
+    EXPECT_TRUE(overlap);
+}
+
+TEST(TryLockIntegration, AnyFromPoolIsExclusive) {
+    std::array<std::timed_mutex, 3>  pool;
+    std::array<std::atomic<int>, 3> users{};
+    std::atomic<bool>                overlap = false;
+    auto                             worker  = [&] {
+        for (int i = 0; i < 500; ++i) {
+            const int idx = tla::try_lock_any_for(10s, tla::sleep_backoff{}, pool);
+            ASSERT_NE(-1, idx);
+            if (++users[static_cast<std::size_t>(idx)] != 1) {
+                overlap = true;
+            }
+            std::this_thread::yield();
+            --users[static_cast<std::size_t>(idx)];
+            pool[static_cast<std::size_t>(idx)].unlock();
+        }
+    };
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 6; ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+    EXPECT_FALSE(overlap);
+}
+
+TEST(TryLockIntegration, KOfNWaitsForEnoughToBeFree) {
+    std::array<std::timed_mutex, 3> pool;
+    pool[0].lock();
+    pool[1].lock();
+    JThread th([&] {
+        auto acquired = tla::try_lock_k_for(10s, tla::sleep_backoff{}, 2, pool).value();
+        std::sort(acquired.begin(), acquired.end());
+        EXPECT_EQ((std::vector<std::size_t>{1, 2}), acquired);
+        for (auto idx : acquired) {
+            pool[idx].unlock();
+        }
+    });
+    std::this_thread::sleep_for(10ms);
+    pool[1].unlock();
+    th.join();
+    pool[0].unlock();
+}
+
+#if defined(__cpp_lib_jthread)
+TEST(TryLockIntegration, StopWakesWaiterEarly) {
+    std::array<std::timed_mutex, 2> mtxs;
+    std::unique_lock                held(mtxs[1]);
+    std::stop_source                ss;
+    JThread                         th([&] {
+        std::this_thread::sleep_for(10ms);
+        ss.request_stop();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(tla::lock_cancelled, tla::try_lock_for(ss.get_token(), 10s, mtxs[0], mtxs[1]));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+    EXPECT_TRUE(mtxs[0].try_lock());
+    mtxs[0].unlock();
+}
+#endif